@@ -0,0 +1,106 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "regex/regex.h"
+#include "regex/regex_func.h"
+#include "regex/regex_jit.h"
+
+using namespace regex;
+
+typedef basic_regex<char> Regex;
+
+/*! \brief Run the boolean regex_search over input with the native code of
+ * the JIT, its interpreter, and basic_regex, and print the cost per byte.
+ */
+static void bench_search(const char* name, const char* pattern,
+                         const std::string& input, int repeat) {
+  Regex re(pattern);
+  regex_jit<Regex> jit(re);
+  auto& dfa = jit.search_dfa();
+  std::size_t found = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; ++i) {
+    found += regex_search(input.cbegin(), input.cend(), jit);
+  }
+  auto mid = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; ++i) {
+    found += dfa.interpret(input.cbegin(), input.cend());
+  }
+  auto mid2 = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; ++i) {
+    found += regex_search(input.cbegin(), input.cend(), re);
+  }
+  auto stop = std::chrono::steady_clock::now();
+
+  double bytes = double(input.size()) * repeat;
+  double ns1 = std::chrono::duration<double, std::nano>(mid - start).count();
+  double ns2 = std::chrono::duration<double, std::nano>(mid2 - mid).count();
+  double ns3 = std::chrono::duration<double, std::nano>(stop - mid2).count();
+  std::printf("%-10s %5zu states %6zu bytes of code %s\n", name,
+              dfa.state_count(), dfa.code_size(),
+              dfa.native() ? "" : "(no jit)");
+  std::printf("%-10s jit %.2f ns/byte, interpreter %.2f ns/byte, "
+              "basic_regex %.2f ns/byte (found %zu)\n",
+              "", ns1 / bytes, ns2 / bytes, ns3 / bytes, found / 3);
+}
+
+/*! \brief Validate each line with regex_match like bench_search.
+ */
+static void bench_match(const char* name, const char* pattern,
+                        const std::vector<std::string>& lines) {
+  Regex re(pattern);
+  regex_jit<Regex> jit(re);
+  auto& dfa = jit.match_dfa();
+  std::size_t found = 0, bytes = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (auto& line : lines) {
+    found += regex_match(line.cbegin(), line.cend(), jit);
+    bytes += line.size();
+  }
+  auto mid = std::chrono::steady_clock::now();
+  for (auto& line : lines) {
+    found += dfa.interpret(line.cbegin(), line.cend());
+  }
+  auto mid2 = std::chrono::steady_clock::now();
+  for (auto& line : lines) {
+    found += regex_match(line.cbegin(), line.cend(), re);
+  }
+  auto stop = std::chrono::steady_clock::now();
+
+  double ns1 = std::chrono::duration<double, std::nano>(mid - start).count();
+  double ns2 = std::chrono::duration<double, std::nano>(mid2 - mid).count();
+  double ns3 = std::chrono::duration<double, std::nano>(stop - mid2).count();
+  std::printf("%-10s %5zu states %6zu bytes of code %s\n", name,
+              dfa.state_count(), dfa.code_size(),
+              dfa.native() ? "" : "(no jit)");
+  std::printf("%-10s jit %.2f ns/byte, interpreter %.2f ns/byte, "
+              "basic_regex %.2f ns/byte (found %zu)\n",
+              "", ns1 / bytes, ns2 / bytes, ns3 / bytes, found / 3);
+}
+
+int main() {
+  std::string log;
+  while (log.size() < 1000000) log += "INFO request served in 12ms\n";
+  log += "ERROR abba\n";
+
+  bench_search("search", "ERROR (a|b)+", log, 3);
+  bench_search("small", "(a|b|c)*(x|y)(a|b)*(d|e)+z", log, 3);
+
+  std::string tokens;
+  while (tokens.size() < 1000000) {
+    tokens += "session0123456789abcdefghijklmnopqrstuvwxyz0123456789      ";
+  }
+  bench_search("classes", "[a-z0-9]+;", tokens, 3);
+
+  std::vector<std::string> headers;
+  for (int i = 0; i < 100000; ++i) {
+    headers.push_back(i % 3 ? "X-Request-Id-" + std::to_string(i) + ": 42"
+                            : "Bad Header: " + std::to_string(i));
+  }
+  bench_match("headers", "[A-Za-z0-9!#$%&'*+.^_`|~-]+:", headers);
+  return 0;
+}
@@ -0,0 +1,290 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "regex/regex.h"
+#include "regex/regex_func.h"
+#include "regex/regex_match_results.h"
+#include "regex/regex_matcher.h"
+#include "regex/regex_serialize.h"
+#include "regex/regex_set.h"
+#include "regex/regex_static.h"
+
+using namespace regex;
+
+typedef basic_regex<char> Regex;
+typedef match_results<std::string::const_iterator> MatchResults;
+typedef regex_matcher<Regex, std::string::const_iterator, MatchResults>
+    RegexMatcher;
+
+/*! \brief Run the matcher over input and print the cost per byte.
+ */
+static void bench(const char* name, const char* pattern,
+                  const std::string& input, int repeat) {
+  Regex re(pattern);
+  std::size_t matched = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; ++i) {
+    MatchResults what;
+    RegexMatcher rm(input.cbegin(), input.cend(), re, what);
+    matched += what[0].length();
+  }
+  auto stop = std::chrono::steady_clock::now();
+
+  double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+  std::printf("%-12s %5zu insns %10.2f ns/byte (matched %zu)\n", name,
+              re.nfa().size(), ns / (double(input.size()) * repeat),
+              matched / repeat);
+}
+
+/*! \brief Run regex_search over input and print the cost per byte.
+ */
+static void bench_search(const char* name, const char* pattern,
+                         const std::string& input, int repeat) {
+  Regex re(pattern);
+  std::size_t matched = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; ++i) {
+    MatchResults what;
+    if (regex_search(input.cbegin(), input.cend(), what, re)) {
+      matched += what[0].length();
+    }
+  }
+  auto stop = std::chrono::steady_clock::now();
+
+  double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+  std::printf("%-12s %5zu insns %10.2f ns/byte (matched %zu)\n", name,
+              re.nfa().size(), ns / (double(input.size()) * repeat),
+              matched / repeat);
+}
+
+/*! \brief Run the bit-parallel engine over input and the lazy DFA, and print
+ * the cost per byte of both.
+ *
+ * The boolean regex_search only runs the bit-parallel engine on the inputs of
+ * at most REGEX_BIT_PARALLEL_MAX_INPUT chars.
+ */
+static void bench_boolean(const char* name, const char* pattern,
+                          const std::string& input, int repeat) {
+  Regex re(pattern);
+  std::size_t found = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; ++i) {
+    found += re.bit_parallel().search(input.cbegin(), input.cend());
+  }
+  auto mid = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; ++i) {
+    lazy_dfa<Regex::nfa_type> dfa(re.nfa(), re.nfa().search_start_id());
+    dfa.set_byte_classes(&re.classes());
+    std::string::const_iterator match_end;
+    found += dfa.find(input.cbegin(), input.cend(), match_end) == k_dfa_match;
+  }
+  auto stop = std::chrono::steady_clock::now();
+
+  double bytes = double(input.size()) * repeat;
+  double ns1 = std::chrono::duration<double, std::nano>(mid - start).count();
+  double ns2 = std::chrono::duration<double, std::nano>(stop - mid).count();
+  std::printf("%-12s %5zu insns %10.2f ns/byte (dfa %.2f ns/byte, found %zu)\n",
+              name, re.nfa().size(), ns1 / bytes, ns2 / bytes, found);
+}
+
+/*! \brief Run regex_match with captures over input and regex_matcher, and
+ * print the cost per byte of both.
+ */
+static void bench_captures(const char* name, const char* pattern,
+                           const std::string& input, int repeat) {
+  Regex re(pattern);
+  std::size_t matched = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; ++i) {
+    MatchResults what;
+    if (regex_match(input.cbegin(), input.cend(), what, re)) {
+      matched += what[0].length();
+    }
+  }
+  auto mid = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; ++i) {
+    MatchResults what;
+    RegexMatcher rm(input.cbegin(), input.cend(), re, what);
+    matched += what[0].length();
+  }
+  auto stop = std::chrono::steady_clock::now();
+
+  double bytes = double(input.size()) * repeat;
+  double ns1 = std::chrono::duration<double, std::nano>(mid - start).count();
+  double ns2 = std::chrono::duration<double, std::nano>(stop - mid).count();
+  std::printf("%-12s %5zu insns %10.2f ns/byte (pike %.2f ns/byte, %s)\n",
+              name, re.nfa().size(), ns1 / bytes, ns2 / bytes,
+              re.is_one_pass() ? "one-pass" : "not one-pass");
+}
+
+/*! \brief Run a regex_set of the patterns over each line, and the boolean
+ * regex_search of each pattern, and print the cost per byte of both.
+ */
+static void bench_set(const char* name,
+                      const std::vector<std::string>& patterns,
+                      const std::vector<std::string>& lines) {
+  regex_set set(patterns.begin(), patterns.end());
+  regex_set_cache<regex_set> cache(set);
+  std::vector<Regex> regexes(patterns.begin(), patterns.end());
+  std::size_t found = 0, bytes = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::size_t> ids;
+  for (auto& line : lines) {
+    regex_search(line.cbegin(), line.cend(), ids, set, cache);
+    found += ids.size();
+    bytes += line.size();
+  }
+  auto mid = std::chrono::steady_clock::now();
+  for (auto& line : lines) {
+    for (auto& re : regexes) {
+      found += regex_search(line.cbegin(), line.cend(), re);
+    }
+  }
+  auto stop = std::chrono::steady_clock::now();
+
+  double ns1 = std::chrono::duration<double, std::nano>(mid - start).count();
+  double ns2 = std::chrono::duration<double, std::nano>(stop - mid).count();
+  std::printf("%-12s %5zu insns %10.2f ns/byte (one by one %.2f ns/byte, "
+              "found %zu)\n",
+              name, set.nfa().size(), ns1 / bytes, ns2 / bytes, found / 2);
+}
+
+REGEX_STATIC_PATTERN(header_name, "[A-Za-z0-9!#$%&'*+.^_`|~-]+:");
+
+/*! \brief Validate each line with the static_regex of Pattern and with the
+ * boolean regex_match of its basic_regex, and print the cost per byte of
+ * both.
+ */
+template <class Pattern>
+static void bench_static(const char* name,
+                         const std::vector<std::string>& lines) {
+  static_regex<Pattern> re;
+  Regex runtime(Pattern::pattern());
+  std::size_t found = 0, bytes = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (auto& line : lines) {
+    found += regex_match(line.cbegin(), line.cend(), re);
+    bytes += line.size();
+  }
+  auto mid = std::chrono::steady_clock::now();
+  for (auto& line : lines) {
+    found += regex_match(line.cbegin(), line.cend(), runtime);
+  }
+  auto stop = std::chrono::steady_clock::now();
+
+  double ns1 = std::chrono::duration<double, std::nano>(mid - start).count();
+  double ns2 = std::chrono::duration<double, std::nano>(stop - mid).count();
+  std::printf("%-12s %5zu pos   %10.2f ns/byte (basic_regex %.2f ns/byte, "
+              "found %zu)\n",
+              name, re.k_program.position_count, ns1 / bytes, ns2 / bytes,
+              found / 2);
+}
+
+/*! \brief Compile the patterns, and load them from their serialized blob,
+ * and print the cost per regex of both.
+ */
+static void bench_load(const char* name,
+                       const std::vector<std::string>& patterns) {
+  std::vector<Regex> compiled, loaded;
+  compiled.reserve(patterns.size());
+  loaded.reserve(patterns.size());
+  auto start = std::chrono::steady_clock::now();
+  for (auto& p : patterns) compiled.emplace_back(p);
+  auto mid = std::chrono::steady_clock::now();
+
+  std::string blob = serialize_regexes(compiled.begin(), compiled.end());
+  regex_blob<Regex> view(blob.data(), blob.size());
+  auto mid2 = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < view.size(); ++i) loaded.push_back(view.load(i));
+  auto stop = std::chrono::steady_clock::now();
+
+  double ns1 = std::chrono::duration<double, std::nano>(mid - start).count();
+  double ns2 = std::chrono::duration<double, std::nano>(stop - mid2).count();
+  std::printf("%-12s %5zu regexes %7.0f ns/regex (loaded %.0f ns/regex, "
+              "%zu bytes)\n",
+              name, patterns.size(), ns1 / patterns.size(),
+              ns2 / patterns.size(), blob.size());
+}
+
+int main() {
+  std::string abc;
+  for (int i = 0; i < 100000; ++i) abc += "abcdefghij"[i % 10];
+
+  std::string letters;
+  for (int i = 0; i < 100000; ++i) {
+    letters += "abcdefghijklmnopqrstuvwxyz"[i % 26];
+  }
+
+  bench("alternation",
+        "(A|B|C|D|E|F|G|H|I|J|K|L|M|N|O|P|Q|R|S|T|U|V|W|X|Y|Z|"
+        "a|b|c|d|e|f|g|h|i|j|k|l|m|n|o|p|q|r|s|t|u|v|w|x|y|z)*",
+        letters, 3);
+  bench("sequence",
+        "(abcdefghik|abcdefghil|abcdefghim|abcdefghin|abcdefghio|"
+        "abcdefghip|abcdefghiq|abcdefghir|abcdefghis|abcdefghij)*",
+        abc, 3);
+  bench("nested", "(((a|b|c)*(d|e|f)+(g|h)*(i|j)*)*x|(abc|def|ghi|j)*)", abc,
+        3);
+
+  std::string fields;
+  while (fields.size() < 100000) fields += "key=value12;";
+  bench_captures("captures", "((a|b|c|d|e|f|g|h|i|j|k|l|m|n|o|p|q|r|s|t|u|v|w|"
+                 "x|y|z)+=(a|b|c|d|e|f|g|h|i|j|k|l|m|n|o|p|q|r|s|t|u|v|w|x|y|z|"
+                 "0|1|2|3|4|5|6|7|8|9)+;)*",
+                 fields, 3);
+  bench_captures("short", "((a|b)*(ab|b))*(c|bcd)(d*)",
+                 "abababbabbbababbbbcdddd", 20000);
+
+  std::string log;
+  while (log.size() < 1000000) log += "INFO request served in 12ms\n";
+  log += "ERROR abba\n";
+
+  bench_search("search", "ERROR (a|b)+", log, 3);
+  bench_search("sparse",
+               "(a|b|c|d|e|f|g|h|i|j|k|l|m|n|o|p|q|r|s|t|u|v|w|x|y|z| |"
+               "0|1|2|3|4|5|6|7|8|9)*(E|W)RROR ((a|b)+)",
+               log, 3);
+  bench_boolean("small", "(a|b|c)*(x|y)(a|b)*(d|e)+z", log, 3);
+
+  std::string tokens;
+  while (tokens.size() < 1000000) {
+    tokens += "session0123456789abcdefghijklmnopqrstuvwxyz0123456789      ";
+  }
+  bench_boolean("classes", "[a-z0-9]+;", tokens, 3);
+
+  std::string blocklist;
+  for (int i = 0; i < 5000; ++i) {
+    if (i) blocklist += '|';
+    blocklist += "word" + std::to_string(i * 7919 % 100000);
+  }
+  std::vector<std::string> rules, lines;
+  for (int i = 0; i < 200; ++i) {
+    rules.push_back("/api/v" + std::to_string(i % 7) + "/(a|b|c)*" +
+                    std::to_string(i) + "(x|y)");
+  }
+  for (int i = 0; i < 1000; ++i) {
+    lines.push_back("GET /api/v" + std::to_string(i % 9) + "/abc" +
+                    std::to_string(i % 300) + "y HTTP/1.1 200");
+  }
+  bench_set("rules", rules, lines);
+  bench_load("load", rules);
+
+  bench_search("blocklist", blocklist.c_str(), log.substr(log.size() - 20000),
+               3);
+
+  std::vector<std::string> headers;
+  for (int i = 0; i < 100000; ++i) {
+    headers.push_back(i % 3 ? "X-Request-Id-" + std::to_string(i) + ": 42"
+                            : "Bad Header: " + std::to_string(i));
+  }
+  bench_static<header_name>("static", headers);
+  return 0;
+}
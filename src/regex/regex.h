@@ -1,29 +1,106 @@
 #ifndef __REGEX_H__
 #define __REGEX_H__
 
+#include <atomic>
+#include <cstdint>
 #include <initializer_list>
 #include <string>
+#include <type_traits>
 
+#include "regex_bit_parallel.h"
+#include "regex_byte_classes.h"
+#include "regex_closure.h"
 #include "regex_nfa.h"
+#include "regex_onepass.h"
+#include "regex_optimizer.h"
+#include "regex_packed.h"
 #include "regex_parser.h"
+#include "regex_prefilter.h"
+#include "regex_reverse.h"
 #include "regex_scanner.h"
 #include "regex_traits.h"
 
 namespace regex {
 
+/*! \brief A number that is unique among all the objects ever created.
+ *
+ * A copy gets a new number, so the number identifies the object and its
+ * contents.
+ */
+class unique_serial {
+ public:
+  unique_serial() : value_(next()) {}
+  unique_serial(const unique_serial&) : value_(next()) {}
+
+  unique_serial& operator=(const unique_serial&) {
+    value_ = next();
+    return *this;
+  }
+
+  std::uint64_t value() const { return value_; }
+
+ private:
+  std::uint64_t value_;
+
+  static std::uint64_t next() {
+    static std::atomic<std::uint64_t> counter{0};
+    return ++counter;
+  }
+};
+
 enum match_flags {
   k_match_longest = 1 << 0,
 };
 
+/*! \brief The options of the syntax of the patterns.
+ */
+enum syntax_flags {
+  /*! \brief A char of the pattern and of the input is a character.
+   */
+  k_syntax_default = 0,
+
+  /*! \brief The pattern and the input are UTF-8 and a character is a code
+   * point.
+   *
+   * It only applies to the regexes of chars. "." is the any-character atom,
+   * while it is an ordinary character in the other syntaxes. A character
+   * category, like "." or "[^a-zé]", is compiled into the byte sequences
+   * of its code points, so the program still matches bytes and runs over raw
+   * UTF-8 with all the byte engines and no decoding. The named classes like
+   * \w stay ASCII. The input is not validated, and an invalid sequence in the
+   * input does not match ".".
+   */
+  k_syntax_utf8 = 1 << 0,
+
+  /*! \brief The groups are not read, so only the whole match is reported and
+   * the marks of the groups are removed from the program.
+   */
+  k_syntax_nosubs = 1 << 1,
+
+  /*! \brief Keep the program as parsed, without running nfa_optimizer.
+   */
+  k_syntax_no_optimize = 1 << 2,
+};
+
+inline syntax_flags operator|(syntax_flags a, syntax_flags b) {
+  return syntax_flags(unsigned(a) | unsigned(b));
+}
+
 template <class CharT, class Traits = regex_traits<CharT>>
 class basic_regex {
  public:
   typedef CharT char_type;
   typedef char_category<CharT> char_category_type;
   typedef std::basic_string<char_type> string_type;
-  typedef nfa<instruction<char_type>, std::allocator<instruction<char_type>>>
+  typedef regex::nfa<instruction<char_type>,
+                     std::allocator<instruction<char_type>>>
       nfa_type;
   typedef Traits traits_type;
+  typedef literal_prefilter<char_type> prefilter_type;
+  typedef bit_parallel_nfa<nfa_type> bit_parallel_type;
+  typedef onepass_nfa<nfa_type> onepass_type;
+  typedef packed_nfa<nfa_type> packed_type;
+  typedef epsilon_closures<nfa_type> closures_type;
 
   basic_regex() = default;
   explicit basic_regex(const CharT* s)
@@ -42,9 +119,43 @@ class basic_regex {
   basic_regex(std::initializer_list<CharT> init)
       : nfa_(make_nfa(init.begin(), init.end())) {}
 
+  basic_regex(const CharT* s, syntax_flags flags)
+      : nfa_(make_nfa(s, s + traits_type::length(s), flags)), flags_(flags) {}
+
+  template <class ST, class SA>
+  basic_regex(const std::basic_string<CharT, ST, SA>& str, syntax_flags flags)
+      : nfa_(make_nfa(str.begin(), str.end(), flags)), flags_(flags) {}
+
+  template <class ForwardIt>
+  basic_regex(ForwardIt first, ForwardIt last, syntax_flags flags)
+      : nfa_(make_nfa(first, last, flags)), flags_(flags) {}
+
+  /*! \brief Adopt nfa, a complete program compiled with flags, without
+   * parsing a pattern.
+   */
+  basic_regex(nfa_type nfa, syntax_flags flags)
+      : original_size_(nfa.size()), nfa_(std::move(nfa)), flags_(flags) {}
+
+  /*! \brief Adopt nfa with its byte classes and bit-parallel engine, which
+   * are not computed again.
+   *
+   * regex_blob loads the serialized regexes with it.
+   */
+  basic_regex(nfa_type nfa, syntax_flags flags, const byte_classes& classes,
+              bit_parallel_type bit_parallel)
+      : original_size_(nfa.size()),
+        nfa_(std::move(nfa)),
+        flags_(flags),
+        classes_(classes),
+        bit_parallel_(std::move(bit_parallel)) {}
+
+  /*! \brief Return the syntax flags the regex is compiled with.
+   */
+  syntax_flags flags() const { return flags_; }
+
   std::locale getloc() const { return loc_; }
 
-  std::locale imbue(const std::locale& loc) {
+  std::locale imbue(std::locale loc) {
     using std::swap;
     swap(loc, loc_);
     return loc;
@@ -52,26 +163,167 @@ class basic_regex {
 
   void swap(basic_regex& other) {
     using std::swap;
+    swap(original_size_, other.original_size_);
     swap(nfa_, other.nfa_);
+    swap(flags_, other.flags_);
+    swap(packed_, other.packed_);
+    swap(classes_, other.classes_);
+    swap(closures_, other.closures_);
+    swap(prefilter_, other.prefilter_);
+    swap(bit_parallel_, other.bit_parallel_);
+    swap(onepass_, other.onepass_);
+    swap(reverse_nfa_, other.reverse_nfa_);
     swap(loc_, other.loc_);
+    serial_ = unique_serial();
+    other.serial_ = unique_serial();
   }
 
-  nfa_type& nfa() { return nfa_; }
-
+  /*! \brief Return the program.
+   *
+   * It is read-only: the packed program, the classes, the closures and the
+   * other engines are derived from it when the regex is built.
+   */
   const nfa_type& nfa() const { return nfa_; }
 
+  /*! \brief Return the number of instructions of the program as parsed,
+   * before nfa_optimizer ran.
+   *
+   * A regex adopting a compiled program returns the size of that program.
+   */
+  std::size_t original_size() const { return original_size_; }
+
   unsigned mark_count() const { return nfa_.mark_count(); }
 
+  /*! \brief Get the compact form of the program, which regex_matcher runs.
+   */
+  const packed_type& packed() const { return packed_; }
+
+  /*! \brief Get the classes of the bytes that the program matches alike.
+   *
+   * The lazy DFAs index their transitions by them.
+   */
+  const byte_classes& classes() const { return classes_; }
+
+  /*! \brief Get the precomputed e-closures, which regex_matcher steps with
+   * instead of walking the gotos, the forks and the group marks.
+   */
+  const closures_type& closures() const { return closures_; }
+
+  /*! \brief Return the number identifying this regex among all the regexes
+   * ever created.
+   *
+   * The number changes when the regex is assigned or swapped, so the data
+   * derived from the program, like the match contexts, can be keyed by it.
+   */
+  std::uint64_t serial() const { return serial_.value(); }
+
+  /*! \brief Get the prefilter that skips the positions where a match cannot
+   * start.
+   *
+   * prefilter().empty() is false if the regex has a literal prefix and
+   * regex_search uses the fast path.
+   */
+  const prefilter_type& prefilter() const { return prefilter_; }
+
+  /*! \brief Get the bit-parallel engine.
+   *
+   * bit_parallel().available() is true if the regex is small enough for the
+   * boolean regex_match and regex_search to use it.
+   */
+  const bit_parallel_type& bit_parallel() const { return bit_parallel_; }
+
+  /*! \brief Return true if the regex is one-pass.
+   *
+   * Then regex_match extracts the groups with the one-pass matcher.
+   */
+  bool is_one_pass() const { return onepass_.available(); }
+
+  /*! \brief Get the one-pass matcher.
+   */
+  const onepass_type& onepass() const { return onepass_; }
+
+  /*! \brief Get the program matching the reversed strings.
+   *
+   * regex_search runs it backwards from the end of a match to find the start.
+   * Its start_id() is negative if the program is too large to be reversed.
+   */
+  const nfa_type& reverse_nfa() const { return reverse_nfa_; }
+
  private:
+  /*! \brief Declared before nfa_, which make_nfa sets it with.
+   */
+  std::size_t original_size_ = 0;
   nfa_type nfa_;
+  syntax_flags flags_ = k_syntax_default;
+  packed_type packed_{nfa_};
+  byte_classes classes_ = byte_classes::from_categories(
+      packed_.categories().begin(), packed_.categories().end(),
+      packed_.char_sets());
+  closures_type closures_{nfa_};
+  prefilter_type prefilter_ = prefilter_type::from_nfa(nfa_, nfa_.start_id());
+  bit_parallel_type bit_parallel_{nfa_, nfa_.start_id()};
+  onepass_type onepass_{nfa_, nfa_.start_id()};
+  nfa_type reverse_nfa_ = make_reverse_nfa(nfa_);
   std::locale loc_;
+  unique_serial serial_;
 
   template <class ForwardIt>
-  static nfa_type make_nfa(ForwardIt first, ForwardIt last) {
-    return regex_parser<regex_scanner<ForwardIt>, char_category_type, nfa_type>(
-               regex_scanner<ForwardIt>(first, last, std::locale()))
+  nfa_type make_nfa(ForwardIt first, ForwardIt last,
+                    syntax_flags flags = k_syntax_default) {
+    nfa_type nfa = (flags & k_syntax_utf8)
+                       ? parse<char_category<char32_t>>(
+                             first, last, std::integral_constant<
+                                              bool, sizeof(CharT) == 1>())
+                       : parse<char_category_type>(first, last,
+                                                   std::true_type());
+    add_search_loop(nfa);
+    original_size_ = nfa.size();
+    if (flags & k_syntax_no_optimize) return nfa;
+
+    unsigned passes = k_optimize_default;
+    if (flags & k_syntax_nosubs) passes |= k_optimize_groups;
+    nfa_optimizer<nfa_type> optimizer(std::move(nfa), passes, 1);
+    return std::move(optimizer.nfa());
+  }
+
+  /*! \brief Parse [first, last) with the characters of CharCategory.
+   */
+  template <class CharCategory, class ForwardIt>
+  static nfa_type parse(ForwardIt first, ForwardIt last, std::true_type) {
+    typedef regex_scanner<ForwardIt, CharCategory> scanner_type;
+    return regex_parser<scanner_type, CharCategory, nfa_type>(
+               scanner_type(first, last, std::locale()))
         .nfa();
   }
+
+  /*! \brief Parse a pattern of wide chars, which are already code points.
+   */
+  template <class CharCategory, class ForwardIt>
+  static nfa_type parse(ForwardIt first, ForwardIt last, std::false_type) {
+    return parse<char_category_type>(first, last, std::true_type());
+  }
+
+  static nfa_type make_reverse_nfa(const nfa_type& nfa) {
+    nfa_type reversed;
+    if (nfa.start_id() >= 0) {
+      regex::reverse_nfa(nfa, nfa.start_id(), reversed);
+    }
+    return reversed;
+  }
+
+  /*! \brief Append the .*? loop of the unanchored search to nfa.
+   *
+   * The loop is built once here, so that regex_search does not need to copy
+   * and modify the program for each call.
+   */
+  static void add_search_loop(nfa_type& nfa) {
+    int any_char_id = nfa.append_match_char_category(
+        char_category_type::any_char(), k_dangled);
+    int loop_id = nfa.append_fork(nfa.start_id(), any_char_id);
+    nfa[any_char_id].next = loop_id;
+    nfa.set_search_start_id(loop_id);
+    nfa.assert_complete();
+  }
 };
 }
 
@@ -0,0 +1,248 @@
+#ifndef __REGEX_AHO_CORASICK_H__
+#define __REGEX_AHO_CORASICK_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "regex_traits.h"
+
+namespace regex {
+
+/*! \brief An Aho-Corasick automaton finding the leftmost occurrence of a set
+ * of literals.
+ *
+ * The trie edges of each node are kept sorted in one flat array. The failure
+ * links are followed at scanning time, except in the root, whose transitions
+ * are precomputed for the byte-sized chars. While the automaton is in the
+ * root, the chars that cannot start a literal are skipped with memchr or a
+ * byte table.
+ */
+template <class CharT>
+class aho_corasick {
+ public:
+  typedef CharT char_type;
+  typedef std::basic_string<char_type> string_type;
+
+  aho_corasick() = default;
+
+  /*! \brief Build the automaton of the non-empty literals.
+   */
+  explicit aho_corasick(const std::vector<string_type>& literals) {
+    build(literals);
+  }
+
+  /*! \brief Return the number of the trie nodes.
+   */
+  std::size_t node_count() const { return nodes_.size(); }
+
+  /*! \brief Return the start of the leftmost occurrence of a literal in
+   * [first, last), or last if there is none.
+   */
+  template <class BidirIt>
+  BidirIt find(BidirIt first, BidirIt last) const {
+    if (nodes_.empty()) return last;
+
+    // The occurrences are found in the order of their ends, so the scanning
+    // continues until no later occurrence can start before the best one.
+    bool found = false;
+    BidirIt best_end = last;
+    std::size_t best_len = 0;
+    std::size_t since_best = 0;
+    int node = 0;
+    while (first != last) {
+      if (node == 0 && !found) {
+        first = skip(first, last);
+        if (first == last) break;
+      }
+
+      node = next(node, *first);
+      ++first;
+
+      if (found) ++since_best;
+      std::size_t len = nodes_[node].match_len;
+      if (len > 0 && (!found || len > best_len + since_best)) {
+        found = true;
+        best_end = first;
+        best_len = len;
+        since_best = 0;
+      }
+      if (found && best_len + since_best + 1 >= max_len_) break;
+    }
+
+    if (!found) return last;
+    return std::prev(best_end, best_len);
+  }
+
+ private:
+  /*! \brief A node of the trie.
+   */
+  struct node {
+    int edge_begin = 0;  //!< The first edge in edges_
+    int edge_end = 0;    //!< One past the last edge in edges_
+    int fail = 0;        //!< The failure link
+
+    /*! \brief The length of the longest literal that is a suffix of the string
+     * of the node, or 0 if there is none.
+     */
+    std::size_t match_len = 0;
+  };
+
+  std::vector<node> nodes_;
+
+  /*! \brief The trie edges, sorted by the char in each node.
+   */
+  std::vector<std::pair<char_type, int>> edges_;
+
+  /*! \brief The transitions of the root for the byte-sized chars.
+   */
+  std::vector<int> root_next_;
+
+  /*! \brief True if a literal may start with the byte.
+   */
+  std::vector<bool> first_bytes_;
+
+  /*! \brief The only first byte of the literals, or -1 if there are more.
+   */
+  int single_first_byte_ = -1;
+
+  std::size_t max_len_ = 0;
+
+  static bool is_byte_char() { return sizeof(char_type) == 1; }
+
+  /*! \brief Return the child of node n on ch, or -1.
+   */
+  int child(int n, char_type ch) const {
+    auto first = edges_.begin() + nodes_[n].edge_begin;
+    auto last = edges_.begin() + nodes_[n].edge_end;
+    auto it = std::lower_bound(
+        first, last, ch, [](const std::pair<char_type, int>& e, char_type c) {
+          return e.first < c;
+        });
+    return (it != last && it->first == ch) ? it->second : -1;
+  }
+
+  /*! \brief Return the next node of node n on ch.
+   */
+  int next(int n, char_type ch) const {
+    while (true) {
+      if (n == 0) {
+        if (is_byte_char()) return root_next_[(unsigned char)ch];
+        int c = child(0, ch);
+        return c < 0 ? 0 : c;
+      }
+      int c = child(n, ch);
+      if (c >= 0) return c;
+      n = nodes_[n].fail;
+    }
+  }
+
+  /*! \brief Skip the chars that cannot start a literal.
+   */
+  template <class BidirIt>
+  BidirIt skip(BidirIt first, BidirIt last) const {
+    if (!is_byte_char()) return first;
+    return skip(first, last,
+                std::integral_constant<
+                    bool, is_contiguous_byte_iterator<BidirIt>::value>());
+  }
+
+  template <class BidirIt>
+  BidirIt skip(BidirIt first, BidirIt last, std::false_type) const {
+    while (first != last && !first_bytes_[(unsigned char)*first]) ++first;
+    return first;
+  }
+
+  template <class BidirIt>
+  BidirIt skip(BidirIt first, BidirIt last, std::true_type) const {
+    if (first == last) return last;
+    auto begin = reinterpret_cast<const unsigned char*>(&*first);
+    const unsigned char* end = begin + (last - first);
+    const unsigned char* p = begin;
+    if (single_first_byte_ >= 0) {
+      p = static_cast<const unsigned char*>(
+          std::memchr(p, single_first_byte_, end - p));
+      if (!p) return last;
+    } else {
+      while (p != end && !first_bytes_[*p]) ++p;
+    }
+    return first + (p - begin);
+  }
+
+  void build(const std::vector<string_type>& literals) {
+    // Build the trie with a map per node, and then flatten the edges.
+    std::vector<std::map<char_type, int>> trie(1);
+    std::vector<std::size_t> terminal_len(1, 0);
+    for (auto& literal : literals) {
+      if (literal.empty()) continue;
+      int n = 0;
+      for (auto ch : literal) {
+        auto it = trie[n].find(ch);
+        if (it == trie[n].end()) {
+          int c = trie.size();
+          trie[n].emplace(ch, c);
+          trie.emplace_back();
+          terminal_len.push_back(0);
+          n = c;
+        } else {
+          n = it->second;
+        }
+      }
+      terminal_len[n] = literal.size();
+      max_len_ = std::max(max_len_, literal.size());
+    }
+    if (trie.size() == 1) return;
+
+    nodes_.resize(trie.size());
+    for (std::size_t n = 0; n < trie.size(); ++n) {
+      nodes_[n].edge_begin = edges_.size();
+      edges_.insert(edges_.end(), trie[n].begin(), trie[n].end());
+      nodes_[n].edge_end = edges_.size();
+    }
+
+    // Compute the failure links in BFS order.
+    std::deque<int> queue;
+    for (auto& e : trie[0]) {
+      nodes_[e.second].fail = 0;
+      nodes_[e.second].match_len = terminal_len[e.second];
+      queue.push_back(e.second);
+    }
+    while (!queue.empty()) {
+      int n = queue.front();
+      queue.pop_front();
+      for (auto& e : trie[n]) {
+        int c = e.second;
+        int f = nodes_[n].fail;
+        while (f != 0 && child(f, e.first) < 0) f = nodes_[f].fail;
+        int fc = child(f, e.first);
+        nodes_[c].fail = (fc >= 0 && fc != c) ? fc : 0;
+        nodes_[c].match_len = terminal_len[c] > 0
+                                  ? terminal_len[c]
+                                  : nodes_[nodes_[c].fail].match_len;
+        queue.push_back(c);
+      }
+    }
+
+    if (is_byte_char()) {
+      root_next_.assign(256, 0);
+      first_bytes_.assign(256, false);
+      for (auto& e : trie[0]) {
+        root_next_[(unsigned char)e.first] = e.second;
+        first_bytes_[(unsigned char)e.first] = true;
+      }
+      if (trie[0].size() == 1) {
+        single_first_byte_ = (unsigned char)trie[0].begin()->first;
+      }
+    }
+  }
+};
+}
+
+#endif
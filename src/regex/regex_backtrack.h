@@ -0,0 +1,208 @@
+#ifndef __REGEX_BACKTRACK_H__
+#define __REGEX_BACKTRACK_H__
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "regex_nfa.h"
+
+/*! \brief The maximum number of bits of the visited set of the backtracker.
+ *
+ * The backtracker is used only if the number of instructions times the number
+ * of positions in the input fits in the budget.
+ */
+#ifndef REGEX_BACKTRACK_BUDGET
+#define REGEX_BACKTRACK_BUDGET (256 * 1024)
+#endif
+
+namespace regex {
+
+template <class BidirIt>
+std::size_t bounded_distance(BidirIt first, BidirIt last, std::size_t max,
+                             std::random_access_iterator_tag) {
+  std::size_t length = last - first;
+  return length > max ? max + 1 : length;
+}
+
+template <class BidirIt>
+std::size_t bounded_distance(BidirIt first, BidirIt last, std::size_t max,
+                             std::bidirectional_iterator_tag) {
+  std::size_t length = 0;
+  for (; first != last && length <= max; ++first) ++length;
+  return length;
+}
+
+/*! \brief Return the length of [first, last), or max + 1 if it is longer
+ * than max.
+ *
+ * It takes O(1) with random-access iterators, and walks at most max + 1 chars
+ * with the other ones.
+ */
+template <class BidirIt>
+std::size_t bounded_distance(BidirIt first, BidirIt last, std::size_t max) {
+  return bounded_distance(
+      first, last, max,
+      typename std::iterator_traits<BidirIt>::iterator_category());
+}
+
+/*! \brief The storage of bounded_backtracker::match, which can be kept
+ * between the matches so that they do not allocate.
+ */
+template <class BidirIt, class Slot>
+struct backtrack_scratch {
+  /*! \brief A job either explores pc at the position, or restores a group
+   * slot when the thread that wrote the slot backtracks.
+   */
+  struct job {
+    int pc;
+    BidirIt pos;
+    std::size_t index;
+    unsigned group_id;
+    Slot saved;
+  };
+
+  std::vector<std::uint64_t> visited;
+  std::vector<Slot> slots;
+  std::vector<job> stack;
+};
+
+/*! \brief A backtracking matcher bounded by a visited set of (pc, position).
+ *
+ * The threads are explored depth-first in the order of priority, so the first
+ * accept reached is the leftmost-first match. A pair of an instruction and a
+ * position is explored only once: the first visit is from the thread with the
+ * highest priority, which is also the thread regex_matcher keeps. The matching
+ * takes O(program size * input length) time, and the captures are saved and
+ * restored on the job stack instead of being copied for each thread.
+ */
+template <class NFA>
+class bounded_backtracker {
+ public:
+  typedef NFA nfa_type;
+
+  /*! \brief Create a backtracker of nfa whose visited set has at most
+   * max_bits bits.
+   */
+  explicit bounded_backtracker(const nfa_type& nfa,
+                               std::size_t max_bits = REGEX_BACKTRACK_BUDGET)
+      : nfa_(nfa), max_bits_(max_bits) {}
+
+  /*! \brief Return true if the visited set of [first, last) fits in the
+   * budget, and store the length of [first, last) in length.
+   *
+   * The length takes O(1) with random-access iterators. With the other ones,
+   * it stops counting the input once the input is too long. An empty program,
+   * such as the one of a default-constructed regex, never fits.
+   */
+  template <class BidirIt>
+  bool fits(BidirIt first, BidirIt last, std::size_t& length) const {
+    if (nfa_.size() == 0 || nfa_.start_id() < 0) return false;
+    std::size_t max_positions = max_bits_ / nfa_.size();
+    if (max_positions == 0) return false;
+    length = bounded_distance(first, last, max_positions - 1);
+    return length < max_positions;
+  }
+
+  template <class BidirIt>
+  bool fits(BidirIt first, BidirIt last) const {
+    std::size_t length;
+    return fits(first, last, length);
+  }
+
+  /*! \brief Match a prefix of [first, last) with the program from start_id and
+   * write the groups to m.
+   *
+   * Return true if there is a match. [first, last) must fit in the budget.
+   */
+  template <class BidirIt, class MatchResults>
+  bool match(BidirIt first, BidirIt last, MatchResults& m, int start_id) const {
+    backtrack_scratch<BidirIt, typename MatchResults::value_type> scratch;
+    return match(first, last, m, start_id, scratch,
+                 std::distance(first, last));
+  }
+
+  /*! \brief Match like above with the storage of scratch, where length is
+   * the length of [first, last) given by fits().
+   */
+  template <class BidirIt, class MatchResults>
+  bool match(BidirIt first, BidirIt last, MatchResults& m, int start_id,
+             backtrack_scratch<BidirIt, typename MatchResults::value_type>&
+                 scratch,
+             std::size_t length) const {
+    typedef typename MatchResults::value_type slot_type;
+    typedef typename backtrack_scratch<BidirIt, slot_type>::job job;
+
+    std::size_t positions = length + 1;
+    assert(positions * nfa_.size() <= max_bits_);
+
+    auto& visited = scratch.visited;
+    auto& slots = scratch.slots;
+    auto& stack = scratch.stack;
+    visited.assign((positions * nfa_.size() + 63) / 64, 0);
+    slots.assign(nfa_.mark_count(), slot_type());
+    stack.assign(1, job{start_id, first, 0, 0, slot_type()});
+
+    while (!stack.empty()) {
+      job j = stack.back();
+      stack.pop_back();
+      if (j.pc < 0) {
+        slots[j.group_id] = j.saved;
+        continue;
+      }
+
+      int pc = j.pc;
+      BidirIt pos = j.pos;
+      std::size_t index = j.index;
+      while (true) {
+        std::size_t bit = index * nfa_.size() + pc;
+        if (visited[bit / 64] & (std::uint64_t(1) << (bit % 64))) break;
+        visited[bit / 64] |= std::uint64_t(1) << (bit % 64);
+
+        auto& insn = nfa_[pc];
+        bool alive = true;
+        switch (insn.opcode) {
+          case k_match_char_category:
+            if (pos == last || !nfa_.match(pc, *pos)) {
+              alive = false;
+            } else {
+              ++pos;
+              ++index;
+            }
+            break;
+          case k_fork:
+            stack.push_back({insn.next2, pos, index, 0, slot_type()});
+            break;
+          case k_mark_group_start:
+            stack.push_back({-1, pos, index, insn.group_id,
+                             slots[insn.group_id]});
+            slots[insn.group_id].set_first(pos);
+            break;
+          case k_mark_group_end:
+            stack.push_back({-1, pos, index, insn.group_id,
+                             slots[insn.group_id]});
+            slots[insn.group_id].set_last(pos);
+            break;
+          case k_accept:
+            m.assign(slots.begin(), slots.end());
+            m.set_ready();
+            return true;
+          default:
+            break;
+        }
+        if (!alive) break;
+        pc = insn.next;
+      }
+    }
+    return false;
+  }
+
+ private:
+  const nfa_type& nfa_;
+  std::size_t max_bits_;
+};
+}
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef __REGEX_BYTE_CLASSES_H__
+#define __REGEX_BYTE_CLASSES_H__
+
+#include <algorithm>
+#include <cstddef>
+
+namespace regex {
+
+/*! \brief A partition of the bytes into the classes that every char category
+ * of a program matches alike.
+ *
+ * Two bytes of the same class lead to the same transitions, so a table-driven
+ * engine keeps one column per class instead of one per byte. A program with a
+ * few distinct chars has a few classes.
+ */
+class byte_classes {
+ public:
+  enum {
+    k_byte_count = 256,
+  };
+
+  /*! \brief Put each byte in its own class.
+   */
+  byte_classes() {
+    for (std::size_t b = 0; b < k_byte_count; ++b) classes_[b] = b;
+  }
+
+  /*! \brief Compute the classes of the char categories in [first, last),
+   * whose sets are in sets.
+   */
+  template <class ForwardIt, class CharSetTable>
+  static byte_classes from_categories(ForwardIt first, ForwardIt last,
+                                      const CharSetTable& sets) {
+    byte_classes c;
+    for (auto& cls : c.classes_) cls = 0;
+    c.class_count_ = 1;
+    for (; first != last; ++first) c.split(*first, sets);
+    return c;
+  }
+
+  /*! \brief Make the classes of the table of the class of each byte, like
+   * the one of a serialized regex.
+   *
+   * The classes are the numbers up to the largest one in the table.
+   */
+  static byte_classes from_table(const unsigned char* table) {
+    byte_classes c;
+    std::copy(table, table + k_byte_count, c.classes_);
+    c.class_count_ = *std::max_element(table, table + k_byte_count) + 1;
+    return c;
+  }
+
+  /*! \brief Return the class of byte b.
+   */
+  unsigned char operator[](unsigned char b) const { return classes_[b]; }
+
+  /*! \brief Return the number of classes.
+   */
+  std::size_t size() const { return class_count_; }
+
+ private:
+  unsigned char classes_[k_byte_count];
+  std::size_t class_count_ = k_byte_count;
+
+  /*! \brief Split each class into the bytes matching cc and the others.
+   *
+   * The classes are renumbered in the order of their smallest bytes.
+   */
+  template <class CharCategory, class CharSetTable>
+  void split(const CharCategory& cc, const CharSetTable& sets) {
+    typedef typename CharCategory::char_type char_type;
+    int ids[k_byte_count * 2];
+    for (auto& id : ids) id = -1;
+
+    int next_id = 0;
+    for (std::size_t b = 0; b < k_byte_count; ++b) {
+      int key = classes_[b] * 2 + sets.match(cc, char_type(b));
+      if (ids[key] < 0) ids[key] = next_id++;
+      classes_[b] = ids[key];
+    }
+    class_count_ = next_id;
+  }
+};
+}
+
+#endif
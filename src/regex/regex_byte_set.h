@@ -0,0 +1,254 @@
+#ifndef __REGEX_BYTE_SET_H__
+#define __REGEX_BYTE_SET_H__
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace regex {
+
+/*! \brief A set of bytes as a 256-bit membership bitmap.
+ */
+class byte_set {
+ public:
+  enum {
+    k_byte_count = 256,
+  };
+
+  /*! \brief Create an empty set.
+   *
+   * The sets can be built in constant expressions, for static_regex.
+   */
+  constexpr byte_set() : bits_{0, 0, 0, 0} {}
+
+  constexpr bool contains(unsigned char b) const {
+    return (bits_[b >> 6] >> (b & 63)) & 1;
+  }
+
+  constexpr void insert(unsigned char b) {
+    bits_[b >> 6] |= std::uint64_t(1) << (b & 63);
+  }
+
+  /*! \brief Insert the bytes from lo to hi, both inclusive.
+   */
+  constexpr void insert_range(unsigned char lo, unsigned char hi) {
+    for (unsigned b = lo; b <= hi; ++b) insert(b);
+  }
+
+  /*! \brief Replace the set with its complement.
+   */
+  constexpr void flip() {
+    for (int i = 0; i < 4; ++i) bits_[i] = ~bits_[i];
+  }
+
+  constexpr byte_set& operator|=(const byte_set& other) {
+    for (int i = 0; i < 4; ++i) bits_[i] |= other.bits_[i];
+    return *this;
+  }
+
+  /*! \brief Return true if a byte is in both sets.
+   */
+  bool intersects(const byte_set& other) const {
+    for (int i = 0; i < 4; ++i) {
+      if (bits_[i] & other.bits_[i]) return true;
+    }
+    return false;
+  }
+
+  /*! \brief Return the number of bytes in the set.
+   */
+  std::size_t count() const {
+    std::size_t n = 0;
+    for (unsigned b = 0; b < k_byte_count; ++b) n += contains(b);
+    return n;
+  }
+
+  bool empty() const {
+    return (bits_[0] | bits_[1] | bits_[2] | bits_[3]) == 0;
+  }
+
+  bool operator==(const byte_set& other) const {
+    for (int i = 0; i < 4; ++i) {
+      if (bits_[i] != other.bits_[i]) return false;
+    }
+    return true;
+  }
+
+  bool operator!=(const byte_set& other) const { return !(*this == other); }
+
+  /*! \brief Order the sets by their bitmaps, so that they can be keys.
+   */
+  bool operator<(const byte_set& other) const {
+    for (int i = 0; i < 4; ++i) {
+      if (bits_[i] != other.bits_[i]) return bits_[i] < other.bits_[i];
+    }
+    return false;
+  }
+
+ private:
+  std::uint64_t bits_[4];
+};
+
+/*! \brief Skip the runs of bytes inside or outside a byte_set.
+ *
+ * The set is split into at most k_max_ranges ranges of bytes, or its
+ * complement is if it takes fewer ranges. Then a block of 16 bytes with SSE2,
+ * or of 32 bytes with AVX2, is tested against all the ranges at once, so a
+ * run of [a-z0-9] is skipped a block at a time. Without SIMD, or if the set
+ * takes too many ranges, the bytes are tested one by one with the bitmap.
+ */
+class byte_set_scanner {
+ public:
+  enum {
+    k_max_ranges = 4,
+  };
+
+  byte_set_scanner() = default;
+
+  explicit byte_set_scanner(const byte_set& set) : set_(set) {
+    if (!split(set, false)) split(set, true);
+  }
+
+  /*! \brief Return true if the blocks are tested with SIMD.
+   */
+  bool vectorized() const {
+#if defined(__AVX2__) || defined(__SSE2__)
+    return range_count_ > 0;
+#else
+    return false;
+#endif
+  }
+
+  /*! \brief Return the first byte of [first, last) in the set, or last.
+   */
+  const unsigned char* find(const unsigned char* first,
+                            const unsigned char* last) const {
+    return scan(first, last, true);
+  }
+
+  /*! \brief Return the first byte of [first, last) not in the set, or last.
+   */
+  const unsigned char* skip(const unsigned char* first,
+                            const unsigned char* last) const {
+    return scan(first, last, false);
+  }
+
+  const byte_set& set() const { return set_; }
+
+ private:
+  byte_set set_;
+  unsigned char lo_[k_max_ranges] = {};
+  unsigned char span_[k_max_ranges] = {};  //!< hi - lo of the ranges
+  int range_count_ = 0;
+  bool complement_ = false;  //!< The ranges are the complement of the set
+
+  /*! \brief Store the ranges of the set, or of its complement if complement
+   * is true.
+   *
+   * Return false if it takes more than k_max_ranges ranges.
+   */
+  bool split(const byte_set& set, bool complement) {
+    int n = 0;
+    unsigned b = 0;
+    while (b < byte_set::k_byte_count) {
+      if (set.contains(b) == complement) {
+        ++b;
+        continue;
+      }
+      unsigned lo = b;
+      while (b < byte_set::k_byte_count && set.contains(b) != complement) ++b;
+      if (n == k_max_ranges) {
+        range_count_ = 0;
+        return false;
+      }
+      lo_[n] = lo;
+      span_[n] = b - 1 - lo;
+      ++n;
+    }
+    // Pad with the first range so that the kernels test all the ranges.
+    for (int i = n; i < k_max_ranges && n > 0; ++i) {
+      lo_[i] = lo_[0];
+      span_[i] = span_[0];
+    }
+    range_count_ = n;
+    complement_ = complement;
+    return true;
+  }
+
+  /*! \brief Return the first byte of [first, last) whose membership is
+   * inside.
+   */
+  const unsigned char* scan(const unsigned char* first,
+                            const unsigned char* last, bool inside) const {
+#if defined(__AVX2__) || defined(__SSE2__)
+    if (range_count_ > 0) first = scan_blocks(first, last, inside);
+#endif
+    for (; first != last; ++first) {
+      if (set_.contains(*first) == inside) break;
+    }
+    return first;
+  }
+
+#if defined(__AVX2__)
+  /*! \brief Scan the whole blocks of 32 bytes, and return the first byte
+   * found or the start of the remaining bytes.
+   */
+  const unsigned char* scan_blocks(const unsigned char* first,
+                                   const unsigned char* last,
+                                   bool inside) const {
+    __m256i lo[k_max_ranges], span[k_max_ranges];
+    for (int i = 0; i < k_max_ranges; ++i) {
+      lo[i] = _mm256_set1_epi8(char(lo_[i]));
+      span[i] = _mm256_set1_epi8(char(span_[i]));
+    }
+    std::uint32_t flip = inside == complement_ ? ~std::uint32_t(0) : 0;
+    for (; last - first >= 32; first += 32) {
+      __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+      __m256i in = _mm256_setzero_si256();
+      for (int i = 0; i < k_max_ranges; ++i) {
+        // x is in [lo, lo + span] iff x - lo <= span as unsigned bytes.
+        __m256i t = _mm256_sub_epi8(x, lo[i]);
+        in = _mm256_or_si256(
+            in, _mm256_cmpeq_epi8(_mm256_min_epu8(t, span[i]), t));
+      }
+      std::uint32_t mask = std::uint32_t(_mm256_movemask_epi8(in)) ^ flip;
+      if (mask) return first + __builtin_ctz(mask);
+    }
+    return first;
+  }
+#elif defined(__SSE2__)
+  /*! \brief Scan the whole blocks of 16 bytes, and return the first byte
+   * found or the start of the remaining bytes.
+   */
+  const unsigned char* scan_blocks(const unsigned char* first,
+                                   const unsigned char* last,
+                                   bool inside) const {
+    __m128i lo[k_max_ranges], span[k_max_ranges];
+    for (int i = 0; i < k_max_ranges; ++i) {
+      lo[i] = _mm_set1_epi8(char(lo_[i]));
+      span[i] = _mm_set1_epi8(char(span_[i]));
+    }
+    unsigned flip = inside == complement_ ? 0xffff : 0;
+    for (; last - first >= 16; first += 16) {
+      __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+      __m128i in = _mm_setzero_si128();
+      for (int i = 0; i < k_max_ranges; ++i) {
+        // x is in [lo, lo + span] iff x - lo <= span as unsigned bytes.
+        __m128i t = _mm_sub_epi8(x, lo[i]);
+        in = _mm_or_si128(in, _mm_cmpeq_epi8(_mm_min_epu8(t, span[i]), t));
+      }
+      unsigned mask = unsigned(_mm_movemask_epi8(in)) ^ flip;
+      if (mask) return first + __builtin_ctz(mask);
+    }
+    return first;
+  }
+#endif
+};
+}
+
+#endif
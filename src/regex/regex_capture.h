@@ -0,0 +1,93 @@
+#ifndef __REGEX_CAPTURE_H__
+#define __REGEX_CAPTURE_H__
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace regex {
+
+/*! \brief A pool of reference-counted capture slot arrays.
+ *
+ * Each array has one slot per group and is referred by its id. The matching
+ * threads share an array until one of them writes a group mark, which copies
+ * the array first. Released arrays are recycled, so the pool stops allocating
+ * once it has grown to the peak number of live arrays.
+ */
+template <class Slot>
+class capture_pool {
+ public:
+  typedef Slot slot_type;
+
+  /*! \brief Set the number of slots per array and release all the arrays.
+   */
+  void reset(std::size_t slot_count) {
+    slot_count_ = slot_count;
+    slots_.clear();
+    refs_.clear();
+    free_.clear();
+  }
+
+  /*! \brief Return the number of slots per array.
+   */
+  std::size_t slot_count() const { return slot_count_; }
+
+  /*! \brief Allocate an array of empty slots with one reference.
+   */
+  int alloc() {
+    int id;
+    if (!free_.empty()) {
+      id = free_.back();
+      free_.pop_back();
+      std::fill(slots(id), slots(id) + slot_count_, slot_type());
+    } else {
+      id = refs_.size();
+      refs_.push_back(0);
+      slots_.resize(slots_.size() + slot_count_);
+    }
+    refs_[id] = 1;
+    return id;
+  }
+
+  /*! \brief Allocate a copy of the array id with one reference.
+   */
+  int copy(int id) {
+    int new_id = alloc();
+    std::copy(slots(id), slots(id) + slot_count_, slots(new_id));
+    return new_id;
+  }
+
+  /*! \brief Add a reference to the array id.
+   */
+  void retain(int id) {
+    assert(refs_[id] > 0);
+    ++refs_[id];
+  }
+
+  /*! \brief Drop a reference to the array id.
+   */
+  void release(int id) {
+    assert(refs_[id] > 0);
+    if (--refs_[id] == 0) free_.push_back(id);
+  }
+
+  /*! \brief Return the slots of the array id.
+   *
+   * The pointer is invalidated by alloc() and copy().
+   */
+  slot_type* slots(int id) { return slots_.data() + id * slot_count_; }
+
+  const slot_type* slots(int id) const {
+    return slots_.data() + id * slot_count_;
+  }
+
+ private:
+  std::size_t slot_count_ = 0;
+  std::vector<slot_type> slots_;
+  std::vector<unsigned> refs_;
+  std::vector<int> free_;
+};
+}
+
+#endif
@@ -1,7 +1,16 @@
 #ifndef __REGEX_CHAR_CATEGORY_H__
 #define __REGEX_CHAR_CATEGORY_H__
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "regex_byte_set.h"
 
 /*! \brief The type of the character category.
  */
@@ -9,24 +18,247 @@ enum category_type {
   k_cc_empty,        //!< Does not match any character
   k_cc_ordinary_char,  //!< A single character
   k_cc_any_char,     //!< Any character
+  k_cc_char_set,     //!< A set of characters, like [a-z]
 };
 
 
 namespace regex {
 
+/*! \brief A set of characters, like [a-z0-9_].
+ *
+ * The characters below 256 are kept in a 256-bit bitmap, so a byte-sized
+ * character is tested with a single lookup. The wider characters are kept as
+ * sorted disjoint ranges.
+ */
+template <class Char>
+class char_set {
+ public:
+  typedef Char char_type;
+  typedef typename std::make_unsigned<char_type>::type unsigned_char_type;
+  typedef std::pair<unsigned_char_type, unsigned_char_type> range_type;
+
+  /*! \brief Insert the characters from lo to hi, both inclusive.
+   */
+  void insert(char_type lo, char_type hi) {
+    unsigned_char_type ulo = lo, uhi = hi;
+    assert(ulo <= uhi);
+    if (is_byte(ulo)) {
+      unsigned_char_type top = std::min<unsigned_char_type>(
+          uhi, byte_set::k_byte_count - 1);
+      bytes_.insert_range(ulo, top);
+    }
+    if (!is_byte(uhi)) {
+      unsigned_char_type bottom = std::max(ulo, first_wide_char());
+      wide_ranges_.emplace_back(bottom, uhi);
+      merge_wide_ranges();
+    }
+  }
+
+  void insert(char_type ch) { insert(ch, ch); }
+
+  /*! \brief Insert the characters of other.
+   */
+  void insert(const char_set& other) {
+    bytes_ |= other.bytes_;
+    wide_ranges_.insert(wide_ranges_.end(), other.wide_ranges_.begin(),
+                        other.wide_ranges_.end());
+    merge_wide_ranges();
+  }
+
+  /*! \brief Insert the bytes of bytes.
+   */
+  void insert(const byte_set& bytes) { bytes_ |= bytes; }
+
+  /*! \brief Replace the set with its complement.
+   */
+  void negate() {
+    bytes_.flip();
+    std::vector<range_type> complement;
+    if (has_wide_chars()) {
+      unsigned_char_type next = first_wide_char();
+      bool done = false;
+      for (auto& r : wide_ranges_) {
+        if (r.first > next) complement.emplace_back(next, r.first - 1);
+        if (r.second == max_char()) {
+          done = true;
+          break;
+        }
+        next = r.second + 1;
+      }
+      if (!done) complement.emplace_back(next, max_char());
+    }
+    wide_ranges_ = std::move(complement);
+  }
+
+  /*! \brief Return true if ch is in the set.
+   */
+  bool match(char_type ch) const {
+    unsigned_char_type u = ch;
+    if (is_byte(u)) return bytes_.contains(u);
+    auto it = std::upper_bound(
+        wide_ranges_.begin(), wide_ranges_.end(), u,
+        [](unsigned_char_type x, const range_type& r) { return x < r.first; });
+    return it != wide_ranges_.begin() && u <= (it - 1)->second;
+  }
+
+  /*! \brief Return true if a character is in both sets.
+   */
+  bool intersects(const char_set& other) const {
+    return bytes_.intersects(other.bytes_) ||
+           wide_ranges_intersect(wide_ranges_, other.wide_ranges_);
+  }
+
+  /*! \brief Return true if the set has no character.
+   */
+  bool empty() const { return bytes_.empty() && wide_ranges_.empty(); }
+
+  /*! \brief Return true if the set has all the characters.
+   */
+  bool full() const {
+    return bytes_.count() == byte_set::k_byte_count &&
+           (!has_wide_chars() ||
+            (wide_ranges_.size() == 1 &&
+             wide_ranges_[0] == range_type(first_wide_char(), max_char())));
+  }
+
+  /*! \brief Return true if the set has a single character, which is stored
+   * in ch.
+   */
+  bool single(char_type& ch) const {
+    std::size_t n = bytes_.count();
+    if (n == 1 && wide_ranges_.empty()) {
+      unsigned b = 0;
+      while (!bytes_.contains(b)) ++b;
+      ch = char_type(b);
+      return true;
+    }
+    if (n == 0 && wide_ranges_.size() == 1 &&
+        wide_ranges_[0].first == wide_ranges_[0].second) {
+      ch = char_type(wide_ranges_[0].first);
+      return true;
+    }
+    return false;
+  }
+
+  /*! \brief Return the bytes of the set.
+   */
+  const byte_set& bytes() const { return bytes_; }
+
+  /*! \brief Return the characters of the set as sorted disjoint ranges.
+   */
+  std::vector<range_type> ranges() const {
+    std::vector<range_type> r;
+    unsigned b = 0;
+    while (b < byte_set::k_byte_count) {
+      if (!bytes_.contains(b)) {
+        ++b;
+        continue;
+      }
+      unsigned lo = b;
+      while (b < byte_set::k_byte_count && bytes_.contains(b)) ++b;
+      r.emplace_back(lo, b - 1);
+    }
+    r.insert(r.end(), wide_ranges_.begin(), wide_ranges_.end());
+    return r;
+  }
+
+  bool operator==(const char_set& other) const {
+    return bytes_ == other.bytes_ && wide_ranges_ == other.wide_ranges_;
+  }
+
+  bool operator!=(const char_set& other) const { return !(*this == other); }
+
+  bool operator<(const char_set& other) const {
+    if (bytes_ != other.bytes_) return bytes_ < other.bytes_;
+    return wide_ranges_ < other.wide_ranges_;
+  }
+
+  /*! \brief Return the largest character.
+   */
+  static unsigned_char_type max_char() {
+    return std::numeric_limits<unsigned_char_type>::max();
+  }
+
+ private:
+  /*! \brief The members below 256.
+   */
+  byte_set bytes_;
+
+  /*! \brief The members from 256, as sorted disjoint ranges.
+   */
+  std::vector<range_type> wide_ranges_;
+
+  /*! \brief Return the first character beyond the bitmap, if any.
+   */
+  static unsigned_char_type first_wide_char() {
+    return unsigned_char_type(std::size_t(byte_set::k_byte_count));
+  }
+
+  /*! \brief Return true if the characters may be beyond the bitmap.
+   */
+  static bool has_wide_chars() {
+    return std::size_t(max_char()) >= byte_set::k_byte_count;
+  }
+
+  /*! \brief Return true if u is in the bitmap.
+   */
+  static bool is_byte(unsigned_char_type u) {
+    return std::size_t(u) < byte_set::k_byte_count;
+  }
+
+  static bool wide_ranges_intersect(const std::vector<range_type>& a,
+                                    const std::vector<range_type>& b) {
+    std::size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+      if (a[i].second < b[j].first) {
+        ++i;
+      } else if (b[j].second < a[i].first) {
+        ++j;
+      } else {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /*! \brief Sort the wide ranges and merge the adjacent ones.
+   */
+  void merge_wide_ranges() {
+    std::sort(wide_ranges_.begin(), wide_ranges_.end());
+    std::size_t n = 0;
+    for (auto& r : wide_ranges_) {
+      if (n > 0 && (wide_ranges_[n - 1].second == max_char() ||
+                    r.first <= wide_ranges_[n - 1].second + 1)) {
+        wide_ranges_[n - 1].second =
+            std::max(wide_ranges_[n - 1].second, r.second);
+      } else {
+        wide_ranges_[n++] = r;
+      }
+    }
+    wide_ranges_.resize(n);
+  }
+};
+
 /*! \brief The character category.
  *
- * A character category can be a single character, a range of character or a
- * named category like [:num:].
+ * A character category can be a single character, any character or a set of
+ * characters like [a-z]. A category is two words, so that the instructions
+ * stay small: a set is only the index of the set in the char_set_table of its
+ * program.
  */
 template <class Char>
 class char_category {
  public:
   typedef Char char_type;
+  typedef typename std::make_unsigned<char_type>::type unsigned_char_type;
+  typedef std::pair<unsigned_char_type, unsigned_char_type> range_type;
+
+  static_assert(sizeof(char_type) <= sizeof(std::uint32_t),
+                "a char category keeps its character in 32 bits");
 
   /*! \brief Create a category of no character.
    */
-  char_category() : type_(k_cc_empty) {}
+  char_category() : type_(k_cc_empty), value_(0) {}
 
   /*! \brief Make a char category that matches any character.
    */
@@ -39,23 +271,69 @@ class char_category {
   static char_category ordinary_char(char_type ch) {
     char_category c;
     c.type_ = k_cc_ordinary_char;
-    c.ch_ = ch;
+    c.value_ = unsigned_char_type(ch);
+    return c;
+  }
+
+  /*! \brief Make the category of the set set_id of a char_set_table.
+   */
+  static char_category char_set(unsigned set_id) {
+    char_category c;
+    c.type_ = k_cc_char_set;
+    c.value_ = set_id;
     return c;
   }
 
-  /*! \brief Return true if ch is in the category.
+  /*! \brief Return true if ch is in the category, which is not a set.
+   *
+   * The sets are matched by their char_set_table.
    */
   bool match(char_type ch) const {
     switch (type_) {
       case k_cc_ordinary_char:
-        return ch == ch_;
+        return unsigned_char_type(ch) == value_;
       case k_cc_any_char:
         return true;
       default:
         assert(false);
+        return false;
     }
   }
 
+  /*! \brief Return the characters of the category, which is not a set, as
+   * sorted disjoint ranges.
+   */
+  std::vector<range_type> ranges() const {
+    std::vector<range_type> r;
+    if (type_ == k_cc_ordinary_char) {
+      r.emplace_back(value_, value_);
+    } else if (type_ == k_cc_any_char) {
+      r.emplace_back(0, std::numeric_limits<unsigned_char_type>::max());
+    } else {
+      assert(type_ == k_cc_empty);
+    }
+    return r;
+  }
+
+  bool operator==(const char_category& other) const {
+    return type_ == other.type_ && value_ == other.value_;
+  }
+
+  bool operator!=(const char_category& other) const {
+    return !(*this == other);
+  }
+
+  bool operator<(const char_category& other) const {
+    if (type_ != other.type_) return type_ < other.type_;
+    return value_ < other.value_;
+  }
+
+  /*! \brief Return a hash of the category, equal for equal categories.
+   */
+  std::size_t hash() const {
+    return (std::size_t(value_) << 2) ^ std::size_t(type_);
+  }
+
   /*! \brief Assert the category is not empty.
    */
   void assert_not_empty() const { assert(type_ != k_cc_empty); }
@@ -66,11 +344,106 @@ class char_category {
 
   /*! \brief Return the ordinary character.
    */
-  char_type ch() const { return ch_; }
+  char_type ch() const { return char_type(unsigned_char_type(value_)); }
+
+  /*! \brief Return the index of the set in its char_set_table.
+   */
+  unsigned set_id() const {
+    assert(type_ == k_cc_char_set);
+    return value_;
+  }
 
  private:
   category_type type_;
-  char_type ch_;
+
+  /*! \brief The ordinary character, or the index of the set.
+   */
+  std::uint32_t value_;
+};
+
+/*! \brief The sets of characters of a program, which its char categories
+ * refer to by index.
+ *
+ * The sets are large, and many instructions match the same set, like the
+ * repeated [0-9] of an address or the byte ranges of UTF-8, so each distinct
+ * set is kept once, out of the instructions.
+ */
+template <class Char>
+class char_set_table {
+ public:
+  typedef Char char_type;
+  typedef char_category<char_type> char_category_type;
+  typedef regex::char_set<char_type> char_set_type;
+  typedef typename char_category_type::range_type range_type;
+
+  /*! \brief Return the category of set, adding the set if needed.
+   *
+   * A set of a single character is an ordinary char, and a set of all the
+   * characters is any char, which the other engines and the literal
+   * prefilter know better.
+   */
+  char_category_type add(const char_set_type& set) {
+    char_type ch;
+    if (set.full()) return char_category_type::any_char();
+    if (set.single(ch)) return char_category_type::ordinary_char(ch);
+
+    auto it = ids_.find(set);
+    if (it != ids_.end()) return char_category_type::char_set(it->second);
+    unsigned id = sets_.size();
+    sets_.push_back(set);
+    ids_.emplace(set, id);
+    return char_category_type::char_set(id);
+  }
+
+  /*! \brief Return the number of sets.
+   */
+  std::size_t size() const { return sets_.size(); }
+
+  /*! \brief Return the set set_id.
+   */
+  const char_set_type& operator[](unsigned set_id) const {
+    return sets_[set_id];
+  }
+
+  /*! \brief Return true if ch is in cc.
+   */
+  bool match(const char_category_type& cc, char_type ch) const {
+    if (cc.type() == k_cc_char_set) return sets_[cc.set_id()].match(ch);
+    return cc.match(ch);
+  }
+
+  /*! \brief Return true if a character is in both categories.
+   */
+  bool intersects(const char_category_type& a,
+                  const char_category_type& b) const {
+    if (a.type() == k_cc_empty || b.type() == k_cc_empty) return false;
+    if (a.type() == k_cc_char_set && b.type() == k_cc_char_set) {
+      return sets_[a.set_id()].intersects(sets_[b.set_id()]);
+    }
+    if (a.type() == k_cc_char_set) return intersects_set(b, sets_[a.set_id()]);
+    if (b.type() == k_cc_char_set) return intersects_set(a, sets_[b.set_id()]);
+    if (a.type() == k_cc_any_char || b.type() == k_cc_any_char) return true;
+    return a.ch() == b.ch();
+  }
+
+  /*! \brief Return the characters of cc as sorted disjoint ranges.
+   */
+  std::vector<range_type> ranges(const char_category_type& cc) const {
+    if (cc.type() == k_cc_char_set) return sets_[cc.set_id()].ranges();
+    return cc.ranges();
+  }
+
+ private:
+  std::vector<char_set_type> sets_;
+  std::map<char_set_type, unsigned> ids_;
+
+  /*! \brief Return true if a character of set is in cc, which is not a set.
+   */
+  static bool intersects_set(const char_category_type& cc,
+                             const char_set_type& set) {
+    if (cc.type() == k_cc_ordinary_char) return set.match(cc.ch());
+    return !set.empty();
+  }
 };
 }
 
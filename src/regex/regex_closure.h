@@ -0,0 +1,202 @@
+#ifndef __REGEX_CLOSURE_H__
+#define __REGEX_CLOSURE_H__
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "regex_nfa.h"
+
+namespace regex {
+
+/*! \brief A candidate of a precomputed e-closure.
+ */
+struct closure_entry {
+  /*! \brief The instruction of k_match_char_category or k_accept.
+   */
+  int pc;
+
+  /*! \brief The group marks on the path to pc, in writes_[first_write,
+   * first_write + write_count) of epsilon_closures.
+   *
+   * The entries with the same marks share first_write, so the matcher copies
+   * the capture slots once for all of them, as it does when it walks the
+   * marks.
+   */
+  unsigned first_write;
+  unsigned write_count;
+};
+
+/*! \brief The e-closures of the instructions a matching thread can resume
+ * from, computed once for the program.
+ *
+ * The e-closure of pc is the ordered list of the candidates reached from pc
+ * through k_goto, k_advance, k_fork and the group marks, in the priority
+ * order matcher_scratch::add_to_closure visits them, with the group marks on
+ * the way to each of them. They are computed for the start instructions and
+ * for the next instruction of each k_match_char_category, so the matcher
+ * steps with a lookup and the slot writes instead of walking the chains.
+ *
+ * A candidate already in the closure of the step is skipped by the matcher.
+ * The walk stops at the instructions already visited in the step, and all
+ * the candidates reachable from them are in the closure already, so this
+ * keeps the same candidates in the same order.
+ *
+ * If the closures take more than k_max_entries_per_insn entries per
+ * instruction, like in a large alternation under a star, they are not kept
+ * and available() is false.
+ */
+template <class NFA>
+class epsilon_closures {
+ public:
+  typedef NFA nfa_type;
+
+  enum {
+    k_max_entries_per_insn = 32,
+    k_min_max_entries = 1 << 12,
+    k_none = -1,
+  };
+
+  /*! \brief A write of a group mark, group_id * 2 + 1 for the end of the
+   * group and group_id * 2 for the start.
+   */
+  typedef unsigned write_type;
+
+  epsilon_closures() = default;
+
+  /*! \brief Compute the closures of nfa, which must be complete.
+   */
+  explicit epsilon_closures(const nfa_type& nfa) {
+    std::size_t max_entries = k_max_entries_per_insn * nfa.size();
+    if (max_entries < k_min_max_entries) max_entries = k_min_max_entries;
+
+    offsets_.assign(nfa.size(), k_none);
+    std::vector<int> sources;
+    if (nfa.start_id() >= 0) sources.push_back(nfa.start_id());
+    if (nfa.search_start_id() >= 0) sources.push_back(nfa.search_start_id());
+    for (auto& insn : nfa) {
+      if (insn.opcode == k_match_char_category) sources.push_back(insn.next);
+    }
+
+    std::vector<unsigned> visited(nfa.size(), 0);
+    unsigned stamp = 0;
+    std::vector<std::pair<int, unsigned>> stack;
+    std::vector<write_type> path;
+    for (int source : sources) {
+      if (offsets_[source] != k_none) continue;
+      offsets_[source] = ranges_.size();
+      ranges_.emplace_back(entries_.size(), 0);
+
+      ++stamp;
+      stack.emplace_back(source, 0);
+      while (!stack.empty()) {
+        int pc = stack.back().first;
+        path.resize(stack.back().second);
+        stack.pop_back();
+        if (visited[pc] == stamp) continue;
+        visited[pc] = stamp;
+
+        auto& insn = nfa[pc];
+        switch (insn.opcode) {
+          case k_match_char_category:
+          case k_accept:
+            add_entry(pc, path);
+            break;
+          case k_goto:
+          case k_advance:
+            stack.emplace_back(insn.next, path.size());
+            break;
+          case k_fork:
+            stack.emplace_back(insn.next2, path.size());
+            stack.emplace_back(insn.next, path.size());
+            break;
+          case k_mark_group_start:
+          case k_mark_group_end:
+            path.push_back(insn.group_id * 2 +
+                           (insn.opcode == k_mark_group_end));
+            stack.emplace_back(insn.next, path.size());
+            break;
+          default:
+            assert(false);
+        }
+      }
+      ranges_.back().second = entries_.size();
+
+      if (entries_.size() > max_entries) {
+        *this = epsilon_closures();
+        return;
+      }
+    }
+  }
+
+  /*! \brief Return true if the closures have been computed.
+   */
+  bool available() const { return !ranges_.empty(); }
+
+  /*! \brief Return true if the closure of pc has been computed.
+   */
+  bool contains(int pc) const {
+    return std::size_t(pc) < offsets_.size() && offsets_[pc] != k_none;
+  }
+
+  /*! \brief Return the first entry of the closure of pc.
+   */
+  const closure_entry* begin(int pc) const {
+    return entries_.data() + ranges_[offsets_[pc]].first;
+  }
+
+  /*! \brief Return the entry after the last one of the closure of pc.
+   */
+  const closure_entry* end(int pc) const {
+    return entries_.data() + ranges_[offsets_[pc]].second;
+  }
+
+  /*! \brief Return the writes of the group marks of e.
+   */
+  const write_type* writes(const closure_entry& e) const {
+    return writes_.data() + e.first_write;
+  }
+
+  /*! \brief Return the total number of entries of all the closures.
+   */
+  std::size_t entry_count() const { return entries_.size(); }
+
+ private:
+  /*! \brief The index in ranges_ of the closure of each instruction, or
+   * k_none.
+   */
+  std::vector<int> offsets_;
+
+  /*! \brief The entries of each closure in entries_.
+   */
+  std::vector<std::pair<unsigned, unsigned>> ranges_;
+  std::vector<closure_entry> entries_;
+  std::vector<write_type> writes_;
+
+  /*! \brief Append the entry of pc reached through the marks of path to the
+   * last closure.
+   */
+  void add_entry(int pc, const std::vector<write_type>& path) {
+    closure_entry e{pc, unsigned(writes_.size()), unsigned(path.size())};
+    if (!path.empty()) {
+      if (entries_.size() > ranges_.back().first &&
+          same_writes(entries_.back(), path)) {
+        e.first_write = entries_.back().first_write;
+      } else {
+        writes_.insert(writes_.end(), path.begin(), path.end());
+      }
+    }
+    entries_.push_back(e);
+  }
+
+  bool same_writes(const closure_entry& e,
+                   const std::vector<write_type>& path) const {
+    return e.write_count == path.size() &&
+           std::equal(path.begin(), path.end(), writes(e));
+  }
+};
+}
+
+#endif
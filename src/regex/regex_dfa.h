@@ -0,0 +1,532 @@
+#ifndef __REGEX_DFA_H__
+#define __REGEX_DFA_H__
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <map>
+#include <type_traits>
+#include <vector>
+
+#include "regex_byte_classes.h"
+#include "regex_byte_set.h"
+#include "regex_nfa.h"
+#include "regex_prefilter.h"
+#include "regex_traits.h"
+
+namespace regex {
+
+/*! \brief The result of running the lazy DFA.
+ */
+enum dfa_status {
+  k_dfa_no_match,  //!< The input does not match
+  k_dfa_match,     //!< The input matches
+  k_dfa_gave_up,   //!< The state cache thrashed, use regex_matcher instead
+};
+
+/*! \brief The kind of the match the DFA looks for.
+ */
+enum dfa_match_kind {
+  /*! \brief The match preferred by the leftmost-first priority rules.
+   */
+  k_dfa_leftmost_first,
+
+  /*! \brief The longest match, whatever the priorities are.
+   */
+  k_dfa_longest,
+
+  /*! \brief All the accepts, for find_all.
+   */
+  k_dfa_all,
+};
+
+/*! \brief A DFA built lazily from the NFA by subset construction.
+ *
+ * A DFA state is the ordered list of the candidates (the instructions of
+ * k_match_char_category and k_accept) that regex_matcher would hold at a
+ * position, so the DFA follows the same leftmost-first priority rules. The
+ * candidates after the first k_accept are dropped, just like regex_matcher
+ * discards the lower-priority candidates when it reaches an accept.
+ *
+ * The states and the transitions are computed the first time they are needed
+ * and cached. When the cache holds max_states states, it is flushed except for
+ * the start state and the current state. If the cache keeps being flushed
+ * without making enough progress on the input, the DFA gives up and the caller
+ * should fall back to regex_matcher.
+ *
+ * With k_dfa_longest and k_dfa_all, the candidates after k_accept are kept, so
+ * the DFA runs until no candidate is left and finds the end of the longest
+ * match, or all the patterns of the accepts with find_all.
+ *
+ * The DFA only tracks where the match ends. It does not track the groups.
+ *
+ * When a state loops on itself, like the state inside [a-z0-9]+, the bytes it
+ * loops on are collected into a byte_set_scanner, and on contiguous bytes the
+ * whole run of them is skipped a SIMD block at a time.
+ */
+template <class NFA>
+class lazy_dfa {
+ public:
+  typedef NFA nfa_type;
+  typedef typename nfa_type::char_type char_type;
+
+  enum {
+    /*! \brief The default maximum number of cached states.
+     */
+    k_default_max_states = 2048,
+
+    /*! \brief The minimum number of chars per state created before a flush
+     * is considered as thrashing.
+     */
+    k_min_chars_per_state = 10,
+
+    /*! \brief The number of flushes allowed before the DFA may give up.
+     */
+    k_min_flushes = 3,
+  };
+
+  /*! \brief Create a DFA running nfa from the instruction start_id.
+   */
+  lazy_dfa(const nfa_type& nfa, int start_id,
+           std::size_t max_states = k_default_max_states)
+      : nfa_(nfa),
+        start_id_(start_id),
+        max_states_(max_states < 3 ? 3 : max_states) {}
+
+  /*! \brief Set the kind of the match to look for.
+   *
+   * It must be called before the first call of find.
+   */
+  void set_match_kind(dfa_match_kind kind) {
+    assert(states_.empty());
+    match_kind_ = kind;
+  }
+
+  /*! \brief Skip to the candidates of prefilter whenever the DFA is in the
+   * start state.
+   *
+   * This is only valid for the unanchored search program, which returns to
+   * the start state whenever no match is in progress.
+   */
+  void set_prefilter(const literal_prefilter<char_type>* prefilter) {
+    prefilter_ = prefilter;
+  }
+
+  /*! \brief Index the transitions of byte-sized chars by the classes of
+   * classes instead of by the bytes.
+   *
+   * classes must be computed from the char categories of the program. It must
+   * be called before the first call of find.
+   */
+  void set_byte_classes(const byte_classes* classes) {
+    assert(states_.empty());
+    classes_ = classes;
+    class_count_ = classes ? classes->size() : k_byte_transitions;
+  }
+
+  /*! \brief Find the end of the match starting at first.
+   *
+   * If the input matches, the end of the match is stored in match_end.
+   */
+  template <class BidirIt>
+  dfa_status find(BidirIt first, BidirIt last, BidirIt& match_end) {
+    return find_from(start(), first, last, match_end);
+  }
+
+  /*! \brief Find the end of the match from the state s at first.
+   *
+   * If the input matches, the end of the match is stored in match_end.
+   */
+  template <class BidirIt>
+  dfa_status find_from(int s, BidirIt first, BidirIt last,
+                       BidirIt& match_end) {
+    bool found = false;
+    while (true) {
+      if (states_[s].is_match) {
+        match_end = first;
+        found = true;
+      }
+      if (states_[s].pcs.empty() || first == last) break;
+      if (s == start_state_ && prefilter_) {
+        first = prefilter_->find(first, last);
+        if (first == last) break;
+      }
+      if (states_[s].accel >= 0) {
+        first = skip_loop(s, first, last, contiguous<BidirIt>());
+        if (states_[s].is_match) match_end = first;
+        if (first == last) break;
+      }
+
+      unsigned flushes = flush_count_;
+      int t = next(s, *first);
+      if (t == k_unknown) return k_dfa_gave_up;
+      if (t == s && flushes == flush_count_ && !states_[s].analyzed &&
+          is_contiguous_byte_iterator<BidirIt>::value) {
+        analyze_loop(s);
+      }
+      s = t;
+      ++first;
+    }
+
+    return found ? k_dfa_match : k_dfa_no_match;
+  }
+
+  /*! \brief Find the patterns of all the accepts reached in [first, last).
+   *
+   * The DFA must look for k_dfa_all. matched[id] is set for the pattern id of
+   * each accept reached. It stops early once all the patterns have matched.
+   * Return k_dfa_match if a pattern not yet in matched has matched.
+   */
+  template <class BidirIt>
+  dfa_status find_all(BidirIt first, BidirIt last, std::vector<bool>& matched) {
+    assert(match_kind_ == k_dfa_all);
+    std::size_t remaining = std::count(matched.begin(), matched.end(), false);
+    bool found = false;
+    int s = start();
+    while (remaining > 0) {
+      if (states_[s].is_match) {
+        for (int pc : states_[s].pcs) {
+          auto& insn = nfa_[pc];
+          if (insn.opcode == k_accept && !matched[insn.group_id]) {
+            matched[insn.group_id] = true;
+            --remaining;
+            found = true;
+          }
+        }
+      }
+      if (states_[s].pcs.empty() || first == last) break;
+
+      s = next(s, *first);
+      if (s == k_unknown) return k_dfa_gave_up;
+      ++first;
+    }
+
+    return found ? k_dfa_match : k_dfa_no_match;
+  }
+
+  /*! \brief Return the id of the start state.
+   */
+  int start() {
+    if (start_state_ == k_unknown) start_state_ = start_state();
+    return start_state_;
+  }
+
+  /*! \brief Return the id of the state of the candidates pcs.
+   *
+   * pcs are the candidates of a state of a DFA of the same program and the
+   * same match kind, possibly another instance.
+   */
+  int state_of(std::vector<int> pcs) { return intern(std::move(pcs)); }
+
+  /*! \brief Return the candidates of the state s, which identify the state
+   * across the DFAs of the same program.
+   */
+  const std::vector<int>& candidates(int s) const { return states_[s].pcs; }
+
+  /*! \brief Return true if the state s contains an accept.
+   */
+  bool is_match(int s) const { return states_[s].is_match; }
+
+  /*! \brief Return true if no char can be matched from the state s.
+   */
+  bool is_dead(int s) const { return states_[s].pcs.empty(); }
+
+  /*! \brief Return the state after s on ch, or k_unknown if the DFA gives up.
+   *
+   * The cache may be flushed, after which the ids of the states except the
+   * start state and the returned state are invalid.
+   */
+  int next(int s, char_type ch) {
+    int t = transition(s, ch);
+    if (t == k_unknown) {
+      if (states_.size() >= max_states_) {
+        s = flush(s, chars_);
+        if (s == k_unknown) return k_unknown;
+        chars_ = 0;
+      }
+      t = add_transition(s, ch);
+    }
+    ++chars_;
+    return t;
+  }
+
+  /*! \brief Return the number of the cached states.
+   */
+  std::size_t state_count() const { return states_.size(); }
+
+  /*! \brief Return the number of times the cache has been flushed.
+   */
+  unsigned flush_count() const { return flush_count_; }
+
+  /*! \brief Return the number of the cached states whose runs are skipped
+   * with SIMD.
+   */
+  std::size_t accelerated_count() const { return loops_.size(); }
+
+  enum {
+    k_unknown = -1,  //!< The transition has not been computed
+  };
+
+ private:
+  /*! \brief The number of the transitions of each state for byte-sized chars.
+   */
+  static const std::size_t k_byte_transitions = 256;
+
+  /*! \brief A state of the DFA.
+   */
+  struct state {
+    /*! \brief The candidates in priority order.
+     */
+    std::vector<int> pcs;
+
+    /*! \brief True if the state contains k_accept.
+     */
+    bool is_match;
+
+    /*! \brief The transitions of wide chars.
+     *
+     * The transitions of byte-sized chars are kept in lazy_dfa::transitions_.
+     */
+    std::map<char_type, int> wide_next;
+
+    /*! \brief True if the bytes the state loops on have been collected.
+     */
+    bool analyzed;
+
+    /*! \brief The index of the scanner of the bytes the state loops on in
+     * lazy_dfa::loops_, or -1.
+     */
+    int accel;
+  };
+
+  const nfa_type& nfa_;
+  int start_id_;
+  std::size_t max_states_;
+
+  std::vector<state> states_;
+  std::map<std::vector<int>, int> state_ids_;
+  std::vector<int> transitions_;
+  std::vector<byte_set_scanner> loops_;
+  int start_state_ = k_unknown;
+  unsigned flush_count_ = 0;
+
+  /*! \brief The number of chars matched since the last flush.
+   */
+  std::size_t chars_ = 0;
+  dfa_match_kind match_kind_ = k_dfa_leftmost_first;
+  const literal_prefilter<char_type>* prefilter_ = nullptr;
+
+  /*! \brief The classes indexing the transitions of byte-sized chars, or null
+   * to index them by the bytes.
+   */
+  const byte_classes* classes_ = nullptr;
+
+  /*! \brief The number of the transitions of each state for byte-sized chars.
+   */
+  std::size_t class_count_ = k_byte_transitions;
+
+  /*! \brief The closure stamps of the NFA instructions.
+   *
+   * Instruction i has been visited by the current closure computation iff
+   * visited_[i] == stamp_.
+   */
+  std::vector<unsigned> visited_;
+  unsigned stamp_ = 0;
+  std::vector<int> stack_;
+
+  static bool is_byte_char() { return sizeof(char_type) == 1; }
+
+  /*! \brief Return the index of the transition of state s on the byte ch.
+   */
+  std::size_t byte_transition(int s, char_type ch) const {
+    unsigned char b = ch;
+    return s * class_count_ + (classes_ ? (*classes_)[b] : b);
+  }
+
+  /*! \brief Return the cached transition of state s on ch.
+   */
+  int transition(int s, char_type ch) const {
+    if (is_byte_char()) {
+      return transitions_[byte_transition(s, ch)];
+    }
+    auto& next = states_[s].wide_next;
+    auto it = next.find(ch);
+    return it == next.end() ? int(k_unknown) : it->second;
+  }
+
+  /*! \brief Compute and cache the transition of state s on ch.
+   */
+  int add_transition(int s, char_type ch) {
+    std::vector<int> pcs;
+    begin_closure();
+    for (int pc : states_[s].pcs) {
+      auto& insn = nfa_[pc];
+      if (insn.opcode == k_match_char_category && nfa_.match(pc, ch)) {
+        add_to_closure(pcs, insn.next);
+      }
+    }
+
+    int t = intern(std::move(pcs));
+    if (is_byte_char()) {
+      transitions_[byte_transition(s, ch)] = t;
+    } else {
+      states_[s].wide_next[ch] = t;
+    }
+    return t;
+  }
+
+  /*! \brief Compute the start state.
+   */
+  int start_state() {
+    std::vector<int> pcs;
+    begin_closure();
+    // The start state of an empty program is the dead state.
+    if (start_id_ >= 0) add_to_closure(pcs, start_id_);
+    return intern(std::move(pcs));
+  }
+
+  void begin_closure() {
+    // The DFA allocates nothing until it runs, so that it is cheap to create
+    // a DFA that is not used.
+    if (visited_.empty()) visited_.assign(nfa_.size(), 0);
+    if (++stamp_ == 0) {
+      std::fill(visited_.begin(), visited_.end(), 0);
+      stamp_ = 1;
+    }
+  }
+
+  /*! \brief Add the candidates of the e-closure of pc to pcs in priority
+   * order.
+   *
+   * It visits the instructions in the same order as
+   * matcher_scratch::add_to_closure.
+   */
+  void add_to_closure(std::vector<int>& pcs, int pc) {
+    stack_.push_back(pc);
+    while (!stack_.empty()) {
+      pc = stack_.back();
+      stack_.pop_back();
+      if (visited_[pc] == stamp_) continue;
+      visited_[pc] = stamp_;
+
+      auto& insn = nfa_[pc];
+      switch (insn.opcode) {
+        case k_match_char_category:
+        case k_accept:
+          pcs.push_back(pc);
+          break;
+        case k_goto:
+        case k_advance:
+        case k_mark_group_start:
+        case k_mark_group_end:
+          stack_.push_back(insn.next);
+          break;
+        case k_fork:
+          stack_.push_back(insn.next2);
+          stack_.push_back(insn.next);
+          break;
+        default:
+          assert(false);
+      }
+    }
+  }
+
+  /*! \brief Return the id of the state of the candidates pcs.
+   *
+   * The candidates after the first k_accept are dropped unless the DFA looks
+   * for the longest match.
+   */
+  int intern(std::vector<int> pcs) {
+    bool is_match = false;
+    for (std::size_t i = 0; i < pcs.size(); ++i) {
+      if (nfa_[pcs[i]].opcode == k_accept) {
+        if (match_kind_ == k_dfa_leftmost_first) pcs.resize(i + 1);
+        is_match = true;
+        break;
+      }
+    }
+
+    auto it = state_ids_.find(pcs);
+    if (it != state_ids_.end()) return it->second;
+
+    int id = states_.size();
+    state_ids_.emplace(pcs, id);
+    states_.push_back(state{std::move(pcs), is_match, {}, false, -1});
+    if (is_byte_char()) {
+      transitions_.resize(states_.size() * class_count_, k_unknown);
+    }
+    return id;
+  }
+
+  /*! \brief Collect the bytes the state s loops on, and make a scanner to
+   * skip them if they can be scanned with SIMD.
+   *
+   * The transitions of s on all the bytes are computed, so it is only done
+   * with byte classes and if the cache has room for the new states.
+   */
+  void analyze_loop(int s) {
+    states_[s].analyzed = true;
+    if (!is_byte_char() || !classes_ || (s == start_state_ && prefilter_) ||
+        states_.size() + class_count_ > max_states_) {
+      return;
+    }
+
+    byte_set loop;
+    for (unsigned b = 0; b < byte_set::k_byte_count; ++b) {
+      int t = transition(s, char_type(b));
+      if (t == k_unknown) t = add_transition(s, char_type(b));
+      if (t == s) loop.insert(b);
+    }
+
+    byte_set_scanner scanner(loop);
+    if (!scanner.vectorized()) return;
+    states_[s].accel = loops_.size();
+    loops_.push_back(scanner);
+  }
+
+  template <class BidirIt>
+  using contiguous =
+      std::integral_constant<bool, is_contiguous_byte_iterator<BidirIt>::value>;
+
+  /*! \brief Skip the bytes from first the state s loops on.
+   */
+  template <class BidirIt>
+  BidirIt skip_loop(int s, BidirIt first, BidirIt last, std::true_type) {
+    auto& scanner = loops_[states_[s].accel];
+    auto p = reinterpret_cast<const unsigned char*>(&*first);
+    if (!scanner.set().contains(*p)) return first;
+    auto q = scanner.skip(p, p + (last - first));
+    chars_ += q - p;
+    return first + (q - p);
+  }
+
+  template <class BidirIt>
+  BidirIt skip_loop(int, BidirIt first, BidirIt, std::false_type) {
+    return first;
+  }
+
+  /*! \brief Flush the cache but keep the state s.
+   *
+   * Return the new id of the state s, or k_unknown if the DFA should give up
+   * because the cache is thrashing.
+   */
+  int flush(int s, std::size_t chars) {
+    ++flush_count_;
+    if (flush_count_ > k_min_flushes &&
+        chars < k_min_chars_per_state * states_.size()) {
+      return k_unknown;
+    }
+
+    std::vector<int> pcs = std::move(states_[s].pcs);
+    states_.clear();
+    state_ids_.clear();
+    transitions_.clear();
+    loops_.clear();
+    start_state_ = start_state();
+    return intern(std::move(pcs));
+  }
+};
+}
+
+#endif
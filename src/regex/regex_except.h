@@ -14,6 +14,11 @@ enum error_code {
   k_missing_right_group,
   k_missing_atom,
   k_unexpected_token,
+  k_missing_right_bracket,
+  k_bad_range,
+  k_bad_char_class,
+  k_bad_utf8,
+  k_bad_program,
 };
 
 /*! \brief The error class for regex.
@@ -33,6 +38,21 @@ class regex_error final : public std::exception {
       case k_escape_bad_char:
         what_ += "character cannot be escaped";
         break;
+      case k_missing_right_bracket:
+        what_ += "missing ']'";
+        break;
+      case k_bad_range:
+        what_ += "bad range in brackets";
+        break;
+      case k_bad_char_class:
+        what_ += "unknown character class";
+        break;
+      case k_bad_utf8:
+        what_ += "invalid UTF-8 sequence";
+        break;
+      case k_bad_program:
+        what_ += "invalid or incompatible serialized program";
+        break;
       default:
         what_ += "unknown error";
         break;
@@ -49,7 +69,8 @@ class regex_error final : public std::exception {
 #if REGEX_ENABLE_EXCEPTION
 #define regex_throw(err, pos) throw ::regex::regex_error(err, pos)
 #else
-#define regex_throw(err, pos) ::std::terminate()
+#define regex_throw(err, pos) \
+  (static_cast<void>(err), static_cast<void>(pos), ::std::terminate())
 #endif
 
 #endif
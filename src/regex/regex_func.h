@@ -1,39 +1,434 @@
 #ifndef __REGEX_FUNC_H__
 #define __REGEX_FUNC_H__
 
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <unordered_map>
+
 #include "regex.h"
+#include "regex_backtrack.h"
+#include "regex_bit_parallel.h"
+#include "regex_dfa.h"
 #include "regex_match_results.h"
 #include "regex_matcher.h"
+#include "regex_onepass.h"
+
+/*! \brief The number of the match contexts kept by each thread for each
+ * iterator type.
+ *
+ * A context takes about 1 KB, plus the DFA states built for its regex.
+ */
+#ifndef REGEX_THREAD_MATCH_CONTEXTS
+#define REGEX_THREAD_MATCH_CONTEXTS 256
+#endif
 
 namespace regex {
 
+/*! \brief The lazy DFAs of a regex, kept between the matches so that their
+ * states are computed only once.
+ *
+ * A cache must not be used by more than one thread at a time.
+ */
+template <class Regex>
+class regex_cache {
+ public:
+  typedef Regex regex_type;
+  typedef lazy_dfa<typename regex_type::nfa_type> dfa_type;
+
+  explicit regex_cache(const regex_type& e)
+      : match_dfa_(e.nfa(), e.nfa().start_id()),
+        search_dfa_(e.nfa(), e.nfa().search_start_id()),
+        reverse_dfa_(e.reverse_nfa(), e.reverse_nfa().start_id()) {
+    search_dfa_.set_prefilter(&e.prefilter());
+    reverse_dfa_.set_match_kind(k_dfa_longest);
+    match_dfa_.set_byte_classes(&e.classes());
+    search_dfa_.set_byte_classes(&e.classes());
+    reverse_dfa_.set_byte_classes(&e.classes());
+  }
+
+  /*! \brief Return the DFA of the program from start_id().
+   */
+  dfa_type& match_dfa() { return match_dfa_; }
+
+  /*! \brief Return the DFA of the search program, which skips to the
+   * candidates of the prefilter.
+   */
+  dfa_type& search_dfa() { return search_dfa_; }
+
+  /*! \brief Return the DFA of the reversed program for the longest match.
+   *
+   * It must not be used if reverse_nfa().start_id() is negative.
+   */
+  dfa_type& reverse_dfa() { return reverse_dfa_; }
+
+ private:
+  dfa_type match_dfa_;
+  dfa_type search_dfa_;
+  dfa_type reverse_dfa_;
+};
+
+/*! \brief The lazy DFAs of a regex and the storage of the matchers, kept
+ * between the matches of [first, last) ranges of BidirIt.
+ *
+ * Once the DFA states and the storage have grown to what the inputs need,
+ * regex_match and regex_search with a context do not allocate. Many threads
+ * may share one regex, but a context must not be used by more than one thread
+ * at a time. thread_match_context keeps a context per thread.
+ */
+template <class Regex, class BidirIt>
+class match_context : public regex_cache<Regex> {
+ public:
+  typedef sub_match<BidirIt> slot_type;
+  typedef matcher_scratch<slot_type> matcher_scratch_type;
+  typedef backtrack_scratch<BidirIt, slot_type> backtrack_scratch_type;
+  typedef onepass_scratch<slot_type> onepass_scratch_type;
+
+  explicit match_context(const Regex& e) : regex_cache<Regex>(e) {}
+
+  /*! \brief Return the storage of regex_matcher.
+   */
+  matcher_scratch_type& matcher() { return matcher_; }
+
+  /*! \brief Return the storage of bounded_backtracker.
+   */
+  backtrack_scratch_type& backtrack() { return backtrack_; }
+
+  /*! \brief Return the storage of onepass_nfa.
+   */
+  onepass_scratch_type& onepass() { return onepass_; }
+
+ private:
+  matcher_scratch_type matcher_;
+  backtrack_scratch_type backtrack_;
+  onepass_scratch_type onepass_;
+};
+
+/*! \brief The least recently used match contexts of the regexes, keyed by
+ * their serial numbers.
+ *
+ * A context is kept until capacity contexts of more recently used regexes are
+ * kept, even if its regex is destroyed.
+ */
+template <class Context>
+class match_context_pool {
+ public:
+  typedef Context context_type;
+
+  explicit match_context_pool(std::size_t capacity)
+      : capacity_(capacity ? capacity : 1) {}
+
+  /*! \brief Return the context of e, and make it the most recently used.
+   *
+   * If e has no context, the least recently used one is dropped when the pool
+   * is full.
+   */
+  template <class Regex>
+  context_type& get(const Regex& e) {
+    auto found = index_.find(e.serial());
+    if (found != index_.end()) {
+      if (found->second != entries_.begin()) {
+        entries_.splice(entries_.begin(), entries_, found->second);
+      }
+      return found->second->context;
+    }
+
+    if (entries_.size() == capacity_) {
+      index_.erase(entries_.back().serial);
+      entries_.pop_back();
+    }
+    entries_.emplace_front(e);
+    index_.emplace(e.serial(), entries_.begin());
+    return entries_.front().context;
+  }
+
+  /*! \brief Return the number of the contexts kept.
+   */
+  std::size_t size() const { return entries_.size(); }
+
+ private:
+  struct entry {
+    template <class Regex>
+    explicit entry(const Regex& e) : serial(e.serial()), context(e) {}
+
+    std::uint64_t serial;
+    context_type context;
+  };
+
+  std::size_t capacity_;
+
+  /*! \brief The contexts, from the most recently used.
+   */
+  std::list<entry> entries_;
+  std::unordered_map<std::uint64_t, typename std::list<entry>::iterator>
+      index_;
+};
+
+/*! \brief Return the match context of e for [first, last) ranges of BidirIt
+ * kept by the calling thread.
+ *
+ * The overloads of regex_match and regex_search without a context or a cache
+ * use it, so that the repeated matches of a regex reuse its DFA states.
+ *
+ * Each thread keeps the contexts of the REGEX_THREAD_MATCH_CONTEXTS regexes it
+ * has used most recently. A regex used after more than that many others gets
+ * a new context, whose DFA states are built again. The callers cycling through
+ * more regexes than that, or creating many short-lived ones, should own a
+ * match_context per regex and pass it to the overloads that take one.
+ */
+template <class BidirIt, class CharT, class Traits>
+match_context<basic_regex<CharT, Traits>, BidirIt>& thread_match_context(
+    const basic_regex<CharT, Traits>& e) {
+  typedef match_context<basic_regex<CharT, Traits>, BidirIt> context_type;
+  static thread_local match_context_pool<context_type> pool(
+      REGEX_THREAD_MATCH_CONTEXTS);
+  return pool.get(e);
+}
+
+/*! \brief Match a prefix of [first, last) against e and write the groups to
+ * m, with the storage of ctx.
+ *
+ * If e is one-pass, it runs the one-pass matcher. Otherwise, if the input is
+ * short enough, it runs the bounded backtracker, or else regex_matcher.
+ */
 template <class BidirIt, class Alloc, class CharT, class Traits>
 bool regex_match(BidirIt first, BidirIt last, match_results<BidirIt, Alloc>& m,
-                 const basic_regex<CharT, Traits>& e) {
+                 const basic_regex<CharT, Traits>& e,
+                 match_context<basic_regex<CharT, Traits>, BidirIt>& ctx) {
+  typedef typename basic_regex<CharT, Traits>::nfa_type NFA;
+  if (e.is_one_pass()) return e.onepass().match(first, last, m, ctx.onepass());
+
+  bounded_backtracker<NFA> backtracker(e.nfa());
+  std::size_t length;
+  if (backtracker.fits(first, last, length)) {
+    return backtracker.match(first, last, m, e.nfa().start_id(),
+                             ctx.backtrack(), length);
+  }
+
   regex_matcher<basic_regex<CharT, Traits>, BidirIt,
                 match_results<BidirIt, Alloc>>
-      matcher(first, last, e, m);
+      matcher(first, last, e, m, e.nfa().start_id(), nullptr, &ctx.matcher());
   return m.ready();
 }
 
+template <class BidirIt, class Alloc, class CharT, class Traits>
+bool regex_match(BidirIt first, BidirIt last, match_results<BidirIt, Alloc>& m,
+                 const basic_regex<CharT, Traits>& e) {
+  return regex_match(first, last, m, e, thread_match_context<BidirIt>(e));
+}
+
+/*! \brief Return true if the boolean matches of e run the bit-parallel
+ * engine on [first, last).
+ *
+ * The engine must be available and the input at most
+ * REGEX_BIT_PARALLEL_MAX_INPUT chars long.
+ */
+template <class BidirIt, class CharT, class Traits>
+bool use_bit_parallel(BidirIt first, BidirIt last,
+                      const basic_regex<CharT, Traits>& e) {
+  return e.bit_parallel().available() &&
+         bounded_distance(first, last, REGEX_BIT_PARALLEL_MAX_INPUT) <=
+             REGEX_BIT_PARALLEL_MAX_INPUT;
+}
+
+/*! \brief Return true if a prefix of [first, last) matches e.
+ *
+ * If e and the input are small enough, it runs the bit-parallel engine.
+ * Otherwise, it runs the DFA of cache and only falls back to regex_matcher if
+ * the DFA gives up.
+ */
+template <class BidirIt, class CharT, class Traits>
+bool regex_match(BidirIt first, BidirIt last,
+                 const basic_regex<CharT, Traits>& e,
+                 regex_cache<basic_regex<CharT, Traits>>& cache) {
+  if (use_bit_parallel(first, last, e)) {
+    return e.bit_parallel().match(first, last);
+  }
+
+  BidirIt match_end;
+  switch (cache.match_dfa().find(first, last, match_end)) {
+    case k_dfa_match:
+      return true;
+    case k_dfa_no_match:
+      return false;
+    default:
+      break;
+  }
+
+  match_results<BidirIt> m;
+  return regex_match(first, last, m, e);
+}
+
+template <class BidirIt, class CharT, class Traits>
+bool regex_match(BidirIt first, BidirIt last,
+                 const basic_regex<CharT, Traits>& e) {
+  return regex_match(first, last, e, thread_match_context<BidirIt>(e));
+}
+
+/*! \brief Find the start match_first of the first match in [first, last)
+ * that ends at match_last.
+ *
+ * It runs reverse_dfa, the DFA of the reversed program, backwards from
+ * match_last.
+ */
+template <class BidirIt, class DFA>
+dfa_status find_match_start(BidirIt first, BidirIt match_last,
+                            DFA& reverse_dfa, BidirIt& match_first) {
+  typedef std::reverse_iterator<BidirIt> reverse_iterator;
+  reverse_iterator reverse_match_last;
+  dfa_status status =
+      reverse_dfa.find(reverse_iterator(match_last), reverse_iterator(first),
+                       reverse_match_last);
+  assert(status != k_dfa_no_match);
+  match_first = reverse_match_last.base();
+  return status;
+}
+
+template <class BidirIt, class CharT, class Traits>
+dfa_status find_match_start(BidirIt first, BidirIt match_last,
+                            const basic_regex<CharT, Traits>& e,
+                            BidirIt& match_first) {
+  return find_match_start(first, match_last,
+                          thread_match_context<BidirIt>(e).reverse_dfa(),
+                          match_first);
+}
+
+/*! \brief Find the span [match_first, match_last) of the first substring of
+ * [first, last) that matches e, without tracking the groups.
+ *
+ * The forward DFA of the search program finds the end of the match. The start
+ * of the match is the furthest position before the end from which e matches
+ * up to the end, which the DFA of the reversed program finds by running
+ * backwards from the end for the longest match. If e matches exactly its
+ * literals, the match starts at the first candidate of the prefilter and only
+ * the forward DFA runs.
+ */
+template <class BidirIt, class CharT, class Traits>
+dfa_status find_match_span(
+    BidirIt first, BidirIt last, const basic_regex<CharT, Traits>& e,
+    regex_cache<basic_regex<CharT, Traits>>& cache, BidirIt& match_first,
+    BidirIt& match_last) {
+  auto& prefilter = e.prefilter();
+  if (prefilter.exact()) {
+    match_first = prefilter.find(first, last);
+    if (match_first == last) return k_dfa_no_match;
+    return cache.match_dfa().find(match_first, last, match_last);
+  }
+
+  dfa_status status = cache.search_dfa().find(first, last, match_last);
+  if (status != k_dfa_match) return status;
+  return find_match_start(first, match_last, cache.reverse_dfa(), match_first);
+}
+
+template <class BidirIt, class CharT, class Traits>
+dfa_status find_match_span(BidirIt first, BidirIt last,
+                           const basic_regex<CharT, Traits>& e,
+                           BidirIt& match_first, BidirIt& match_last) {
+  return find_match_span(first, last, e, thread_match_context<BidirIt>(e),
+                         match_first, match_last);
+}
+
+/*! \brief Find the first substring of [first, last) that matches e, with
+ * the DFAs and the storage of ctx.
+ *
+ * If e has literal prefixes, the search starts from the first occurrence of
+ * them. If e matches exactly its literals, the match starts right there. Short
+ * inputs are matched with the bounded backtracker. Otherwise, the span of the
+ * match is found with find_match_span, and the groups are extracted only from
+ * the span.
+ */
 template <class BidirIt, class Alloc, class CharT, class Traits>
 bool regex_search(BidirIt first, BidirIt last, match_results<BidirIt, Alloc>& m,
-                  const basic_regex<CharT, Traits>& e) {
-  typedef char_category<CharT> CharCategory;
-  // Transform the regex E to .*?E
-  auto e_ = e;
-  int any_char_id =
-      e_.nfa().append_match_char_category(CharCategory::any_char(), k_dangled);
-  int loop_id = e_.nfa().append_fork(e_.nfa().start_id(), any_char_id);
-  e_.nfa()[any_char_id].next = loop_id;
-  e_.nfa().set_start_id(loop_id);
-  e_.nfa().assert_complete();
+                  const basic_regex<CharT, Traits>& e,
+                  match_context<basic_regex<CharT, Traits>, BidirIt>& ctx) {
+  typedef typename basic_regex<CharT, Traits>::nfa_type NFA;
+  auto& prefilter = e.prefilter();
+  first = prefilter.find(first, last);
+  if (!prefilter.empty() && first == last) return false;
+
+  if (prefilter.exact() && e.is_one_pass()) {
+    return e.onepass().match(first, last, m, ctx.onepass());
+  }
+
+  int start_id =
+      prefilter.exact() ? e.nfa().start_id() : e.nfa().search_start_id();
+  bounded_backtracker<NFA> backtracker(e.nfa());
+  std::size_t length;
+  if (backtracker.fits(first, last, length)) {
+    return backtracker.match(first, last, m, start_id, ctx.backtrack(),
+                             length);
+  }
+
+  // Find the span of the match with the DFAs, and only extract the groups
+  // from the span.
+  if (e.reverse_nfa().start_id() >= 0) {
+    BidirIt match_first = first;
+    BidirIt match_last;
+    switch (find_match_span(first, last, e, ctx, match_first, match_last)) {
+      case k_dfa_match:
+        return regex_match(match_first, match_last, m, e, ctx);
+      case k_dfa_no_match:
+        return false;
+      default:
+        break;
+    }
+  }
 
   regex_matcher<basic_regex<CharT, Traits>, BidirIt,
                 match_results<BidirIt, Alloc>>
-      matcher(first, last, e_, m);
+      matcher(first, last, e, m, start_id, nullptr, &ctx.matcher());
   return m.ready();
 }
+
+template <class BidirIt, class Alloc, class CharT, class Traits>
+bool regex_search(BidirIt first, BidirIt last, match_results<BidirIt, Alloc>& m,
+                  const basic_regex<CharT, Traits>& e) {
+  return regex_search(first, last, m, e, thread_match_context<BidirIt>(e));
+}
+
+/*! \brief Return true if a substring of [first, last) matches e.
+ *
+ * If e matches exactly its literals, only the prefilter runs. If e and the
+ * rest of the input from the first candidate of the prefilter are small
+ * enough, it runs the bit-parallel engine from there. Otherwise, it runs the
+ * search DFA of cache and only falls back to regex_matcher if the DFA gives
+ * up.
+ */
+template <class BidirIt, class CharT, class Traits>
+bool regex_search(BidirIt first, BidirIt last,
+                  const basic_regex<CharT, Traits>& e,
+                  regex_cache<basic_regex<CharT, Traits>>& cache) {
+  auto& prefilter = e.prefilter();
+  if (prefilter.exact()) return prefilter.find(first, last) != last;
+  if (e.bit_parallel().available()) {
+    first = prefilter.find(first, last);
+    if (!prefilter.empty() && first == last) return false;
+    if (use_bit_parallel(first, last, e)) {
+      return e.bit_parallel().search(first, last);
+    }
+  }
+
+  BidirIt match_end;
+  switch (cache.search_dfa().find(first, last, match_end)) {
+    case k_dfa_match:
+      return true;
+    case k_dfa_no_match:
+      return false;
+    default:
+      break;
+  }
+
+  match_results<BidirIt> m;
+  return regex_search(first, last, m, e);
+}
+
+template <class BidirIt, class CharT, class Traits>
+bool regex_search(BidirIt first, BidirIt last,
+                  const basic_regex<CharT, Traits>& e) {
+  return regex_search(first, last, e, thread_match_context<BidirIt>(e));
+}
 }
 
 #endif
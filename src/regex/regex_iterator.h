@@ -0,0 +1,238 @@
+#ifndef __REGEX_ITERATOR_H__
+#define __REGEX_ITERATOR_H__
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "regex.h"
+#include "regex_func.h"
+#include "regex_match_results.h"
+#include "regex_traits.h"
+
+namespace regex {
+
+/*! \brief An iterator over the successive non-overlapping matches of a regex
+ * in [first, last).
+ *
+ * Each search resumes from the end of the previous match. After an empty
+ * match, another empty match at the same position is skipped, so the
+ * iteration always makes progress. The lazy DFAs and the storage of the
+ * matchers are kept in a match context shared by the copies of the iterator,
+ * so the DFA states are computed only once for the whole input.
+ */
+template <class BidirIt,
+          class CharT = typename std::iterator_traits<BidirIt>::value_type,
+          class Traits = regex_traits<CharT>>
+class regex_iterator {
+ public:
+  typedef basic_regex<CharT, Traits> regex_type;
+  typedef match_results<BidirIt> value_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef const value_type* pointer;
+  typedef const value_type& reference;
+  typedef std::forward_iterator_tag iterator_category;
+
+  /*! \brief Create the end-of-sequence iterator.
+   */
+  regex_iterator() = default;
+
+  regex_iterator(BidirIt first, BidirIt last, const regex_type& re)
+      : last_(last),
+        regex_(&re),
+        context_(std::make_shared<match_context<regex_type, BidirIt>>(re)) {
+    find(first, false);
+  }
+
+  regex_iterator(BidirIt, BidirIt, const regex_type&&) = delete;
+
+  bool operator==(const regex_iterator& other) const {
+    if (!regex_ || !other.regex_) return regex_ == other.regex_;
+    return regex_ == other.regex_ && last_ == other.last_ &&
+           match_[0].first() == other.match_[0].first() &&
+           match_[0].last() == other.match_[0].last();
+  }
+
+  bool operator!=(const regex_iterator& other) const {
+    return !(*this == other);
+  }
+
+  reference operator*() const { return match_; }
+
+  pointer operator->() const { return &match_; }
+
+  regex_iterator& operator++() {
+    find(match_[0].last(), match_[0].length() == 0);
+    return *this;
+  }
+
+  regex_iterator operator++(int) {
+    regex_iterator old = *this;
+    ++*this;
+    return old;
+  }
+
+ private:
+  BidirIt last_ = BidirIt();
+  const regex_type* regex_ = nullptr;
+  std::shared_ptr<match_context<regex_type, BidirIt>> context_;
+  value_type match_;
+
+  /*! \brief Find the next match from first, or become the end-of-sequence
+   * iterator.
+   *
+   * If skip_empty is true, an empty match at first is skipped.
+   */
+  void find(BidirIt first, bool skip_empty) {
+    BidirIt start = first;
+    while (true) {
+      if (!regex_search(start, last_, match_, *regex_, *context_)) break;
+      auto& m = match_[0];
+      if (!skip_empty || m.length() > 0 || m.last() != first) return;
+      if (start == last_) break;
+      ++start;
+    }
+    regex_ = nullptr;
+    context_.reset();
+  }
+};
+
+/*! \brief An iterator over the groups of the successive matches of a regex in
+ * [first, last).
+ *
+ * For each match, it visits the groups whose numbers are in submatches in the
+ * order. The number -1 stands for the chars between the previous match, or
+ * the start of the input, and the match. After the last match, if -1 is in
+ * submatches, it also visits the rest of the input if it is not empty.
+ */
+template <class BidirIt,
+          class CharT = typename std::iterator_traits<BidirIt>::value_type,
+          class Traits = regex_traits<CharT>>
+class regex_token_iterator {
+ public:
+  typedef basic_regex<CharT, Traits> regex_type;
+  typedef sub_match<BidirIt> value_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef const value_type* pointer;
+  typedef const value_type& reference;
+  typedef std::forward_iterator_tag iterator_category;
+
+  /*! \brief Create the end-of-sequence iterator.
+   */
+  regex_token_iterator() = default;
+
+  regex_token_iterator(BidirIt first, BidirIt last, const regex_type& re,
+                       int submatch = 0)
+      : regex_token_iterator(first, last, re, std::vector<int>{submatch}) {}
+
+  regex_token_iterator(BidirIt first, BidirIt last, const regex_type& re,
+                       std::vector<int> submatches)
+      : position_(first, last, re),
+        submatches_(std::move(submatches)),
+        prefix_first_(first),
+        last_(last) {
+    if (submatches_.empty()) submatches_.push_back(0);
+    if (position_ != regex_iterator<BidirIt, CharT, Traits>()) {
+      set_result();
+    } else {
+      set_suffix();
+    }
+  }
+
+  regex_token_iterator(BidirIt, BidirIt, const regex_type&&,
+                       int = 0) = delete;
+
+  bool operator==(const regex_token_iterator& other) const {
+    if (at_end_ || other.at_end_) return at_end_ == other.at_end_;
+    return position_ == other.position_ && n_ == other.n_ &&
+           suffix_ == other.suffix_ &&
+           result_.first() == other.result_.first() &&
+           result_.last() == other.result_.last();
+  }
+
+  bool operator!=(const regex_token_iterator& other) const {
+    return !(*this == other);
+  }
+
+  reference operator*() const { return result_; }
+
+  pointer operator->() const { return &result_; }
+
+  regex_token_iterator& operator++() {
+    if (suffix_) {
+      at_end_ = true;
+      return *this;
+    }
+
+    if (++n_ < submatches_.size()) {
+      set_result();
+      return *this;
+    }
+
+    n_ = 0;
+    prefix_first_ = (*position_)[0].last();
+    ++position_;
+    if (position_ != regex_iterator<BidirIt, CharT, Traits>()) {
+      set_result();
+    } else {
+      set_suffix();
+    }
+    return *this;
+  }
+
+  regex_token_iterator operator++(int) {
+    regex_token_iterator old = *this;
+    ++*this;
+    return old;
+  }
+
+ private:
+  regex_iterator<BidirIt, CharT, Traits> position_;
+  std::vector<int> submatches_;
+  std::size_t n_ = 0;
+
+  /*! \brief The end of the previous match, or the start of the input.
+   */
+  BidirIt prefix_first_ = BidirIt();
+  BidirIt last_ = BidirIt();
+  value_type result_;
+  bool suffix_ = false;
+  bool at_end_ = true;
+
+  /*! \brief Set result_ to the group submatches_[n_] of the current match.
+   */
+  void set_result() {
+    at_end_ = false;
+    int k = submatches_[n_];
+    const auto& m = *position_;
+    result_ = value_type();
+    if (k == -1) {
+      result_.set_first(prefix_first_);
+      result_.set_last(m[0].first());
+    } else if (std::size_t(k) < m.size()) {
+      result_ = m[k];
+    }
+  }
+
+  /*! \brief Set result_ to the rest of the input after the last match, or
+   * become the end-of-sequence iterator.
+   */
+  void set_suffix() {
+    bool wants_suffix = false;
+    for (int k : submatches_) wants_suffix |= k == -1;
+    if (!wants_suffix || prefix_first_ == last_) {
+      at_end_ = true;
+      return;
+    }
+    at_end_ = false;
+    suffix_ = true;
+    result_ = value_type();
+    result_.set_first(prefix_first_);
+    result_.set_last(last_);
+  }
+};
+}
+
+#endif
@@ -0,0 +1,426 @@
+#ifndef __REGEX_JIT_H__
+#define __REGEX_JIT_H__
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <map>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "regex_byte_classes.h"
+#include "regex_func.h"
+#include "regex_nfa.h"
+#include "regex_traits.h"
+
+/*! \brief Whether jit_dfa emits native code.
+ *
+ * It is on by default on Linux x86-64, the only target of the code
+ * generator, and can be turned off with -DREGEX_ENABLE_JIT=0. Without it,
+ * jit_dfa runs its tables with the interpreter.
+ */
+#ifndef REGEX_ENABLE_JIT
+#if defined(__linux__) && defined(__x86_64__)
+#define REGEX_ENABLE_JIT 1
+#else
+#define REGEX_ENABLE_JIT 0
+#endif
+#endif
+
+#if REGEX_ENABLE_JIT
+#include <sys/mman.h>
+#endif
+
+namespace regex {
+
+/*! \brief A buffer of native code mapped executable.
+ *
+ * The code is written into a writable mapping, which is then made executable
+ * and read-only, so the buffer is never writable and executable at once.
+ */
+class executable_buffer {
+ public:
+  executable_buffer() = default;
+
+  /*! \brief Map a copy of code, or leave the buffer empty if it fails.
+   */
+  explicit executable_buffer(const std::vector<unsigned char>& code) {
+#if REGEX_ENABLE_JIT
+    if (code.empty()) return;
+    void* p = mmap(nullptr, code.size(), PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return;
+    std::memcpy(p, code.data(), code.size());
+    if (mprotect(p, code.size(), PROT_READ | PROT_EXEC) != 0) {
+      munmap(p, code.size());
+      return;
+    }
+    data_ = p;
+    size_ = code.size();
+#else
+    static_cast<void>(code);
+#endif
+  }
+
+  ~executable_buffer() { release(); }
+
+  executable_buffer(const executable_buffer&) = delete;
+  executable_buffer& operator=(const executable_buffer&) = delete;
+
+  executable_buffer(executable_buffer&& other) noexcept { swap(other); }
+
+  executable_buffer& operator=(executable_buffer&& other) noexcept {
+    executable_buffer(std::move(other)).swap(*this);
+    return *this;
+  }
+
+  void swap(executable_buffer& other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+  }
+
+  const void* data() const { return data_; }
+  std::size_t size() const { return size_; }
+
+ private:
+  void* data_ = nullptr;
+  std::size_t size_ = 0;
+
+  void release() {
+#if REGEX_ENABLE_JIT
+    if (data_) munmap(data_, size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+  }
+};
+
+/*! \brief A complete DFA of a small program of bytes, compiled into native
+ * code.
+ *
+ * The DFA is built eagerly by the subset construction over the byte classes,
+ * and only answers whether there is a match, like bit_parallel_nfa: it stops
+ * at the first accepting state. Running the program from start_id() matches
+ * a prefix, and from search_start_id() a substring.
+ *
+ * With REGEX_ENABLE_JIT, each state becomes a block of x86-64 code that loads
+ * a byte and jumps to the block of the next state through a chain of
+ * comparisons with the upper bounds of the byte ranges, so a step takes no
+ * table lookup and no dispatch. Otherwise, or if the code cannot be mapped,
+ * the portable interpreter runs the transition table.
+ *
+ * The DFA is unavailable if it takes more than k_max_states states.
+ */
+template <class NFA>
+class jit_dfa {
+ public:
+  typedef NFA nfa_type;
+  typedef typename nfa_type::char_type char_type;
+
+  enum {
+    k_max_states = 4096,
+    k_dead_state = 0,
+    k_start_state = 1,
+  };
+
+  /*! \brief Create an unavailable DFA.
+   */
+  jit_dfa() = default;
+
+  /*! \brief Build the DFA of nfa from start_id over classes, and compile it
+   * if the JIT is enabled.
+   */
+  jit_dfa(const nfa_type& nfa, int start_id, const byte_classes& classes) {
+    if (sizeof(char_type) != 1 || start_id < 0) return;
+    for (unsigned b = 0; b < byte_classes::k_byte_count; ++b) {
+      class_of_[b] = classes[b];
+    }
+    class_count_ = classes.size();
+    if (!build(nfa, start_id)) {
+      transitions_.clear();
+      accepting_.clear();
+      return;
+    }
+#if REGEX_ENABLE_JIT
+    code_ = executable_buffer(generate());
+#endif
+  }
+
+  /*! \brief Return true if the DFA has been built.
+   */
+  bool available() const { return !accepting_.empty(); }
+
+  /*! \brief Return true if the DFA runs as native code.
+   */
+  bool native() const { return code_.data() != nullptr; }
+
+  std::size_t state_count() const { return accepting_.size(); }
+
+  /*! \brief Return the size of the native code in bytes.
+   */
+  std::size_t code_size() const { return code_.size(); }
+
+  /*! \brief Run the DFA over [first, last), natively if the input is a
+   * contiguous array of bytes.
+   */
+  template <class BidirIt>
+  bool run(BidirIt first, BidirIt last) const {
+    assert(available());
+    return run(first, last,
+               std::integral_constant<
+                   bool, is_contiguous_byte_iterator<BidirIt>::value>());
+  }
+
+  /*! \brief Run the transition table over [first, last).
+   */
+  template <class InputIt>
+  bool interpret(InputIt first, InputIt last) const {
+    assert(available());
+    int s = k_start_state;
+    if (accepting_[s]) return true;
+    for (; first != last; ++first) {
+      s = transitions_[s * class_count_ + class_of_[(unsigned char)*first]];
+      if (accepting_[s]) return true;
+      if (s == k_dead_state) return false;
+    }
+    return false;
+  }
+
+ private:
+  typedef int (*function_type)(const unsigned char*, const unsigned char*);
+
+  unsigned char class_of_[byte_classes::k_byte_count] = {};
+  std::size_t class_count_ = 0;
+
+  /*! \brief The next state of state s and class c at s * class_count_ + c.
+   */
+  std::vector<int> transitions_;
+  std::vector<unsigned char> accepting_;
+
+  executable_buffer code_;
+
+  template <class BidirIt>
+  bool run(BidirIt first, BidirIt last, std::true_type) const {
+    if (!native() || first == last) return interpret(first, last);
+    auto p = reinterpret_cast<const unsigned char*>(&*first);
+    auto f = reinterpret_cast<function_type>(
+        const_cast<void*>(code_.data()));
+    return f(p, p + (last - first)) != 0;
+  }
+
+  template <class BidirIt>
+  bool run(BidirIt first, BidirIt last, std::false_type) const {
+    return interpret(first, last);
+  }
+
+  /*! \brief Add the instructions of k_match_char_category reachable from pc
+   * through the other instructions to pcs.
+   *
+   * Return true if an accept is reachable.
+   */
+  static bool closure(const nfa_type& nfa, int pc, std::vector<bool>& visited,
+                      std::vector<int>& pcs) {
+    bool accepts = false;
+    std::vector<int> stack{pc};
+    while (!stack.empty()) {
+      pc = stack.back();
+      stack.pop_back();
+      if (visited[pc]) continue;
+      visited[pc] = true;
+
+      auto& insn = nfa[pc];
+      switch (insn.opcode) {
+        case k_match_char_category:
+          pcs.push_back(pc);
+          break;
+        case k_accept:
+          accepts = true;
+          break;
+        case k_fork:
+          stack.push_back(insn.next2);
+          stack.push_back(insn.next);
+          break;
+        default:
+          stack.push_back(insn.next);
+          break;
+      }
+    }
+    return accepts;
+  }
+
+  /*! \brief Build the states by the subset construction.
+   *
+   * A state is the sorted set of its instructions of k_match_char_category.
+   * The accepting states stop the DFA, so their transitions are not
+   * computed. Return false if there are too many states.
+   */
+  bool build(const nfa_type& nfa, int start_id) {
+    typedef std::pair<std::vector<int>, bool> key_type;
+    std::map<key_type, int> ids;
+    std::vector<std::vector<int>> states;
+    std::vector<bool> visited(nfa.size());
+
+    auto add_state = [&](std::vector<int> pcs, bool accepts) {
+      std::sort(pcs.begin(), pcs.end());
+      key_type key(std::move(pcs), accepts);
+      auto it = ids.find(key);
+      if (it != ids.end()) return it->second;
+      int id = states.size();
+      ids.emplace(key, id);
+      states.push_back(key.first);
+      accepting_.push_back(accepts);
+      transitions_.resize(transitions_.size() + class_count_, k_dead_state);
+      return id;
+    };
+
+    add_state({}, false);
+    std::vector<int> pcs;
+    bool accepts = closure(nfa, start_id, visited, pcs);
+    add_state(pcs, accepts);
+
+    std::vector<unsigned char> representatives(class_count_);
+    for (int b = byte_classes::k_byte_count - 1; b >= 0; --b) {
+      representatives[class_of_[b]] = b;
+    }
+    for (std::size_t s = k_start_state; s < states.size(); ++s) {
+      if (accepting_[s]) continue;
+      for (std::size_t c = 0; c < class_count_; ++c) {
+        std::fill(visited.begin(), visited.end(), false);
+        pcs.clear();
+        accepts = false;
+        for (int pc : states[s]) {
+          if (nfa.match(pc, char_type(representatives[c]))) {
+            accepts = closure(nfa, nfa[pc].next, visited, pcs) || accepts;
+          }
+        }
+        int next = add_state(pcs, accepts);
+        if (states.size() > k_max_states) return false;
+        transitions_[s * class_count_ + c] = next;
+      }
+    }
+    return true;
+  }
+
+  /*! \brief Emit the x86-64 code of the DFA.
+   *
+   * The code is a function of the System V ABI, int f(const unsigned char*
+   * p, const unsigned char* end), with p in rdi and end in rsi. It returns 1
+   * at the first accepting state and 0 at the dead state or at the end.
+   */
+  std::vector<unsigned char> generate() const {
+    std::vector<unsigned char> code;
+    std::vector<std::size_t> labels(state_count());
+    std::vector<std::pair<std::size_t, int>> fixups;  // rel32 offset, state
+
+    auto emit = [&](std::initializer_list<unsigned char> bytes) {
+      code.insert(code.end(), bytes);
+    };
+    auto emit32 = [&](std::uint32_t v) {
+      for (int i = 0; i < 4; ++i) code.push_back((v >> (8 * i)) & 0xff);
+    };
+    auto jump_rel32 = [&](int state) {
+      fixups.emplace_back(code.size(), state);
+      emit32(0);
+    };
+
+    emit({0xe9});  // jmp start
+    jump_rel32(k_start_state);
+
+    for (std::size_t s = 0; s < state_count(); ++s) {
+      labels[s] = code.size();
+      if (s == k_dead_state) {
+        emit({0x31, 0xc0, 0xc3});  // xor eax, eax; ret
+        continue;
+      }
+      if (accepting_[s]) {
+        emit({0xb8, 0x01, 0x00, 0x00, 0x00, 0xc3});  // mov eax, 1; ret
+        continue;
+      }
+
+      emit({0x48, 0x39, 0xf7});  // cmp rdi, rsi
+      emit({0x0f, 0x84});        // je dead
+      jump_rel32(k_dead_state);
+      emit({0x0f, 0xb6, 0x07});  // movzx eax, byte [rdi]
+      emit({0x48, 0xff, 0xc7});  // inc rdi
+
+      // Compare with the upper bounds of the ranges of the bytes going to
+      // the same state, in increasing order. The last range is a jmp.
+      for (unsigned b = 0; b < byte_classes::k_byte_count;) {
+        int next = transitions_[s * class_count_ + class_of_[b]];
+        unsigned hi = b;
+        while (hi + 1 < byte_classes::k_byte_count &&
+               transitions_[s * class_count_ + class_of_[hi + 1]] == next) {
+          ++hi;
+        }
+        if (hi + 1 == byte_classes::k_byte_count) {
+          emit({0xe9});  // jmp next
+        } else {
+          emit({0x3d});  // cmp eax, hi
+          emit32(hi);
+          emit({0x0f, 0x86});  // jbe next
+        }
+        jump_rel32(next);
+        b = hi + 1;
+      }
+    }
+
+    for (auto& f : fixups) {
+      auto rel = std::uint32_t(labels[f.second] - (f.first + 4));
+      for (int i = 0; i < 4; ++i) code[f.first + i] = (rel >> (8 * i)) & 0xff;
+    }
+    return code;
+  }
+};
+
+/*! \brief The JIT DFAs of the boolean regex_match and regex_search of a
+ * regex.
+ *
+ * Building them takes the whole subset construction, so they are meant for
+ * the hot patterns that are matched many times. If a DFA is unavailable, the
+ * functions fall back to the regex, which must outlive the regex_jit.
+ */
+template <class Regex>
+class regex_jit {
+ public:
+  typedef Regex regex_type;
+  typedef jit_dfa<typename regex_type::nfa_type> dfa_type;
+
+  explicit regex_jit(const regex_type& e)
+      : regex_(e),
+        match_dfa_(e.nfa(), e.nfa().start_id(), e.classes()),
+        search_dfa_(e.nfa(), e.nfa().search_start_id(), e.classes()) {}
+
+  const regex_type& regex() const { return regex_; }
+
+  const dfa_type& match_dfa() const { return match_dfa_; }
+
+  const dfa_type& search_dfa() const { return search_dfa_; }
+
+ private:
+  const regex_type& regex_;
+  dfa_type match_dfa_;
+  dfa_type search_dfa_;
+};
+
+/*! \brief Return true if a prefix of [first, last) matches the regex of e.
+ */
+template <class BidirIt, class Regex>
+bool regex_match(BidirIt first, BidirIt last, const regex_jit<Regex>& e) {
+  if (!e.match_dfa().available()) return regex_match(first, last, e.regex());
+  return e.match_dfa().run(first, last);
+}
+
+/*! \brief Return true if a substring of [first, last) matches the regex of e.
+ */
+template <class BidirIt, class Regex>
+bool regex_search(BidirIt first, BidirIt last, const regex_jit<Regex>& e) {
+  if (!e.search_dfa().available()) return regex_search(first, last, e.regex());
+  return e.search_dfa().run(first, last);
+}
+}
+
+#endif
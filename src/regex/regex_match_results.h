@@ -44,6 +44,14 @@ class sub_match {
 
   bool matched() const { return matched_; }
 
+  /*! \brief Get the position of the first char.
+   */
+  iterator first() const { return first_; }
+
+  /*! \brief Get the position after the last char.
+   */
+  iterator last() const { return last_; }
+
   void set_first(BidirIt first) {
     first_ = first;
     matched_ = false;
@@ -77,9 +85,9 @@ class match_results : public std::vector<sub_match<BidirIt>, Allocator> {
    */
   bool ready() const { return ready_; }
 
-  /*! \brief Set the object to a valid state.
+  /*! \brief Set whether the object has valid match results.
    */
-  void set_ready() { ready_ = true; }
+  void set_ready(bool ready = true) { ready_ = ready; }
 
   /*! \brief Set the start position of a subgroup.
    */
@@ -2,39 +2,25 @@
 #define __REGEX_MATCHER_H__
 
 #include <cassert>
-#include <deque>
 #include <iterator>
-#include <set>
+#include <utility>
+#include <vector>
 
+#include "regex_capture.h"
 #include "regex_nfa.h"
+#include "regex_packed.h"
+#include "regex_sparse_set.h"
 
 namespace regex {
 
-template <class Regex, class BidirIt, class MatchResults>
-class regex_matcher {
- public:
-  typedef Regex regex_type;
-  typedef BidirIt iterator;
-  typedef MatchResults match_results_type;
-  typedef typename Regex::nfa_type::instruction_type instruction_type;
-
-  regex_matcher(BidirIt first, BidirIt last, const Regex& regex,
-                MatchResults& match_results)
-      : cur_(first),
-        last_(last),
-        regex_(regex),
-        results_(match_results),
-        cur_closure_() {
-    add_to_closure(cur_closure_, regex_.nfa().start_id(), first,
-                   match_results_type());
-    do_match();
-    results_.resize(regex_.mark_count());
-  }
-
- private:
-  BidirIt cur_;
-  BidirIt last_;
-
+/*! \brief The storage of regex_matcher, which can be kept between the
+ * matches so that they do not allocate, and the walk of the e-closures.
+ *
+ * stream_matcher runs the same threads with the absolute positions of a
+ * stream as Slot, so the walk takes any position the slots accept.
+ */
+template <class Slot>
+struct matcher_scratch {
   /*! \brief The matching candidates.
    *
    * Only the instructions of k_match_char_category and k_accept can be a
@@ -42,96 +28,252 @@ class regex_matcher {
    */
   struct candidate {
     int pc;
-    match_results_type capture;
+    int capture;  //!< The id of the capture slots in captures
   };
 
   /*! \brief A e-closure of a NFA-state.
+   *
+   * The storage is allocated once for the whole match and reused by clearing,
+   * so matching a character does not allocate.
    */
   struct closure {
     /*! \brief The candidates of the next char matching.
+     *
+     * Only the first candidate_count elements are valid.
      */
-    std::deque<candidate> candidates;
+    std::vector<candidate> candidates;
+    std::size_t candidate_count = 0;
 
     /*! \brief The included NFA states, including the candidates and the
      * passing-by instructions.
      */
-    std::set<int> nfa_states;
+    sparse_set nfa_states;
+
+    /*! \brief Allocate the storage for a NFA of the given size.
+     */
+    void reset(std::size_t nfa_size) {
+      candidates.resize(nfa_size);
+      candidate_count = 0;
+      nfa_states.reset(nfa_size);
+    }
+
+    void clear() {
+      candidate_count = 0;
+      nfa_states.clear();
+    }
   };
 
-  const Regex& regex_;
-  MatchResults& results_;
-  closure cur_closure_;
+  /*! \brief The current and the next closures, swapped after each char.
+   */
+  closure closures[2];
+
+  /*! \brief The capture slots shared by the candidates.
+   *
+   * A candidate holds a reference to its slots. The slots are copied only when
+   * a group mark is written, not when the thread forks.
+   */
+  capture_pool<Slot> captures;
+
+  /*! \brief Add the e closure of pc at the position sp to c.
+   *
+   * The precomputed closure of pc is used if there is one, and the program is
+   * walked otherwise.
+   */
+  template <class Regex, class Position>
+  void follow(const Regex& regex, closure& c, int pc, Position sp,
+              int capture) {
+    auto& closures = regex.closures();
+    if (!closures.contains(pc)) {
+      add_to_closure(regex, c, pc, sp, capture);
+      return;
+    }
+
+    // The consecutive entries with the same group marks share a copy of the
+    // slots, as they do when the marks are walked.
+    int shared = -1;
+    unsigned shared_write = 0;
+    for (auto e = closures.begin(pc); e != closures.end(pc); ++e) {
+      if (c.nfa_states.contains(e->pc)) continue;
+      c.nfa_states.insert(e->pc);
+
+      int id = capture;
+      if (e->write_count != 0) {
+        if (shared < 0 || e->first_write != shared_write) {
+          if (shared >= 0) captures.release(shared);
+          shared = captures.copy(capture);
+          shared_write = e->first_write;
+          auto slots = captures.slots(shared);
+          auto w = closures.writes(*e);
+          for (unsigned i = 0; i < e->write_count; ++i) {
+            if (w[i] & 1) {
+              slots[w[i] >> 1].set_last(sp);
+            } else {
+              slots[w[i] >> 1].set_first(sp);
+            }
+          }
+        }
+        id = shared;
+      }
+      auto& cand = c.candidates[c.candidate_count++];
+      cand.pc = e->pc;
+      cand.capture = id;
+      captures.retain(id);
+    }
+    if (shared >= 0) captures.release(shared);
+  }
 
   /*! \brief Recursively add the e closure of pc to c.
+   *
+   * The caller keeps its reference to capture. A group mark on the way writes
+   * into a copy of the slots.
    */
-  void add_to_closure(closure& c, int pc, iterator sp,
-                      match_results_type&& capture) {
-    if (c.nfa_states.find(pc) != c.nfa_states.end()) return;
+  template <class Regex, class Position>
+  void add_to_closure(const Regex& regex, closure& c, int pc, Position sp,
+                      int capture) {
+    if (c.nfa_states.contains(pc)) return;
     c.nfa_states.insert(pc);
 
-    auto& insn = regex_.nfa().at(pc);
-    switch (insn.opcode) {
+    auto& program = regex.packed();
+    switch (program.opcode(pc)) {
       case k_match_char_category:
-      case k_accept:
-        c.candidates.push_back(candidate{pc, std::move(capture)});
+      case k_accept: {
+        auto& cand = c.candidates[c.candidate_count++];
+        cand.pc = pc;
+        cand.capture = capture;
+        captures.retain(capture);
         break;
+      }
       case k_goto:
       case k_advance:
-        add_to_closure(c, insn.next, sp, std::move(capture));
+        add_to_closure(regex, c, program.next(pc), sp, capture);
         break;
       case k_fork:
-        add_to_closure(c, insn.next, sp, match_results_type(capture));
-        add_to_closure(c, insn.next2, sp, std::move(capture));
+        add_to_closure(regex, c, program.next(pc), sp, capture);
+        add_to_closure(regex, c, program.next2(pc), sp, capture);
         break;
-      case k_mark_group_start:
-        capture.set_sub_start(insn.group_id, sp);
-        add_to_closure(c, insn.next, sp, std::move(capture));
+      case k_mark_group_start: {
+        int copy = captures.copy(capture);
+        captures.slots(copy)[program.group_id(pc)].set_first(sp);
+        add_to_closure(regex, c, program.next(pc), sp, copy);
+        captures.release(copy);
         break;
-      case k_mark_group_end:
-        capture.set_sub_end(insn.group_id, sp);
-        add_to_closure(c, insn.next, sp, std::move(capture));
+      }
+      case k_mark_group_end: {
+        int copy = captures.copy(capture);
+        captures.slots(copy)[program.group_id(pc)].set_last(sp);
+        add_to_closure(regex, c, program.next(pc), sp, copy);
+        captures.release(copy);
         break;
+      }
       default:
         assert(false);
     }
   }
+};
+
+template <class Regex, class BidirIt, class MatchResults>
+class regex_matcher {
+ public:
+  typedef Regex regex_type;
+  typedef BidirIt iterator;
+  typedef MatchResults match_results_type;
+  typedef typename Regex::nfa_type::instruction_type instruction_type;
+  typedef matcher_scratch<typename MatchResults::value_type> scratch_type;
+
+  regex_matcher(BidirIt first, BidirIt last, const Regex& regex,
+                MatchResults& match_results)
+      : regex_matcher(first, last, regex, match_results,
+                      regex.nfa().start_id()) {}
+
+  /*! \brief Match the program starting from the instruction start_id.
+   *
+   * If matched_patterns is not null, no match is preferred over another, and
+   * the matcher runs to the end and sets (*matched_patterns)[id] for the
+   * pattern id of every accept reached, instead of writing match_results.
+   *
+   * If scratch is not null, the matcher uses its storage instead of
+   * allocating its own.
+   */
+  regex_matcher(BidirIt first, BidirIt last, const Regex& regex,
+                MatchResults& match_results, int start_id,
+                std::vector<bool>* matched_patterns = nullptr,
+                scratch_type* scratch = nullptr)
+      : cur_(first),
+        last_(last),
+        regex_(regex),
+        results_(match_results),
+        matched_patterns_(matched_patterns),
+        scratch_(scratch ? *scratch : own_scratch_) {
+    results_.set_ready(false);
+    for (auto& c : scratch_.closures) c.reset(regex_.packed().size());
+    scratch_.captures.reset(regex_.mark_count());
+
+    // An empty program, such as the one of a default-constructed regex,
+    // matches nothing.
+    if (start_id >= 0) {
+      int capture = scratch_.captures.alloc();
+      scratch_.follow(regex_, scratch_.closures[0], start_id, first, capture);
+      scratch_.captures.release(capture);
+    }
+    do_match();
+    results_.resize(regex_.mark_count());
+  }
+
+ private:
+  BidirIt cur_;
+  BidirIt last_;
+
+  const Regex& regex_;
+  MatchResults& results_;
+  std::vector<bool>* matched_patterns_;
+
+  scratch_type own_scratch_;
+  scratch_type& scratch_;
+
+  typedef typename scratch_type::closure closure;
 
   /*! \brief Match a character.
    */
   void advance() {
-    closure next_closure;
-    bool discard_others = false;
-    for (auto& cand : cur_closure_.candidates) {
-      if (discard_others) break;
-
-      auto& insn = regex_.nfa().at(cand.pc);
-      switch (insn.opcode) {
-        case k_match_char_category:
-          if (cur_ != last_ && insn.cc.match(*cur_)) {
-            add_to_closure(next_closure, insn.next, std::next(cur_),
-                           std::move(cand.capture));
-          }
-          break;
-        case k_accept:
-          // Remove all the lower-priority candidates but keeps the higher
-          // priority candidates.
-          results_ = std::move(cand.capture);
-          results_.set_ready();
-          discard_others = true;
-          break;
-        default:
-          assert(false);
+    closure& cur_closure = scratch_.closures[0];
+    closure& next_closure = scratch_.closures[1];
+    next_closure.clear();
+    auto& program = regex_.packed();
+
+    for (std::size_t i = 0; i < cur_closure.candidate_count; ++i) {
+      auto& cand = cur_closure.candidates[i];
+      if (program.opcode(cand.pc) == k_match_char_category) {
+        if (cur_ != last_ && program.match(cand.pc, *cur_)) {
+          scratch_.follow(regex_, next_closure, program.next(cand.pc),
+                          std::next(cur_), cand.capture);
+        }
+      } else {
+        assert(program.opcode(cand.pc) == k_accept);
+        if (matched_patterns_) {
+          (*matched_patterns_)[program.group_id(cand.pc)] = true;
+          continue;
+        }
+        // Remove all the lower-priority candidates but keeps the higher
+        // priority candidates.
+        auto slots = scratch_.captures.slots(cand.capture);
+        results_.assign(slots, slots + scratch_.captures.slot_count());
+        results_.set_ready();
+        break;
       }
     }
 
-    cur_closure_ = std::move(next_closure);
+    for (std::size_t i = 0; i < cur_closure.candidate_count; ++i) {
+      scratch_.captures.release(cur_closure.candidates[i].capture);
+    }
+
+    std::swap(scratch_.closures[0], scratch_.closures[1]);
     ++cur_;
   }
 
   /*! \brief Match the string.
    */
   void do_match() {
-    while (!cur_closure_.candidates.empty()) {
+    while (scratch_.closures[0].candidate_count != 0) {
       advance();
     }
   }
@@ -70,7 +70,7 @@ struct instruction {
 
   /*! \brief The opcode of the instruction.
    */
-  opcode opcode;
+  enum opcode opcode;
 
   /*! \brief The character category.
    *
@@ -90,9 +90,10 @@ struct instruction {
    */
   int next2 = k_null;
 
-  /*! \brief The group id.
+  /*! \brief The group id, or the pattern id of an accept.
    *
-   * Used if opcode == k_mark_group_start or k_mark_group_end.
+   * Used if opcode == k_mark_group_start, k_mark_group_end or k_accept. The
+   * pattern id tells which pattern of a regex set has matched.
    */
   unsigned group_id = -1;
 };
@@ -103,6 +104,8 @@ class nfa : public std::vector<Instruction, Allocator> {
   typedef Instruction instruction_type;
   typedef typename Instruction::char_type char_type;
   typedef char_category<char_type> char_category_type;
+  typedef char_set_table<char_type> char_set_table_type;
+  typedef typename char_set_table_type::char_set_type char_set_type;
 
   /*! \brief Use the parent constructors.
    */
@@ -116,6 +119,17 @@ class nfa : public std::vector<Instruction, Allocator> {
    */
   int start_id() const { return start_id_; }
 
+  /*! \brief Set the start id of the unanchored search.
+   */
+  void set_search_start_id(int i) { search_start_id_ = i; }
+
+  /*! \brief Get the start id of the unanchored search.
+   *
+   * The program starting from it matches .*?E, where E is the program
+   * starting from start_id().
+   */
+  int search_start_id() const { return search_start_id_; }
+
   /*! \brief Append an instruction to match a character category and return the
    * instruction id.
    */
@@ -127,6 +141,38 @@ class nfa : public std::vector<Instruction, Allocator> {
     return this->size() - 1;
   }
 
+  /*! \brief Append an instruction to match a set of characters and return
+   * the instruction id.
+   *
+   * The set is kept in char_sets(), unless it is a single character or all
+   * the characters.
+   */
+  int append_match_char_set(const char_set_type& set, int next) {
+    return append_match_char_category(add_char_set(set), next);
+  }
+
+  /*! \brief Return the char category of set, adding set to char_sets() if
+   * needed.
+   */
+  char_category_type add_char_set(const char_set_type& set) {
+    return char_sets_.add(set);
+  }
+
+  /*! \brief Return the sets of characters the char categories refer to.
+   */
+  const char_set_table_type& char_sets() const { return char_sets_; }
+
+  /*! \brief Replace the sets of characters, like with the ones of the
+   * program whose categories are copied.
+   */
+  void set_char_sets(const char_set_table_type& sets) { char_sets_ = sets; }
+
+  /*! \brief Return true if the k_match_char_category pc matches ch.
+   */
+  bool match(int pc, char_type ch) const {
+    return char_sets_.match((*this)[pc].cc, ch);
+  }
+
   /*! \brief Append an instruction to go to another position unconditionally and
    * return the instruction id.
    */
@@ -152,10 +198,12 @@ class nfa : public std::vector<Instruction, Allocator> {
     return this->size() - 1;
   }
 
-  /*! \brief Append an instruction of reaching the accept state.
+  /*! \brief Append an instruction of reaching the accept state of the
+   * pattern pattern_id.
    */
-  int append_accept() {
+  int append_accept(unsigned pattern_id = 0) {
     instruction_type insn{k_accept};
+    insn.group_id = pattern_id;
     this->push_back(insn);
     return this->size() - 1;
   }
@@ -177,6 +225,14 @@ class nfa : public std::vector<Instruction, Allocator> {
    */
   unsigned mark_count() const { return next_group_id_; }
 
+  /*! \brief Set the number of groups, after the marks of the groups from
+   * count on have been removed.
+   */
+  void set_mark_count(unsigned count) {
+    assert(count <= next_group_id_);
+    next_group_id_ = count;
+  }
+
   /*! \brief Append an instruction of marking the start of a group.
    */
   int append_mark_group_start(int next, int group_id) {
@@ -229,7 +285,9 @@ class nfa : public std::vector<Instruction, Allocator> {
 
  private:
   int start_id_ = -1;
+  int search_start_id_ = -1;
   unsigned next_group_id_ = 0;
+  char_set_table_type char_sets_;
 };
 }
 
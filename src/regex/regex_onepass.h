@@ -0,0 +1,269 @@
+#ifndef __REGEX_ONEPASS_H__
+#define __REGEX_ONEPASS_H__
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+#include "regex_nfa.h"
+
+namespace regex {
+
+/*! \brief The storage of onepass_nfa::match, which can be kept between the
+ * matches so that they do not allocate.
+ */
+template <class Slot>
+struct onepass_scratch {
+  std::vector<Slot> slots;
+  std::vector<Slot> accepted;
+};
+
+/*! \brief A matcher of the one-pass programs.
+ *
+ * A program is one-pass if, in each e-closure reached after matching a char,
+ * at most one of the char categories preferred over the accept can match the
+ * next char. Then only one thread survives each step, so the matcher walks a
+ * single state and writes the group marks directly into one array of capture
+ * slots, instead of simulating a set of threads with their own captures.
+ *
+ * Each state is the e-closure of an instruction following a char category.
+ * It is compiled into the transitions preferred over the accept, each with the
+ * group marks on its path, and the group marks on the path to the accept.
+ */
+template <class NFA>
+class onepass_nfa {
+ public:
+  typedef NFA nfa_type;
+  typedef typename nfa_type::char_type char_type;
+  typedef typename nfa_type::char_category_type char_category_type;
+  typedef typename nfa_type::char_set_table_type char_set_table_type;
+
+  enum {
+    /*! \brief The maximum number of instructions of a program.
+     */
+    k_max_insns = 4096,
+  };
+
+  /*! \brief Create an unavailable matcher.
+   */
+  onepass_nfa() = default;
+
+  /*! \brief Compile the program of nfa from start_id.
+   *
+   * The matcher is unavailable if the program is not one-pass.
+   */
+  onepass_nfa(const nfa_type& nfa, int start_id) {
+    if (start_id < 0 || nfa.size() > k_max_insns) return;
+    mark_count_ = nfa.mark_count();
+    char_sets_ = nfa.char_sets();
+    available_ = compile(nfa, start_id);
+    if (!available_) {
+      states_.clear();
+      transitions_.clear();
+      marks_.clear();
+      char_sets_ = char_set_table_type();
+    }
+  }
+
+  /*! \brief Return true if the program is one-pass.
+   */
+  bool available() const { return available_; }
+
+  /*! \brief Return the number of states.
+   */
+  std::size_t state_count() const { return states_.size(); }
+
+  /*! \brief Match a prefix of [first, last) and write the groups to m.
+   *
+   * Return true if there is a match.
+   */
+  template <class BidirIt, class MatchResults>
+  bool match(BidirIt first, BidirIt last, MatchResults& m) const {
+    onepass_scratch<typename MatchResults::value_type> scratch;
+    return match(first, last, m, scratch);
+  }
+
+  /*! \brief Match like above with the storage of scratch.
+   */
+  template <class BidirIt, class MatchResults>
+  bool match(BidirIt first, BidirIt last, MatchResults& m,
+             onepass_scratch<typename MatchResults::value_type>& scratch)
+      const {
+    assert(available_);
+    typedef typename MatchResults::value_type slot_type;
+
+    auto& slots = scratch.slots;
+    auto& accepted = scratch.accepted;
+    slots.assign(mark_count_, slot_type());
+    bool found = false;
+
+    int s = 0;
+    BidirIt cur = first;
+    while (true) {
+      auto& st = states_[s];
+      if (st.accepts) {
+        accepted = slots;
+        apply(st.accept_marks, accepted.data(), cur);
+        found = true;
+      }
+
+      int t = st.transition_begin;
+      if (cur != last) {
+        for (; t != st.transition_end; ++t) {
+          if (char_sets_.match(transitions_[t].cc, *cur)) break;
+        }
+      } else {
+        t = st.transition_end;
+      }
+      if (t == st.transition_end) break;
+
+      apply(transitions_[t].marks, slots.data(), cur);
+      s = transitions_[t].state;
+      ++cur;
+    }
+
+    if (!found) return false;
+    m.assign(accepted.begin(), accepted.end());
+    m.set_ready();
+    return true;
+  }
+
+ private:
+  /*! \brief A range of group marks in marks_.
+   */
+  struct mark_range {
+    int begin = 0;
+    int end = 0;
+  };
+
+  /*! \brief A group mark on a path.
+   */
+  struct mark {
+    unsigned group_id;
+    bool is_end;
+  };
+
+  struct transition {
+    char_category_type cc;
+    int state;         //!< The state after matching cc
+    mark_range marks;  //!< The group marks before matching cc
+  };
+
+  struct state {
+    int transition_begin = 0;
+    int transition_end = 0;
+
+    /*! \brief True if the e-closure contains an accept.
+     */
+    bool accepts = false;
+
+    /*! \brief The group marks on the path to the accept.
+     */
+    mark_range accept_marks;
+  };
+
+  bool available_ = false;
+  unsigned mark_count_ = 0;
+  std::vector<state> states_;
+  std::vector<transition> transitions_;
+  std::vector<mark> marks_;
+
+  /*! \brief The sets of characters the transitions refer to.
+   */
+  char_set_table_type char_sets_;
+
+  template <class BidirIt, class Slot>
+  void apply(mark_range r, Slot* slots, BidirIt pos) const {
+    for (int i = r.begin; i != r.end; ++i) {
+      if (marks_[i].is_end) {
+        slots[marks_[i].group_id].set_last(pos);
+      } else {
+        slots[marks_[i].group_id].set_first(pos);
+      }
+    }
+  }
+
+  /*! \brief Compile the states reachable from start_id.
+   *
+   * Return false if the program is not one-pass.
+   */
+  bool compile(const nfa_type& nfa, int start_id) {
+    // The state of each instruction starting a state, and the instructions
+    // starting the states.
+    std::vector<int> state_of(nfa.size(), -1);
+    std::vector<int> roots{start_id};
+    state_of[start_id] = 0;
+
+    // A frame continues the path from pc after the marks are truncated to
+    // mark_len.
+    struct frame {
+      int pc;
+      std::size_t mark_len;
+    };
+    std::vector<mark> path;
+    std::vector<frame> stack;
+    std::vector<int> visited(nfa.size(), -1);
+
+    for (std::size_t s = 0; s < roots.size(); ++s) {
+      states_.emplace_back();
+      states_[s].transition_begin = transitions_.size();
+
+      // Enumerate the e-closure in the order of priority, and stop at the
+      // accept, which cuts the lower-priority candidates.
+      stack.assign(1, frame{roots[s], 0});
+      path.clear();
+      while (!stack.empty() && !states_[s].accepts) {
+        frame f = stack.back();
+        stack.pop_back();
+        path.resize(f.mark_len);
+
+        int pc = f.pc;
+        while (visited[pc] != int(s)) {
+          visited[pc] = s;
+          auto& insn = nfa[pc];
+          if (insn.opcode == k_fork) {
+            stack.push_back({insn.next2, path.size()});
+            pc = insn.next;
+          } else if (insn.opcode == k_mark_group_start ||
+                     insn.opcode == k_mark_group_end) {
+            path.push_back({insn.group_id, insn.opcode == k_mark_group_end});
+            pc = insn.next;
+          } else if (insn.opcode == k_match_char_category) {
+            int t = states_[s].transition_begin;
+            for (; t != int(transitions_.size()); ++t) {
+              if (char_sets_.intersects(transitions_[t].cc, insn.cc)) {
+                return false;
+              }
+            }
+            if (state_of[insn.next] < 0) {
+              state_of[insn.next] = roots.size();
+              roots.push_back(insn.next);
+            }
+            transitions_.push_back(
+                {insn.cc, state_of[insn.next], append_marks(path)});
+            break;
+          } else if (insn.opcode == k_accept) {
+            states_[s].accepts = true;
+            states_[s].accept_marks = append_marks(path);
+            break;
+          } else {
+            pc = insn.next;
+          }
+        }
+      }
+      states_[s].transition_end = transitions_.size();
+    }
+    return true;
+  }
+
+  mark_range append_marks(const std::vector<mark>& path) {
+    mark_range r;
+    r.begin = marks_.size();
+    marks_.insert(marks_.end(), path.begin(), path.end());
+    r.end = marks_.size();
+    return r;
+  }
+};
+}
+
+#endif
@@ -1,7 +1,12 @@
 #ifndef __REGEX_OPTIMIZER_H__
 #define __REGEX_OPTIMIZER_H__
 
+#include <algorithm>
 #include <cassert>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "regex_except.h"
 #include "regex_nfa.h"
@@ -111,6 +116,291 @@ class redundant_insn_optimizer {
       replace(insn.next);
       replace(insn.next2);
     }
+
+    int start_id = nfa_.start_id();
+    replace(start_id);
+    nfa_.set_start_id(start_id);
+    int search_start_id = nfa_.search_start_id();
+    replace(search_start_id);
+    nfa_.set_search_start_id(search_start_id);
+  }
+};
+
+/*! \brief The passes of nfa_optimizer.
+ */
+enum optimize_flags {
+  k_optimize_none = 0,
+
+  /*! \brief Thread the jumps through the gotos, so that the gotos become
+   * unreachable.
+   */
+  k_optimize_gotos = 1 << 0,
+
+  /*! \brief Turn the marks of the groups that nobody reads into gotos.
+   */
+  k_optimize_groups = 1 << 1,
+
+  /*! \brief Merge the identical sub-programs, like the tails of the
+   * alternatives of "(ab|cb)" or the UTF-8 continuation bytes.
+   */
+  k_optimize_fragments = 1 << 2,
+
+  k_optimize_default = k_optimize_gotos | k_optimize_fragments,
+};
+
+/*! \brief The optimization pipeline basic_regex runs on its program.
+ *
+ * The passes selected by the flags run in the order groups, gotos and
+ * fragments. Each of them only rewrites the jumps, and the instructions no
+ * longer reachable from the start ids are removed at the end, so the program
+ * is compacted and the instructions are renumbered.
+ *
+ * Merging two identical instructions keeps the matches and their groups: the
+ * threads reaching them have the same future, and the one of higher priority
+ * wins anyway. k_advance is not merged because the backtracker records the
+ * position per instruction.
+ */
+template <class NFA>
+class nfa_optimizer {
+ public:
+  typedef NFA nfa_type;
+  typedef typename nfa_type::instruction_type instruction_type;
+
+  /*! \brief Optimize nfa, which must be complete, with the passes of flags.
+   *
+   * Only the groups below read_groups are read, so k_optimize_groups drops
+   * the marks of the others and sets the number of groups to read_groups.
+   */
+  nfa_optimizer(nfa_type nfa, unsigned flags, unsigned read_groups = -1)
+      : nfa_(std::move(nfa)), original_size_(nfa_.size()) {
+    if (nfa_.empty()) return;
+    if (flags & k_optimize_groups) remove_group_marks(read_groups);
+    if (flags & k_optimize_gotos) {
+      nfa_ = redundant_insn_optimizer<nfa_type, std::allocator<int>>(
+                 std::move(nfa_))
+                 .nfa();
+    }
+    if (flags & k_optimize_fragments) merge_fragments();
+    remove_unreachable_insns();
+    nfa_.assert_complete();
+  }
+
+  /*! \brief Get the optimized NFA.
+   */
+  nfa_type& nfa() { return nfa_; }
+
+  const nfa_type& nfa() const { return nfa_; }
+
+  /*! \brief Return the number of instructions before the optimization.
+   */
+  std::size_t original_size() const { return original_size_; }
+
+ private:
+  nfa_type nfa_;
+  std::size_t original_size_;
+
+  void remove_group_marks(unsigned read_groups) {
+    for (auto& insn : nfa_) {
+      if ((insn.opcode == k_mark_group_start ||
+           insn.opcode == k_mark_group_end) &&
+          insn.group_id >= read_groups) {
+        insn.opcode = k_goto;
+        insn.group_id = -1;
+      }
+    }
+    if (read_groups < nfa_.mark_count()) nfa_.set_mark_count(read_groups);
+  }
+
+  /*! \brief The operands of an instruction, with its jumps redirected to
+   * the representatives.
+   */
+  struct fragment_key {
+    int opcode;
+    int next;
+    int next2;
+    unsigned group_id;
+    char_category<typename instruction_type::char_type> cc;
+
+    bool operator==(const fragment_key& other) const {
+      return opcode == other.opcode && next == other.next &&
+             next2 == other.next2 && group_id == other.group_id &&
+             cc == other.cc;
+    }
+  };
+
+  struct fragment_hash {
+    std::size_t operator()(const fragment_key& k) const {
+      std::size_t h = k.cc.hash();
+      for (std::size_t v : {std::size_t(k.opcode), std::size_t(k.next),
+                            std::size_t(k.next2), std::size_t(k.group_id)}) {
+        h = h * 31 + v;
+      }
+      return h;
+    }
+  };
+
+  /*! \brief Redirect the jumps to an instruction to the representative of
+   * the instructions identical to it.
+   *
+   * The instructions are identical if they have the same operands and jump
+   * to the same representatives. The strongly connected components are
+   * visited after the components they jump to, so the jumps of an
+   * instruction outside the loops are final when it is visited, and one
+   * lookup in a hash table finds its representative. The instructions of a
+   * loop jump to each other, so they are merged in rounds until none is
+   * identical to another, the merges of a round making the instructions
+   * jumping to them identical in the next one.
+   */
+  void merge_fragments() {
+    typedef std::unordered_map<fragment_key, int, fragment_hash> table_type;
+    std::vector<int> rep(nfa_.size());
+    for (std::size_t i = 0; i < rep.size(); ++i) rep[i] = i;
+    auto target = [&](int next) { return next >= 0 ? rep[next] : next; };
+    auto key = [&](int i) {
+      auto& insn = nfa_[i];
+      return fragment_key{insn.opcode, target(insn.next), target(insn.next2),
+                          insn.group_id, insn.cc};
+    };
+    // Merge i into the instruction of table identical to it, or add i.
+    auto merge = [&](table_type& table, int i) {
+      if (rep[i] != i || nfa_[i].opcode == k_advance) return false;
+      auto r = table.emplace(key(i), i);
+      if (r.second) return false;
+      rep[i] = r.first->second;
+      return true;
+    };
+
+    table_type seen;
+    for (auto& component : components()) {
+      if (component.size() > 1 || jumps_to(component[0], component[0])) {
+        bool changed;
+        do {
+          changed = false;
+          table_type round;
+          for (int i : component) changed |= merge(round, i);
+        } while (changed);
+      }
+      for (int i : component) merge(seen, i);
+    }
+
+    for (auto& insn : nfa_) {
+      insn.next = target(insn.next);
+      insn.next2 = target(insn.next2);
+    }
+    nfa_.set_start_id(target(nfa_.start_id()));
+    nfa_.set_search_start_id(target(nfa_.search_start_id()));
+  }
+
+  /*! \brief Return the instructions instruction id jumps to, or -1.
+   */
+  std::pair<int, int> jumps(int id) const {
+    auto& insn = nfa_[id];
+    if (insn.opcode == k_accept) return std::make_pair(-1, -1);
+    return std::make_pair(insn.next, insn.opcode == k_fork ? insn.next2 : -1);
+  }
+
+  bool jumps_to(int from, int to) const {
+    auto j = jumps(from);
+    return j.first == to || j.second == to;
+  }
+
+  /*! \brief Return the strongly connected components of the program, each
+   * after the components it jumps to.
+   *
+   * This is Tarjan's algorithm, with an explicit stack so that the long
+   * programs do not overflow the call stack.
+   */
+  std::vector<std::vector<int>> components() const {
+    int n = nfa_.size();
+    std::vector<std::vector<int>> result;
+    std::vector<int> index(n, -1), low(n), stack;
+    std::vector<bool> on_stack(n);
+    // The instructions being visited, with the number of jumps followed.
+    std::vector<std::pair<int, int>> calls;
+    int count = 0;
+    auto enter = [&](int id) {
+      index[id] = low[id] = count++;
+      stack.push_back(id);
+      on_stack[id] = true;
+      calls.emplace_back(id, 0);
+    };
+
+    for (int root = 0; root < n; ++root) {
+      if (index[root] >= 0) continue;
+      enter(root);
+      while (!calls.empty()) {
+        int id = calls.back().first;
+        int followed = calls.back().second++;
+        if (followed < 2) {
+          auto j = jumps(id);
+          int to = followed == 0 ? j.first : j.second;
+          if (to < 0) continue;
+          if (index[to] < 0) {
+            enter(to);
+          } else if (on_stack[to]) {
+            low[id] = std::min(low[id], index[to]);
+          }
+          continue;
+        }
+        calls.pop_back();
+        if (!calls.empty()) {
+          int caller = calls.back().first;
+          low[caller] = std::min(low[caller], low[id]);
+        }
+        if (low[id] != index[id]) continue;
+        result.emplace_back();
+        int member;
+        do {
+          member = stack.back();
+          stack.pop_back();
+          on_stack[member] = false;
+          result.back().push_back(member);
+        } while (member != id);
+      }
+    }
+    return result;
+  }
+
+  /*! \brief Remove the instructions unreachable from the start ids and
+   * renumber the others in their order.
+   */
+  void remove_unreachable_insns() {
+    std::vector<int> new_id(nfa_.size(), -1);
+    std::vector<int> stack;
+    auto visit = [&](int id) {
+      if (id >= 0 && new_id[id] < 0) {
+        new_id[id] = 0;
+        stack.push_back(id);
+      }
+    };
+    visit(nfa_.start_id());
+    visit(nfa_.search_start_id());
+    while (!stack.empty()) {
+      auto& insn = nfa_[stack.back()];
+      stack.pop_back();
+      if (insn.opcode == k_accept) continue;
+      visit(insn.next);
+      if (insn.opcode == k_fork) visit(insn.next2);
+    }
+
+    int n = 0;
+    for (auto& id : new_id) {
+      if (id == 0) id = n++;
+    }
+    if (n == int(nfa_.size())) return;
+
+    auto renumber = [&](int next) { return next >= 0 ? new_id[next] : next; };
+    std::size_t size = 0;
+    for (std::size_t i = 0; i < nfa_.size(); ++i) {
+      if (new_id[i] < 0) continue;
+      if (size != i) nfa_[size] = std::move(nfa_[i]);
+      auto& insn = nfa_[size++];
+      insn.next = renumber(insn.next);
+      insn.next2 = renumber(insn.next2);
+    }
+    nfa_.resize(size, instruction_type{k_accept});
+    nfa_.set_start_id(renumber(nfa_.start_id()));
+    nfa_.set_search_start_id(renumber(nfa_.search_start_id()));
   }
 };
 }
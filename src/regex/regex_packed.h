@@ -0,0 +1,154 @@
+#ifndef __REGEX_PACKED_H__
+#define __REGEX_PACKED_H__
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "regex_char_category.h"
+#include "regex_nfa.h"
+
+namespace regex {
+
+/*! \brief An instruction of packed_nfa in 8 bytes.
+ *
+ * The low 3 bits of word are the opcode and the other bits are the next
+ * instruction. arg is the index of the char category of k_match_char_category,
+ * the second next instruction of k_fork, or the group id.
+ */
+struct packed_instruction {
+  std::uint32_t word;
+  std::uint32_t arg;
+};
+
+/*! \brief The program of a NFA lowered into a compact form for the matchers.
+ *
+ * The instructions are packed into 8 bytes each, and the char categories,
+ * which are mostly repeated, are moved to a separate table without
+ * duplicates. The sets of characters stay in the char_set_table of the
+ * program. A program of thousands of instructions then fits in the L1 cache.
+ */
+template <class NFA>
+class packed_nfa {
+ public:
+  typedef NFA nfa_type;
+  typedef typename nfa_type::char_type char_type;
+  typedef char_category<char_type> char_category_type;
+  typedef typename nfa_type::char_set_table_type char_set_table_type;
+
+  enum {
+    k_opcode_bits = 3,
+    k_opcode_mask = (1 << k_opcode_bits) - 1,
+
+    /*! \brief The maximum number of instructions.
+     */
+    k_max_insns = 1 << (32 - k_opcode_bits),
+  };
+
+  packed_nfa() = default;
+
+  /*! \brief Lower nfa, which must be complete.
+   */
+  explicit packed_nfa(const nfa_type& nfa)
+      : char_sets_(nfa.char_sets()), mark_count_(nfa.mark_count()) {
+    assert(nfa.size() < std::size_t(k_max_insns));
+    insns_.reserve(nfa.size());
+    std::map<char_category_type, std::uint32_t> category_ids;
+    for (auto& insn : nfa) {
+      std::uint32_t next = insn.next >= 0 ? insn.next : 0;
+      std::uint32_t arg = 0;
+      switch (insn.opcode) {
+        case k_match_char_category:
+          arg = category_index(insn.cc, category_ids);
+          break;
+        case k_fork:
+          arg = insn.next2;
+          break;
+        case k_accept:
+        case k_mark_group_start:
+        case k_mark_group_end:
+          arg = insn.group_id;
+          break;
+        default:
+          break;
+      }
+      insns_.push_back({next << k_opcode_bits | insn.opcode, arg});
+    }
+  }
+
+  /*! \brief Return the number of instructions.
+   */
+  std::size_t size() const { return insns_.size(); }
+
+  /*! \brief Return the number of groups.
+   */
+  unsigned mark_count() const { return mark_count_; }
+
+  /*! \brief Return the number of distinct char categories.
+   */
+  std::size_t category_count() const { return categories_.size(); }
+
+  /*! \brief Return the distinct char categories.
+   */
+  const std::vector<char_category_type>& categories() const {
+    return categories_;
+  }
+
+  /*! \brief Return the sets of characters the char categories refer to.
+   */
+  const char_set_table_type& char_sets() const { return char_sets_; }
+
+  /*! \brief Return the packed instructions.
+   */
+  const packed_instruction* data() const { return insns_.data(); }
+
+  enum opcode opcode(int pc) const {
+    return static_cast<enum opcode>(insns_[pc].word & k_opcode_mask);
+  }
+
+  int next(int pc) const { return int(insns_[pc].word >> k_opcode_bits); }
+
+  /*! \brief Return the second next instruction of k_fork.
+   */
+  int next2(int pc) const { return int(insns_[pc].arg); }
+
+  /*! \brief Return the group id, or the pattern id of k_accept.
+   */
+  unsigned group_id(int pc) const { return insns_[pc].arg; }
+
+  /*! \brief Return the char category of k_match_char_category.
+   */
+  const char_category_type& cc(int pc) const {
+    return categories_[insns_[pc].arg];
+  }
+
+  /*! \brief Return true if the k_match_char_category pc matches ch.
+   */
+  bool match(int pc, char_type ch) const {
+    return char_sets_.match(cc(pc), ch);
+  }
+
+ private:
+  std::vector<packed_instruction> insns_;
+  std::vector<char_category_type> categories_;
+  char_set_table_type char_sets_;
+  unsigned mark_count_ = 0;
+
+  /*! \brief Return the index of cc in categories_, adding it if needed.
+   */
+  std::uint32_t category_index(
+      const char_category_type& cc,
+      std::map<char_category_type, std::uint32_t>& ids) {
+    auto it = ids.find(cc);
+    if (it != ids.end()) return it->second;
+    std::uint32_t id = categories_.size();
+    categories_.push_back(cc);
+    ids.emplace(cc, id);
+    return id;
+  }
+};
+}
+
+#endif
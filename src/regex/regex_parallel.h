@@ -0,0 +1,349 @@
+#ifndef __REGEX_PARALLEL_H__
+#define __REGEX_PARALLEL_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+#include "regex.h"
+#include "regex_dfa.h"
+#include "regex_func.h"
+#include "regex_match_results.h"
+#include "regex_prefilter.h"
+
+namespace regex {
+
+/*! \brief Run f(0), ..., f(n - 1) on their own threads and wait for them.
+ *
+ * An executor passed to regex_search_parallel must provide the same call
+ * operator, for example to run the tasks on a thread pool.
+ */
+struct thread_executor {
+  template <class F>
+  void operator()(std::size_t n, F f) const {
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < n; ++i) threads.emplace_back(f, i);
+    if (n > 0) f(0);
+    for (auto& t : threads) t.join();
+  }
+};
+
+/*! \brief The options of the parallel search.
+ */
+struct parallel_options {
+  /*! \brief The number of chunks searched at the same time.
+   */
+  unsigned threads = std::thread::hardware_concurrency();
+
+  /*! \brief The minimum number of chars of a chunk.
+   *
+   * Smaller inputs are split into fewer chunks, and an input of less than two
+   * chunks is searched sequentially.
+   */
+  std::size_t min_chunk_size = 1 << 20;
+
+  /*! \brief The distance between the states recorded in a chunk.
+   */
+  std::size_t checkpoint_interval = 1 << 12;
+};
+
+/*! \brief The forward DFA of the search program run over the chunks of an
+ * input in parallel.
+ *
+ * The state of the DFA at the start of a chunk depends on the chunks before
+ * it, so each chunk is scanned speculatively from the start state, which is
+ * the state of the search program whenever no match is in progress. A chunk
+ * records its states every checkpoint_interval chars, its first match state
+ * and its final state. The chunks are then stitched in order. If the actual
+ * state at the start of a chunk is the speculated one, the results of the
+ * chunk are exact. Otherwise, the chunk is rescanned from the actual state
+ * until the state is the same as a recorded one, from where the speculative
+ * scan is exact again.
+ */
+template <class NFA, class RandomIt>
+class parallel_dfa_search {
+ public:
+  typedef NFA nfa_type;
+  typedef RandomIt iterator;
+  typedef typename nfa_type::char_type char_type;
+  typedef lazy_dfa<nfa_type> dfa_type;
+
+  parallel_dfa_search(const nfa_type& nfa, int start_id,
+                      const parallel_options& options)
+      : nfa_(nfa), start_id_(start_id), options_(options) {}
+
+  /*! \brief Skip to the candidates of prefilter whenever a DFA is in the
+   * start state.
+   *
+   * Like lazy_dfa::set_prefilter, this is only valid for the search program.
+   */
+  void set_prefilter(const literal_prefilter<char_type>* prefilter) {
+    prefilter_ = prefilter;
+    max_literal_len_ = 0;
+    if (!prefilter_) return;
+    for (auto& literal : prefilter_->literals()) {
+      if (literal.size() > max_literal_len_) max_literal_len_ = literal.size();
+    }
+  }
+
+  /*! \brief Index the transitions of the DFAs by classes, like
+   * lazy_dfa::set_byte_classes.
+   */
+  void set_byte_classes(const byte_classes* classes) { classes_ = classes; }
+
+  /*! \brief Find the end of the leftmost-first match in [first, last) with
+   * chunk_count chunks run by executor.
+   */
+  template <class Executor>
+  dfa_status find(RandomIt first, RandomIt last, std::size_t chunk_count,
+                  Executor executor, RandomIt& match_end) {
+    std::size_t size = last - first;
+    std::vector<chunk> chunks(chunk_count);
+    for (std::size_t i = 0; i < chunk_count; ++i) {
+      chunks[i].first = first + size * i / chunk_count;
+      chunks[i].last = first + size * (i + 1) / chunk_count;
+    }
+    executor(chunk_count, [&](std::size_t i) { scan(chunks[i], last); });
+    return stitch(chunks, last, match_end);
+  }
+
+ private:
+  /*! \brief The result of the speculative scan of a chunk.
+   */
+  struct chunk {
+    RandomIt first;
+    RandomIt last;
+
+    /*! \brief The states at first + k * checkpoint_interval until the first
+     * match state.
+     */
+    std::vector<std::vector<int>> checkpoints;
+
+    bool gave_up = false;
+
+    /*! \brief True if a match state or a dead state is reached in
+     * [first, last), at match_pos.
+     */
+    bool matched = false;
+
+    RandomIt match_pos;
+    std::vector<int> match_state;
+
+    /*! \brief The state at last if no match state or dead state is reached.
+     */
+    std::vector<int> last_state;
+  };
+
+  const nfa_type& nfa_;
+  int start_id_;
+  parallel_options options_;
+  const literal_prefilter<char_type>* prefilter_ = nullptr;
+  std::size_t max_literal_len_ = 0;
+  const byte_classes* classes_ = nullptr;
+
+  /*! \brief Return the first candidate of the prefilter in [first, c.last),
+   * or c.last.
+   *
+   * A literal starting in the chunk may end in the next chunk, so the literals
+   * are searched a bit past the chunk.
+   */
+  RandomIt skip(const chunk& c, RandomIt first, RandomIt last) const {
+    std::size_t rest = last - c.last;
+    RandomIt limit = c.last + std::min(rest, max_literal_len_);
+    RandomIt candidate = prefilter_->find(first, limit);
+    return candidate < c.last ? candidate : c.last;
+  }
+
+  void scan(chunk& c, RandomIt last) {
+    dfa_type dfa(nfa_, start_id_);
+    dfa.set_byte_classes(classes_);
+    int s = dfa.start();
+    std::size_t interval = options_.checkpoint_interval;
+    for (RandomIt it = c.first; it != c.last; ++it) {
+      if (s == dfa.start() && prefilter_ && !prefilter_->empty()) {
+        // The DFA stays in the start state until the next candidate.
+        RandomIt candidate = skip(c, it, last);
+        std::size_t offset = it - c.first;
+        std::size_t end = candidate - c.first;
+        for (offset = (offset + interval - 1) / interval * interval;
+             offset < end; offset += interval) {
+          c.checkpoints.push_back(dfa.candidates(s));
+        }
+        it = candidate;
+        if (it == c.last) break;
+      }
+      if ((it - c.first) % interval == 0) {
+        c.checkpoints.push_back(dfa.candidates(s));
+      }
+      if (dfa.is_match(s) || dfa.is_dead(s)) {
+        c.matched = true;
+        c.match_pos = it;
+        c.match_state = dfa.candidates(s);
+        return;
+      }
+      s = dfa.next(s, *it);
+      if (s == dfa_type::k_unknown) {
+        c.gave_up = true;
+        return;
+      }
+    }
+    c.last_state = dfa.candidates(s);
+  }
+
+  dfa_status stitch(std::vector<chunk>& chunks, RandomIt last,
+                    RandomIt& match_end) {
+    dfa_type dfa(nfa_, start_id_);
+    dfa.set_prefilter(prefilter_);
+    dfa.set_byte_classes(classes_);
+    std::vector<int> start_state = dfa.candidates(dfa.start());
+    std::vector<int> state = start_state;
+    std::size_t interval = options_.checkpoint_interval;
+
+    for (auto& c : chunks) {
+      RandomIt resume_pos = c.first;
+      bool resume = false;
+      int s = dfa_type::k_unknown;
+
+      if (state == start_state) {
+        if (c.gave_up) return k_dfa_gave_up;
+        if (c.matched) {
+          resume_pos = c.match_pos;
+          s = dfa.state_of(c.match_state);
+          resume = true;
+        } else {
+          state = c.last_state;
+        }
+      } else {
+        // Rescan until the state is the same as a recorded one.
+        s = dfa.state_of(state);
+        bool converged = false;
+        for (RandomIt it = c.first; it != c.last; ++it) {
+          std::size_t offset = it - c.first;
+          if (offset % interval == 0 &&
+              offset / interval < c.checkpoints.size() &&
+              dfa.candidates(s) == c.checkpoints[offset / interval]) {
+            converged = true;
+            break;
+          }
+          if (dfa.is_match(s) || dfa.is_dead(s)) {
+            resume_pos = it;
+            resume = true;
+            break;
+          }
+          s = dfa.next(s, *it);
+          if (s == dfa_type::k_unknown) return k_dfa_gave_up;
+        }
+
+        if (converged) {
+          if (c.gave_up) return k_dfa_gave_up;
+          if (c.matched) {
+            resume_pos = c.match_pos;
+            s = dfa.state_of(c.match_state);
+            resume = true;
+          } else {
+            state = c.last_state;
+          }
+        } else if (!resume) {
+          state = dfa.candidates(s);
+        }
+      }
+
+      if (resume) return dfa.find_from(s, resume_pos, last, match_end);
+    }
+
+    int s = dfa.state_of(state);
+    if (!dfa.is_match(s)) return k_dfa_no_match;
+    match_end = last;
+    return k_dfa_match;
+  }
+};
+
+/*! \brief Return the number of chunks of [first, last) searched in parallel,
+ * or 1 if the search should be sequential.
+ */
+template <class RandomIt, class CharT, class Traits>
+std::size_t parallel_chunk_count(RandomIt first, RandomIt last,
+                                 const basic_regex<CharT, Traits>& e,
+                                 const parallel_options& options) {
+  if (e.nfa().search_start_id() < 0) return 1;
+
+  std::size_t size = last - first;
+  std::size_t min_chunk_size =
+      options.min_chunk_size > 0 ? options.min_chunk_size : 1;
+  std::size_t n = size / min_chunk_size;
+  if (n > options.threads) n = options.threads;
+  return n < 2 ? 1 : n;
+}
+
+/*! \brief Return true if a substring of [first, last) matches e, searching
+ * the chunks of the input in parallel with executor.
+ *
+ * Small inputs are searched sequentially.
+ */
+template <class RandomIt, class CharT, class Traits,
+          class Executor = thread_executor>
+bool regex_search_parallel(RandomIt first, RandomIt last,
+                           const basic_regex<CharT, Traits>& e,
+                           const parallel_options& options = {},
+                           Executor executor = Executor()) {
+  typedef typename basic_regex<CharT, Traits>::nfa_type NFA;
+  std::size_t chunk_count = parallel_chunk_count(first, last, e, options);
+  if (chunk_count < 2) return regex_search(first, last, e);
+
+  parallel_dfa_search<NFA, RandomIt> search(
+      e.nfa(), e.nfa().search_start_id(), options);
+  search.set_prefilter(&e.prefilter());
+  search.set_byte_classes(&e.classes());
+  RandomIt match_end;
+  switch (search.find(first, last, chunk_count, executor, match_end)) {
+    case k_dfa_match:
+      return true;
+    case k_dfa_no_match:
+      return false;
+    default:
+      return regex_search(first, last, e);
+  }
+}
+
+/*! \brief Find the first substring of [first, last) that matches e,
+ * searching the chunks of the input in parallel with executor.
+ *
+ * The parallel search finds the end of the match. The start of the match and
+ * the groups are found sequentially, only over the match. Small inputs are
+ * searched sequentially.
+ */
+template <class RandomIt, class Alloc, class CharT, class Traits,
+          class Executor = thread_executor>
+bool regex_search_parallel(RandomIt first, RandomIt last,
+                           match_results<RandomIt, Alloc>& m,
+                           const basic_regex<CharT, Traits>& e,
+                           const parallel_options& options = {},
+                           Executor executor = Executor()) {
+  typedef typename basic_regex<CharT, Traits>::nfa_type NFA;
+  std::size_t chunk_count = parallel_chunk_count(first, last, e, options);
+  if (chunk_count < 2 || e.reverse_nfa().start_id() < 0) {
+    return regex_search(first, last, m, e);
+  }
+
+  parallel_dfa_search<NFA, RandomIt> search(
+      e.nfa(), e.nfa().search_start_id(), options);
+  search.set_prefilter(&e.prefilter());
+  search.set_byte_classes(&e.classes());
+  RandomIt match_first, match_last;
+  switch (search.find(first, last, chunk_count, executor, match_last)) {
+    case k_dfa_match:
+      if (find_match_start(first, match_last, e, match_first) == k_dfa_match) {
+        return regex_match(match_first, match_last, m, e);
+      }
+      return regex_search(first, last, m, e);
+    case k_dfa_no_match:
+      return false;
+    default:
+      return regex_search(first, last, m, e);
+  }
+}
+}
+
+#endif
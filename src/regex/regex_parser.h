@@ -1,8 +1,12 @@
 #ifndef __REGEX_PARSER_H__
 #define __REGEX_PARSER_H__
 
+#include <type_traits>
+#include <vector>
+
 #include "regex_nfa.h"
 #include "regex_scanner.h"
+#include "regex_utf8.h"
 
 namespace regex {
 
@@ -33,7 +37,19 @@ namespace regex {
  *           |  <>
  *
  * Atom     ::= <kCharacter>
+ *           |  <kCharClass>
  *           |  <kLeftGroup> Sub <kRightGroup>
+ *           |  <kLeftBracket> Bracket <kRightBracket>
+ *
+ * Bracket  ::= <kNegation> BracketItem RestBracket
+ *           |  BracketItem RestBracket
+ *
+ * RestBracket ::= BracketItem RestBracket
+ *              |  <>
+ *
+ * BracketItem ::= <kCharacter>
+ *              |  <kCharacter> <kRange> <kCharacter>
+ *              |  <kCharClass>
  *
  * Quantifier  ::= <kStar>
  *              |  <kPlus>
@@ -41,6 +57,10 @@ namespace regex {
  *
  * The parser functions are named with the snake case of the corresponding
  * nonterminal syntax.
+ *
+ * If CharCategory is a category of the code points and the NFA matches bytes,
+ * each character category is compiled into the UTF-8 sequences of its code
+ * points, so the NFA runs directly over UTF-8 input.
  */
 template <class Scanner, class CharCategory, class NFA>
 class regex_parser {
@@ -48,6 +68,7 @@ class regex_parser {
   typedef Scanner scanner_type;
   typedef typename scanner_type::char_type char_type;
   typedef CharCategory char_category_type;
+  typedef char_set<typename char_category_type::char_type> char_set_type;
   typedef NFA nfa_type;
   typedef typename nfa_type::allocator_type allocator_type;
 
@@ -214,9 +235,16 @@ class regex_parser {
    */
   fragment parse_atom() {
     if (scanner_.cur_token() == k_character) {
-      int sid = nfa_.append_match_char_category(scanner_.cur_cc(), k_dangled);
+      fragment f = append_category(scanner_.cur_cc());
       scanner_.advance();
-      return {sid, sid, false};
+      return f;
+    } else if (scanner_.cur_token() == k_char_class) {
+      fragment f = append_set(scanner_.cur_set());
+      scanner_.advance();
+      return f;
+    } else if (scanner_.cur_token() == k_left_bracket) {
+      scanner_.advance();
+      return append_set(parse_bracket());
     } else if (scanner_.cur_token() == k_left_group) {
       scanner_.advance();
       fragment s = parse_sub();
@@ -230,6 +258,123 @@ class regex_parser {
     }
   }
 
+  /*! \brief Parse nonterminal Bracket and the right bracket.
+   */
+  char_set_type parse_bracket() {
+    typedef typename char_category_type::char_type cc_char_type;
+    typedef typename char_category_type::unsigned_char_type unsigned_char_type;
+
+    bool negated = false;
+    if (scanner_.cur_token() == k_negation) {
+      negated = true;
+      scanner_.advance();
+    }
+
+    char_set_type set;
+    while (scanner_.cur_token() != k_right_bracket) {
+      if (scanner_.cur_token() == k_char_class) {
+        set.insert(scanner_.cur_set());
+        scanner_.advance();
+      } else if (scanner_.cur_token() == k_character) {
+        cc_char_type lo = scanner_.cur_cc().ch();
+        scanner_.advance();
+        if (scanner_.cur_token() != k_range) {
+          set.insert(lo);
+          continue;
+        }
+        scanner_.advance();
+        if (scanner_.cur_token() != k_character) {
+          regex_throw(k_bad_range, scanner_.cur_pos());
+        }
+        cc_char_type hi = scanner_.cur_cc().ch();
+        if (unsigned_char_type(hi) < unsigned_char_type(lo)) {
+          regex_throw(k_bad_range, scanner_.cur_pos());
+        }
+        set.insert(lo, hi);
+        scanner_.advance();
+      } else if (scanner_.cur_token() == k_eof) {
+        regex_throw(k_missing_right_bracket, scanner_.cur_pos());
+      } else {
+        regex_throw(k_bad_range, scanner_.cur_pos());
+      }
+    }
+    scanner_.advance();
+
+    if (negated) set.negate();
+    return set;
+  }
+
+  /*! \brief True if the characters are code points compiled into UTF-8.
+   */
+  typedef std::integral_constant<
+      bool, !std::is_same<char_category_type,
+                          typename nfa_type::char_category_type>::value>
+      is_utf8;
+
+  /*! \brief Append the instructions matching cc.
+   */
+  fragment append_category(const char_category_type& cc) {
+    return append_category(cc, is_utf8());
+  }
+
+  fragment append_category(const char_category_type& cc, std::false_type) {
+    int sid = nfa_.append_match_char_category(cc, k_dangled);
+    return {sid, sid, false};
+  }
+
+  fragment append_category(const char_category_type& cc, std::true_type) {
+    return append_utf8_ranges(cc.ranges());
+  }
+
+  /*! \brief Append the instructions matching the characters of set.
+   */
+  fragment append_set(const char_set_type& set) {
+    return append_set(set, is_utf8());
+  }
+
+  fragment append_set(const char_set_type& set, std::false_type) {
+    int sid = nfa_.append_match_char_set(set, k_dangled);
+    return {sid, sid, false};
+  }
+
+  fragment append_set(const char_set_type& set, std::true_type) {
+    return append_utf8_ranges(set.ranges());
+  }
+
+  /*! \brief Append the alternation of the UTF-8 sequences of the code points
+   * in ranges.
+   *
+   * Each sequence is a chain of instructions matching byte ranges. The
+   * sequences may share their first bytes, but they cover disjoint code
+   * points, so at most one of them completes.
+   */
+  template <class Range>
+  fragment append_utf8_ranges(const std::vector<Range>& ranges) {
+    typedef typename nfa_type::char_set_type byte_set_type;
+
+    std::vector<utf8_sequence> seqs;
+    for (auto& r : ranges) utf8_sequences(r.first, r.second, seqs);
+    if (seqs.empty()) {
+      int sid = nfa_.append_match_char_set(byte_set_type(), k_dangled);
+      return {sid, sid, false};
+    }
+
+    int end = seqs.size() == 1 ? k_dangled : nfa_.append_goto(k_dangled);
+    int start = k_dangled;
+    int last = k_dangled;
+    for (auto seq = seqs.rbegin(); seq != seqs.rend(); ++seq) {
+      int next = end;
+      for (int i = seq->length - 1; i >= 0; --i) {
+        byte_set_type bytes;
+        bytes.insert(seq->lo[i], seq->hi[i]);
+        next = nfa_.append_match_char_set(bytes, next);
+        if (last == k_dangled) last = next;
+      }
+      start = start == k_dangled ? next : nfa_.append_fork(next, start);
+    }
+    return {start, end == k_dangled ? last : end, false};
+  }
+
   /*! \brief Link dangled pointers of nfa_[end] to next.
    */
   void link_dangled_pointer(int end, int next) {
@@ -242,7 +387,8 @@ class regex_parser {
    */
   bool is_atom_head() {
     auto t = scanner_.cur_token();
-    return t == k_character || t == k_left_group;
+    return t == k_character || t == k_char_class || t == k_left_group ||
+           t == k_left_bracket;
   }
 };
 }
@@ -0,0 +1,222 @@
+#ifndef __REGEX_PREFILTER_H__
+#define __REGEX_PREFILTER_H__
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "regex_aho_corasick.h"
+#include "regex_nfa.h"
+#include "regex_traits.h"
+
+namespace regex {
+
+/*! \brief Collect the literal prefixes of the program from start_id.
+ *
+ * It enumerates the paths from start_id and collects the ordinary characters
+ * on each path until the path reaches an accept, another kind of char
+ * category, a loop or max_len chars. Every string matching the program starts
+ * with one of the literals. exact is set if all the paths reach an accept, in
+ * which case the program matches exactly the literals.
+ *
+ * Return false if a path has no literal prefix or there are more than
+ * max_literals literals.
+ */
+template <class NFA>
+bool literal_prefixes(
+    const NFA& nfa, int start_id,
+    std::vector<std::basic_string<typename NFA::char_type>>& literals,
+    bool& exact, std::size_t max_literals = 100000,
+    std::size_t max_len = 256) {
+  // A frame continues the path from pc after the literal is truncated to len.
+  // A leave frame removes the fork pc from the current path.
+  struct frame {
+    int pc;
+    std::size_t len;
+    bool leave;
+  };
+
+  std::basic_string<typename NFA::char_type> literal;
+  std::vector<frame> stack{{start_id, 0, false}};
+  std::vector<bool> on_path(nfa.size(), false);
+  exact = true;
+
+  auto add_literal = [&](bool at_accept) {
+    if (literal.empty() || literals.size() >= max_literals) return false;
+    literals.push_back(literal);
+    exact = exact && at_accept;
+    return true;
+  };
+
+  while (!stack.empty()) {
+    frame f = stack.back();
+    stack.pop_back();
+    if (f.leave) {
+      on_path[f.pc] = false;
+      continue;
+    }
+
+    literal.resize(f.len);
+    int pc = f.pc;
+    bool ok = true;
+    while (ok) {
+      auto& insn = nfa[pc];
+      if (insn.opcode == k_fork) {
+        if (on_path[pc]) {
+          ok = add_literal(false);
+          break;
+        }
+        on_path[pc] = true;
+        stack.push_back({pc, literal.size(), true});
+        stack.push_back({insn.next2, literal.size(), false});
+        pc = insn.next;
+      } else if (insn.opcode == k_match_char_category) {
+        if (insn.cc.type() != k_cc_ordinary_char || literal.size() >= max_len) {
+          ok = add_literal(false);
+          break;
+        }
+        literal.push_back(insn.cc.ch());
+        pc = insn.next;
+      } else if (insn.opcode == k_accept) {
+        ok = add_literal(true);
+        break;
+      } else {
+        pc = insn.next;
+      }
+    }
+    if (!ok) return false;
+  }
+
+  // A literal is not needed if another literal is its prefix.
+  std::sort(literals.begin(), literals.end());
+  std::size_t kept = 0;
+  for (std::size_t i = 0; i < literals.size(); ++i) {
+    if (kept > 0 && literals[i].compare(0, literals[kept - 1].size(),
+                                        literals[kept - 1]) == 0) {
+      continue;
+    }
+    if (kept != i) literals[kept] = std::move(literals[i]);
+    ++kept;
+  }
+  literals.resize(kept);
+  return true;
+}
+
+/*! \brief Skip the positions where a match cannot start.
+ *
+ * A match can only start where one of the literal prefixes of the regex
+ * occurs. A single literal is searched with memchr and memcmp, and a set of
+ * literals with an Aho-Corasick automaton. If the regex has no literal
+ * prefixes, every position is a candidate.
+ */
+template <class CharT>
+class literal_prefilter {
+ public:
+  typedef CharT char_type;
+  typedef std::basic_string<char_type> string_type;
+
+  literal_prefilter() = default;
+
+  /*! \brief Create a prefilter of the literals.
+   *
+   * If exact is true, the regex matches exactly the literals.
+   */
+  explicit literal_prefilter(std::vector<string_type> literals,
+                             bool exact = false)
+      : literals_(std::move(literals)), exact_(exact) {
+    if (literals_.size() > 1) ac_ = aho_corasick<char_type>(literals_);
+  }
+
+  enum {
+    /*! \brief The maximum number of the distinct first chars of the literals
+     * of an inexact prefilter.
+     *
+     * With more first chars, most positions are candidates and skipping to
+     * them costs more than it saves.
+     */
+    k_max_first_chars = 16,
+  };
+
+  /*! \brief Create the prefilter of the program from start_id.
+   */
+  template <class NFA>
+  static literal_prefilter from_nfa(const NFA& nfa, int start_id) {
+    std::vector<string_type> literals;
+    bool exact;
+    if (start_id < 0 || !literal_prefixes(nfa, start_id, literals, exact)) {
+      return literal_prefilter();
+    }
+
+    // The literals are sorted, so the same first chars are adjacent.
+    std::size_t first_chars = 0;
+    for (std::size_t i = 0; i < literals.size(); ++i) {
+      if (i == 0 || literals[i][0] != literals[i - 1][0]) ++first_chars;
+    }
+    if (!exact && first_chars > k_max_first_chars) return literal_prefilter();
+    return literal_prefilter(std::move(literals), exact);
+  }
+
+  /*! \brief Return true if the prefilter does not skip any position.
+   */
+  bool empty() const { return literals_.empty(); }
+
+  /*! \brief Return the literal prefixes.
+   */
+  const std::vector<string_type>& literals() const { return literals_; }
+
+  /*! \brief Return true if the regex matches exactly the literals.
+   *
+   * Then a candidate position is always the start of a match.
+   */
+  bool exact() const { return exact_; }
+
+  /*! \brief Return the first candidate position in [first, last), or last if
+   * there is none.
+   */
+  template <class BidirIt>
+  BidirIt find(BidirIt first, BidirIt last) const {
+    if (empty()) return first;
+    if (literals_.size() > 1) return ac_.find(first, last);
+    return find(first, last,
+                std::integral_constant<
+                    bool, is_contiguous_byte_iterator<BidirIt>::value>());
+  }
+
+ private:
+  std::vector<string_type> literals_;
+  bool exact_ = false;
+  aho_corasick<char_type> ac_;
+
+  template <class BidirIt>
+  BidirIt find(BidirIt first, BidirIt last, std::false_type) const {
+    auto& literal = literals_.front();
+    return std::search(first, last, literal.begin(), literal.end());
+  }
+
+  template <class BidirIt>
+  BidirIt find(BidirIt first, BidirIt last, std::true_type) const {
+    if (first == last) return last;
+
+    const char* begin = reinterpret_cast<const char*>(&*first);
+    const char* p = begin;
+    const char* end = begin + (last - first);
+    const char* literal = reinterpret_cast<const char*>(literals_[0].data());
+    std::size_t n = literals_[0].size();
+
+    while (std::size_t(end - p) >= n) {
+      p = static_cast<const char*>(std::memchr(p, literal[0], end - p - n + 1));
+      if (!p) break;
+      if (std::memcmp(p + 1, literal + 1, n - 1) == 0) {
+        return first + (p - begin);
+      }
+      ++p;
+    }
+    return last;
+  }
+};
+}
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef __REGEX_REVERSE_H__
+#define __REGEX_REVERSE_H__
+
+#include <cstddef>
+#include <vector>
+
+#include "regex_nfa.h"
+
+namespace regex {
+
+/*! \brief Build the program matching the reversed strings of the program of
+ * nfa from start_id.
+ *
+ * The program is reversed through its position automaton. The positions are
+ * the instructions of k_match_char_category, and position q follows position
+ * p if q is in the e-closure of the next instruction of p. In the reversed
+ * program, each position jumps to the positions it follows, the start jumps to
+ * the positions after which the program accepts, and a position accepts if it
+ * can match the first char.
+ *
+ * The reversed program has no groups and no priorities, so it is only useful
+ * for finding the longest match. Return false if the reversed program would
+ * have more than max_insns instructions.
+ */
+template <class NFA>
+bool reverse_nfa(const NFA& nfa, int start_id, NFA& reversed,
+                 std::size_t max_insns = 100000) {
+  // Number the positions reachable from start_id.
+  std::vector<int> pcs;
+  std::vector<int> positions(nfa.size(), -1);
+  std::vector<bool> reachable(nfa.size(), false);
+  std::vector<int> stack{start_id};
+  while (!stack.empty()) {
+    int pc = stack.back();
+    stack.pop_back();
+    if (reachable[pc]) continue;
+    reachable[pc] = true;
+
+    auto& insn = nfa[pc];
+    if (insn.opcode == k_match_char_category) {
+      positions[pc] = pcs.size();
+      pcs.push_back(pc);
+    }
+    if (insn.opcode == k_fork) stack.push_back(insn.next2);
+    if (insn.opcode != k_accept) stack.push_back(insn.next);
+  }
+
+  // Return the positions in the e-closure of pc, and set accepts if the
+  // e-closure contains an accept.
+  std::vector<unsigned> visited(nfa.size(), 0);
+  unsigned stamp = 0;
+  auto closure = [&](int pc, std::vector<int>& out, bool& accepts) {
+    ++stamp;
+    accepts = false;
+    stack.assign(1, pc);
+    while (!stack.empty()) {
+      pc = stack.back();
+      stack.pop_back();
+      if (visited[pc] == stamp) continue;
+      visited[pc] = stamp;
+
+      auto& insn = nfa[pc];
+      switch (insn.opcode) {
+        case k_match_char_category:
+          out.push_back(positions[pc]);
+          break;
+        case k_accept:
+          accepts = true;
+          break;
+        case k_fork:
+          stack.push_back(insn.next2);
+          stack.push_back(insn.next);
+          break;
+        default:
+          stack.push_back(insn.next);
+          break;
+      }
+    }
+  };
+
+  // The reversed edges: preceding[q] are the positions that q follows.
+  std::vector<std::vector<int>> preceding(pcs.size());
+  std::vector<int> finals;
+  std::vector<bool> initial(pcs.size(), false);
+  bool start_accepts;
+  std::vector<int> follows;
+  std::size_t edges = 0;
+
+  closure(start_id, follows, start_accepts);
+  for (int q : follows) initial[q] = true;
+  for (std::size_t p = 0; p < pcs.size(); ++p) {
+    bool accepts;
+    follows.clear();
+    closure(nfa[pcs[p]].next, follows, accepts);
+    if (accepts) finals.push_back(p);
+    for (int q : follows) preceding[q].push_back(p);
+    edges += follows.size() + 1;
+    if (edges > max_insns) return false;
+  }
+
+  // Lay out the positions, then the accept, then the jumps.
+  NFA r;
+  r.set_char_sets(nfa.char_sets());
+  for (int pc : pcs) r.append_match_char_category(nfa[pc].cc, k_dangled);
+  int accept_id = r.append_accept();
+
+  auto append_jumps = [&](const std::vector<int>& targets, bool accepts) {
+    std::vector<int> ids(targets.begin(), targets.end());
+    if (accepts) ids.push_back(accept_id);
+    if (ids.empty()) {
+      int dead = r.append_goto(k_dangled);
+      r[dead].next = dead;
+      return dead;
+    }
+    int id = ids.back();
+    for (std::size_t i = ids.size() - 1; i-- > 0;) {
+      id = r.append_fork(ids[i], id);
+    }
+    return id;
+  };
+
+  for (std::size_t q = 0; q < pcs.size(); ++q) {
+    int jumps = append_jumps(preceding[q], initial[q]);
+    r[q].next = jumps;
+  }
+  r.set_start_id(append_jumps(finals, start_accepts));
+  r.assert_complete();
+  reversed = std::move(r);
+  return true;
+}
+}
+
+#endif
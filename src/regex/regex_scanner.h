@@ -2,11 +2,15 @@
 #define __REGEX_SCANNER_H__
 
 #include <cassert>
+#include <cstddef>
 #include <iterator>
 #include <locale>
+#include <string>
+#include <type_traits>
 
 #include "regex_char_category.h"
 #include "regex_except.h"
+#include "regex_utf8.h"
 
 namespace regex {
 
@@ -25,27 +29,180 @@ enum token {
   k_right_bracket,  //!< "]" operator
   k_negation,       //!< "^" as the first character after a left bracket
   k_char_class,     //!< a character class
+  k_range,          //!< "-" between two characters in brackets
 };
 
 /*! \brief Character classes.
+ *
+ * The classes are the ASCII ones, whatever the locale is.
  */
 enum character_class {
-  k_cc_alnum,     //!< [:alnum:] = [A-Za-z0-9]
-  k_cc_word,      //!< [:word] = \w = [A-Za-z0-9_]
-  k_cc_not_word,  //!< \W = [^A-Za-z0-9_]
-  k_cc_
+  k_cc_alnum,      //!< [:alnum:] = [A-Za-z0-9]
+  k_cc_word,       //!< [:word] = \w = [A-Za-z0-9_]
+  k_cc_not_word,   //!< \W = [^A-Za-z0-9_]
+  k_cc_alpha,      //!< [:alpha:] = [A-Za-z]
+  k_cc_digit,      //!< [:digit:] = \d = [0-9]
+  k_cc_not_digit,  //!< \D = [^0-9]
+  k_cc_space,      //!< [:space:] = \s = [\t\n\v\f\r ]
+  k_cc_not_space,  //!< \S = [^\t\n\v\f\r ]
+  k_cc_lower,      //!< [:lower:] = [a-z]
+  k_cc_upper,      //!< [:upper:] = [A-Z]
+  k_cc_xdigit,     //!< [:xdigit:] = [0-9A-Fa-f]
 };
 
-/*! \brief The scanner of the regex.
+/*! \brief The characters of a character class, as ranges of ASCII chars.
+ */
+struct class_ranges {
+  char first[4] = {};
+  char last[4] = {};
+  std::size_t count = 0;
+
+  /*! \brief True if the class is the characters out of the ranges.
+   */
+  bool negated = false;
+
+  constexpr void add(char lo, char hi) {
+    first[count] = lo;
+    last[count] = hi;
+    ++count;
+  }
+};
+
+/*! \brief Return the ranges of the class cls.
+ *
+ * regex_scanner and static_parser both build their sets from them.
+ */
+constexpr class_ranges character_class_ranges(character_class cls) {
+  class_ranges r;
+  switch (cls) {
+    case k_cc_not_word:
+      r.negated = true;
+    // fall through
+    case k_cc_word:
+      r.add('_', '_');
+    // fall through
+    case k_cc_alnum:
+      r.add('0', '9');
+    // fall through
+    case k_cc_alpha:
+      r.add('A', 'Z');
+      r.add('a', 'z');
+      break;
+    case k_cc_not_digit:
+      r.negated = true;
+    // fall through
+    case k_cc_digit:
+      r.add('0', '9');
+      break;
+    case k_cc_not_space:
+      r.negated = true;
+    // fall through
+    case k_cc_space:
+      r.add('\t', '\r');
+      r.add(' ', ' ');
+      break;
+    case k_cc_lower:
+      r.add('a', 'z');
+      break;
+    case k_cc_upper:
+      r.add('A', 'Z');
+      break;
+    case k_cc_xdigit:
+      r.add('0', '9');
+      r.add('A', 'F');
+      r.add('a', 'f');
+      break;
+  }
+  return r;
+}
+
+/*! \brief Find the class named [first, last), like alpha in [:alpha:].
+ *
+ * Return true and store the class in cls if there is one.
  */
 template <class Iterator>
+constexpr bool find_class_name(Iterator first, Iterator last,
+                               character_class& cls) {
+  struct class_name {
+    const char* name;
+    character_class cls;
+  };
+  const class_name names[] = {
+      {"alnum", k_cc_alnum}, {"alpha", k_cc_alpha}, {"digit", k_cc_digit},
+      {"lower", k_cc_lower}, {"space", k_cc_space}, {"upper", k_cc_upper},
+      {"word", k_cc_word},   {"xdigit", k_cc_xdigit},
+  };
+  for (auto& n : names) {
+    Iterator cur = first;
+    std::size_t i = 0;
+    while (cur != last && n.name[i] != '\0' && *cur == n.name[i]) {
+      ++cur;
+      ++i;
+    }
+    if (cur == last && n.name[i] == '\0') {
+      cls = n.cls;
+      return true;
+    }
+  }
+  return false;
+}
+
+/*! \brief Return true if the escape of c is the character c, like \* or \\.
+ */
+constexpr bool is_escaped_char(char c) {
+  const char escaped[] = "*+?()\\|[]-^.";
+  for (char e : escaped) {
+    if (e != '\0' && c == e) return true;
+  }
+  return false;
+}
+
+/*! \brief Find the class of the escape of c, like \d.
+ *
+ * Return true and store the class in cls if there is one.
+ */
+constexpr bool find_escape_class(char c, character_class& cls) {
+  switch (c) {
+    case 'w':
+      cls = k_cc_word;
+      return true;
+    case 'W':
+      cls = k_cc_not_word;
+      return true;
+    case 'd':
+      cls = k_cc_digit;
+      return true;
+    case 'D':
+      cls = k_cc_not_digit;
+      return true;
+    case 's':
+      cls = k_cc_space;
+      return true;
+    case 'S':
+      cls = k_cc_not_space;
+      return true;
+    default:
+      return false;
+  }
+}
+
+/*! \brief The scanner of the regex.
+ *
+ * The characters of the categories are the chars of the pattern, or the code
+ * points of a UTF-8 pattern if CharCategory is a category of char32_t and the
+ * chars are bytes. Then a multi-byte sequence is a single character.
+ */
+template <class Iterator,
+          class CharCategory = char_category<
+              typename std::iterator_traits<Iterator>::value_type>>
 class regex_scanner {
  public:
   typedef Iterator iterator;
   typedef typename std::iterator_traits<iterator>::value_type char_type;
   typedef const std::ctype<char_type> ctype_type;
   typedef std::locale locale_type;
-  typedef char_category<char_type> char_category_type;
+  typedef CharCategory char_category_type;
+  typedef char_set<typename char_category_type::char_type> char_set_type;
 
   regex_scanner(iterator first, iterator last, const locale_type& loc)
       : first_(first),
@@ -66,6 +223,19 @@ class regex_scanner {
    */
   char_category_type cur_cc() const noexcept { return cur_cc_; }
 
+  /*! \brief Return the characters of the current character class.
+   *
+   * The set is valid only if the current token is k_char_class.
+   */
+  const char_set_type& cur_set() const noexcept { return cur_set_; }
+
+  /*! \brief Return the current character class.
+   *
+   * The current character class is valid only if the current token is
+   * k_char_class.
+   */
+  character_class cur_class() const noexcept { return cur_class_; }
+
   /*! \brief Return the current position.
    */
   int cur_pos() const noexcept { return pos_; }
@@ -73,7 +243,9 @@ class regex_scanner {
   /*! \brief Advance the scanner and get the next token.
    */
   void advance() {
-    if (first_ == last_) {
+    if (in_bracket_) {
+      advance_in_bracket();
+    } else if (first_ == last_) {
       cur_token_ = k_eof;
     } else if (*first_ == ctype_.widen('*')) {
       cur_token_ = k_star;
@@ -93,12 +265,23 @@ class regex_scanner {
     } else if (*first_ == ctype_.widen('|')) {
       cur_token_ = k_or;
       advance_char();
+    } else if (is_utf8() && *first_ == ctype_.widen('.')) {
+      // "." is the any-character atom only in UTF-8 patterns. Elsewhere it
+      // stays an ordinary character, as it always has been.
+      cur_token_ = k_character;
+      cur_cc_ = char_category_type::any_char();
+      advance_char();
+    } else if (*first_ == ctype_.widen('[')) {
+      cur_token_ = k_left_bracket;
+      advance_char();
+      in_bracket_ = true;
+      bracket_pos_ = pos_;
+      bracket_empty_ = true;
     } else if (*first_ == ctype_.widen('\\')) {
       eat_escape();
     } else {
       cur_token_ = k_character;
-      cur_cc_ = char_category_type::ordinary_char(*first_);
-      advance_char();
+      cur_cc_ = char_category_type::ordinary_char(eat_char());
     }
   }
 
@@ -110,10 +293,107 @@ class regex_scanner {
 
   token cur_token_;
   char_category_type cur_cc_;
+  char_set_type cur_set_;
+  character_class cur_class_ = k_cc_alnum;
+
+  bool in_bracket_ = false;
+
+  /*! \brief The position after the left bracket.
+   */
+  int bracket_pos_ = 0;
+
+  /*! \brief True if no character or class has been scanned in the brackets.
+   */
+  bool bracket_empty_ = false;
+
+  /*! \brief Advance the scanner in brackets.
+   *
+   * "^" is the negation only right after the left bracket. "]" and "-" are
+   * ordinary characters before the first character, and so is "-" before the
+   * right bracket.
+   */
+  void advance_in_bracket() {
+    if (first_ == last_) {
+      cur_token_ = k_eof;
+      return;
+    }
+
+    auto c = *first_;
+    if (c == ctype_.widen('^') && pos_ == bracket_pos_) {
+      cur_token_ = k_negation;
+      advance_char();
+      return;
+    }
+    if (c == ctype_.widen(']') && !bracket_empty_) {
+      cur_token_ = k_right_bracket;
+      advance_char();
+      in_bracket_ = false;
+      return;
+    }
+
+    bool empty = bracket_empty_;
+    bracket_empty_ = false;
+    auto next = first_;
+    ++next;
+    if (c == ctype_.widen('-') && !empty && next != last_ &&
+        *next != ctype_.widen(']')) {
+      cur_token_ = k_range;
+      advance_char();
+    } else if (c == ctype_.widen('[') && next != last_ &&
+               *next == ctype_.widen(':')) {
+      eat_class_name();
+    } else if (c == ctype_.widen('\\')) {
+      eat_escape();
+    } else {
+      cur_token_ = k_character;
+      cur_cc_ = char_category_type::ordinary_char(eat_char());
+    }
+  }
+
+  /*! \brief Eat a named class like [:alpha:].
+   */
+  void eat_class_name() {
+    advance_char();
+    advance_char();
+
+    std::string name;
+    while (first_ != last_ && *first_ != ctype_.widen(':')) {
+      name += ctype_.narrow(*first_, '\0');
+      advance_char();
+    }
+    if (first_ == last_) regex_throw(k_bad_char_class, pos_);
+    advance_char();
+    if (first_ == last_ || *first_ != ctype_.widen(']')) {
+      regex_throw(k_bad_char_class, pos_);
+    }
+    advance_char();
+
+    character_class cls = k_cc_alnum;
+    if (find_class_name(name.begin(), name.end(), cls)) {
+      set_class(cls);
+      return;
+    }
+    regex_throw(k_bad_char_class, pos_);
+  }
+
+  /*! \brief Make the current token the character class cls.
+   */
+  void set_class(character_class cls) {
+    cur_token_ = k_char_class;
+    cur_class_ = cls;
+    cur_set_ = char_set_type();
+
+    class_ranges r = character_class_ranges(cls);
+    for (std::size_t i = 0; i < r.count; ++i) {
+      cur_set_.insert(ctype_.widen(r.first[i]), ctype_.widen(r.last[i]));
+    }
+    if (r.negated) cur_set_.negate();
+  }
 
   /*! \brief Eat the escaped character.
    *
-   * Currently, the backslash turns a special character into an ordinary one.
+   * The backslash turns a special character into an ordinary one, or makes
+   * \w, \W, \d, \D, \s and \S character classes.
    */
   void eat_escape() {
     assert(*first_ == ctype_.widen('\\'));
@@ -124,18 +404,46 @@ class regex_scanner {
     }
 
     auto c = *first_;
-    if (c == ctype_.widen('*') || c == ctype_.widen('+') ||
-        c == ctype_.widen('?') || c == ctype_.widen('(') ||
-        c == ctype_.widen(')') || c == ctype_.widen('\\') ||
-        c == ctype_.widen('|')) {
+    char narrowed = ctype_.narrow(c, '\0');
+    character_class cls = k_cc_alnum;
+    if (is_escaped_char(narrowed)) {
       cur_token_ = k_character;
       cur_cc_ = char_category_type::ordinary_char(c);
       advance_char();
+    } else if (find_escape_class(narrowed, cls)) {
+      set_class(cls);
+      advance_char();
     } else {
       regex_throw(k_escape_bad_char, pos_);
     }
   }
 
+  /*! \brief Return true if the pattern is decoded from UTF-8.
+   */
+  static bool is_utf8() {
+    return sizeof(char_type) == 1 &&
+           std::is_same<typename char_category_type::char_type,
+                        char32_t>::value;
+  }
+
+  /*! \brief Eat the character at first_, which may take several chars in
+   * UTF-8.
+   */
+  typename char_category_type::char_type eat_char() {
+    typedef typename char_category_type::char_type cc_char_type;
+    if (!is_utf8()) {
+      auto c = *first_;
+      advance_char();
+      return cc_char_type(c);
+    }
+
+    auto cur = first_;
+    long cp = utf8_decode(cur, last_);
+    if (cp < 0) regex_throw(k_bad_utf8, pos_);
+    while (first_ != cur) advance_char();
+    return cc_char_type(cp);
+  }
+
   /*! \brief Advance a character.
    */
   void advance_char() {
@@ -0,0 +1,429 @@
+#ifndef __REGEX_SERIALIZE_H__
+#define __REGEX_SERIALIZE_H__
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "regex.h"
+#include "regex_char_category.h"
+#include "regex_except.h"
+#include "regex_nfa.h"
+#include "regex_packed.h"
+
+namespace regex {
+
+/*! \brief The constants of the binary format of the serialized regexes.
+ *
+ * A blob is a blob_header, the offsets of the programs from the start of the
+ * blob, and the programs. A program is a program_header, its instructions in
+ * the 8-byte form of packed_instruction, its distinct char categories as
+ * category_record, the ranges of the characters of its sets as pairs of
+ * 32-bit words, and the class of each byte.
+ *
+ * If the bit-parallel engine is available, its tables follow: a
+ * bit_parallel_record, the 256 masks of the bytes, the mask of the positions
+ * following each position, and the instruction of each position.
+ *
+ * All the fields are in the native byte order and all the references are
+ * offsets or indices, so the blob can be mapped at any address. The matchers
+ * do not run on the blob itself: regex_blob::load copies a program out of it,
+ * so the pages of a loaded program are not shared by the processes. A blob of
+ * the other byte order has a wrong magic and is rejected, like a blob of
+ * another version or char size.
+ */
+enum blob_constants {
+  k_blob_magic = 0x42584752,  //!< "RGXB" in little endian
+  k_blob_version = 1,
+};
+
+struct blob_header {
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint32_t char_size;
+  std::uint32_t program_count;
+  std::uint32_t size;  //!< The size of the whole blob in bytes
+};
+
+struct program_header {
+  std::uint32_t flags;
+  std::uint32_t mark_count;
+  std::int32_t start_id;
+  std::int32_t search_start_id;
+  std::uint32_t insn_count;
+  std::uint32_t category_count;
+  std::uint32_t range_count;
+  std::uint32_t bit_parallel;  //!< 1 if the bit-parallel tables follow
+  std::uint32_t position_count;
+};
+
+struct bit_parallel_record {
+  std::uint64_t first_mask;
+  std::uint64_t final_mask;
+  std::uint32_t start_accepts;
+  std::uint32_t reserved;
+};
+
+/*! \brief A char category of a program.
+ *
+ * ch is the character of k_cc_ordinary_char. The characters of k_cc_char_set
+ * are the ranges [first_range, first_range + range_count) of the program.
+ */
+struct category_record {
+  std::uint32_t type;
+  std::uint32_t ch;
+  std::uint32_t first_range;
+  std::uint32_t range_count;
+};
+
+/*! \brief Append the program of e to out.
+ */
+template <class CharT, class Traits>
+void serialize_program(const basic_regex<CharT, Traits>& e, std::string& out) {
+  static_assert(sizeof(CharT) <= sizeof(std::uint32_t),
+                "the chars are serialized in 32 bits");
+  typedef typename basic_regex<CharT, Traits>::char_category_type::range_type
+      range_type;
+
+  auto append = [&out](const void* p, std::size_t n) {
+    out.append(static_cast<const char*>(p), n);
+  };
+
+  auto& packed = e.packed();
+  std::vector<category_record> categories;
+  std::vector<std::uint32_t> ranges;
+  for (auto& cc : packed.categories()) {
+    category_record r{std::uint32_t(cc.type()), 0, 0, 0};
+    if (cc.type() == k_cc_ordinary_char) {
+      r.ch = typename std::make_unsigned<CharT>::type(cc.ch());
+    } else if (cc.type() == k_cc_char_set) {
+      r.first_range = ranges.size() / 2;
+      for (const range_type& range : packed.char_sets().ranges(cc)) {
+        ranges.push_back(range.first);
+        ranges.push_back(range.second);
+      }
+      r.range_count = ranges.size() / 2 - r.first_range;
+    }
+    categories.push_back(r);
+  }
+
+  auto& bit_parallel = e.bit_parallel();
+  program_header h{std::uint32_t(e.flags()),
+                   e.mark_count(),
+                   e.nfa().start_id(),
+                   e.nfa().search_start_id(),
+                   std::uint32_t(packed.size()),
+                   std::uint32_t(categories.size()),
+                   std::uint32_t(ranges.size() / 2),
+                   bit_parallel.available(),
+                   std::uint32_t(bit_parallel.position_count())};
+  append(&h, sizeof(h));
+  append(packed.data(), packed.size() * sizeof(packed_instruction));
+  append(categories.data(), categories.size() * sizeof(category_record));
+  append(ranges.data(), ranges.size() * sizeof(std::uint32_t));
+  for (unsigned b = 0; b < byte_classes::k_byte_count; ++b) {
+    out.push_back(e.classes()[b]);
+  }
+
+  if (!bit_parallel.available()) return;
+  bit_parallel_record r{bit_parallel.first_mask(), bit_parallel.final_mask(),
+                        bit_parallel.start_accepts(), 0};
+  append(&r, sizeof(r));
+  append(bit_parallel.char_masks(), 256 * sizeof(std::uint64_t));
+  for (std::size_t i = 0; i < bit_parallel.position_count(); ++i) {
+    std::uint64_t follow = bit_parallel.follow_mask(i);
+    append(&follow, sizeof(follow));
+  }
+  for (int pc : bit_parallel.pcs()) {
+    std::int32_t v = pc;
+    append(&v, sizeof(v));
+  }
+}
+
+/*! \brief Return the blob of the regexes in [first, last).
+ *
+ * The blob is meant to be written to a file once and mapped by regex_blob
+ * at the start of each process, instead of parsing the patterns again.
+ */
+template <class ForwardIt>
+std::string serialize_regexes(ForwardIt first, ForwardIt last) {
+  typedef typename std::iterator_traits<ForwardIt>::value_type regex_type;
+
+  std::uint32_t count = std::distance(first, last);
+  std::string out(sizeof(blob_header) + count * sizeof(std::uint32_t), '\0');
+  std::vector<std::uint32_t> offsets;
+  for (; first != last; ++first) {
+    offsets.push_back(out.size());
+    serialize_program(*first, out);
+  }
+
+  blob_header h{k_blob_magic, k_blob_version,
+                sizeof(typename regex_type::char_type), count,
+                std::uint32_t(out.size())};
+  std::memcpy(&out[0], &h, sizeof(h));
+  if (count) {
+    std::memcpy(&out[sizeof(h)], offsets.data(), count * sizeof(offsets[0]));
+  }
+  return out;
+}
+
+/*! \brief Return the blob of the single regex e.
+ */
+template <class CharT, class Traits>
+std::string serialize_regex(const basic_regex<CharT, Traits>& e) {
+  return serialize_regexes(&e, &e + 1);
+}
+
+/*! \brief A view of a blob of serialized regexes, like a mapped file.
+ *
+ * The blob is read in place and must outlive the view. The header and the
+ * offsets are checked when the view is created, and a program when it is
+ * loaded, so only the pages of the loaded programs are touched. A blob that
+ * is truncated, corrupted, misaligned or of another format throws a
+ * regex_error of k_bad_program, at the offset of the bad record.
+ *
+ * Loading is not zero-copy. A loaded regex owns its program, rebuilt from
+ * the records, and copies of the byte classes and the bit-parallel tables,
+ * so it does not refer to the blob, and its memory is that of a compiled
+ * regex. What loading saves is the parser and the optimizer, and the
+ * computation of the byte classes and the bit-parallel tables, which take
+ * most of the time of the compilation. The other tables derived from the
+ * program, like the packed program, the closures, the prefilter, the
+ * one-pass table and the reverse program, are computed by basic_regex as
+ * usual.
+ */
+template <class Regex>
+class regex_blob {
+ public:
+  typedef Regex regex_type;
+  typedef typename regex_type::char_type char_type;
+  typedef typename regex_type::nfa_type nfa_type;
+  typedef typename regex_type::char_category_type char_category_type;
+
+  regex_blob(const void* data, std::size_t size)
+      : data_(static_cast<const char*>(data)), size_(size) {
+    if (reinterpret_cast<std::uintptr_t>(data_) % alignof(std::uint32_t)) {
+      regex_throw(k_bad_program, 0);
+    }
+    auto h = record<blob_header>(0, 1);
+    if (h->magic != k_blob_magic || h->version != k_blob_version ||
+        h->char_size != sizeof(char_type) || h->size > size_) {
+      regex_throw(k_bad_program, 0);
+    }
+    size_ = h->size;
+    count_ = h->program_count;
+    offsets_ = record<std::uint32_t>(sizeof(blob_header), count_);
+    for (std::size_t i = 0; i < count_; ++i) {
+      if (offsets_[i] % alignof(std::uint32_t)) {
+        regex_throw(k_bad_program, sizeof(blob_header) + i * 4);
+      }
+    }
+  }
+
+  /*! \brief Return the number of regexes.
+   */
+  std::size_t size() const { return count_; }
+
+  /*! \brief Return the size of the blob in bytes.
+   */
+  std::size_t byte_size() const { return size_; }
+
+  /*! \brief Load the regex i, as a copy of its program.
+   *
+   * The regex does not refer to the blob, which can be unmapped afterwards.
+   */
+  regex_type load(std::size_t i) const {
+    assert(i < count_);
+    std::size_t offset = offsets_[i];
+    auto h = record<program_header>(offset, 1);
+    offset += sizeof(program_header);
+    auto insns = record<packed_instruction>(offset, h->insn_count);
+    offset += h->insn_count * sizeof(packed_instruction);
+    auto categories = record<category_record>(offset, h->category_count);
+    offset += h->category_count * sizeof(category_record);
+    auto ranges = record<std::uint32_t>(offset, h->range_count * 2ull);
+    offset += h->range_count * 2ull * sizeof(std::uint32_t);
+    auto classes = record<unsigned char>(offset, byte_classes::k_byte_count);
+    offset += byte_classes::k_byte_count;
+
+    typedef packed_nfa<nfa_type> packed_type;
+    nfa_type nfa;
+    std::vector<char_category_type> ccs;
+    ccs.reserve(h->category_count);
+    for (std::size_t c = 0; c < h->category_count; ++c) {
+      ccs.push_back(load_category(categories[c], ranges, h->range_count,
+                                  offsets_[i], nfa));
+    }
+
+    nfa.reserve(h->insn_count);
+    std::uint32_t n = h->insn_count;
+    auto check = [&](bool ok) {
+      if (!ok) regex_throw(k_bad_program, offsets_[i]);
+    };
+    check(n < std::uint32_t(packed_type::k_max_insns));
+    for (std::uint32_t pc = 0; pc < n; ++pc) {
+      auto& p = insns[pc];
+      std::uint32_t next = p.word >> packed_type::k_opcode_bits;
+      auto op = opcode(p.word & packed_type::k_opcode_mask);
+      switch (op) {
+        case k_match_char_category:
+          check(next < n && p.arg < ccs.size());
+          nfa.append_match_char_category(ccs[p.arg], next);
+          break;
+        case k_goto:
+          check(next < n);
+          nfa.append_goto(next);
+          break;
+        case k_fork:
+          check(next < n && p.arg < n);
+          nfa.append_fork(next, p.arg);
+          break;
+        case k_accept:
+          nfa.append_accept(p.arg);
+          break;
+        case k_advance:
+          check(next < n);
+          nfa.append_advance(next);
+          break;
+        case k_mark_group_start:
+          check(next < n && p.arg < h->mark_count);
+          nfa.append_mark_group_start(next, p.arg);
+          break;
+        case k_mark_group_end:
+          check(next < n && p.arg < h->mark_count);
+          nfa.append_mark_group_end(next, p.arg);
+          break;
+        default:
+          check(false);
+      }
+    }
+    check(h->start_id >= -1 && h->start_id < std::int64_t(n));
+    check(h->search_start_id >= -1 && h->search_start_id < std::int64_t(n));
+    nfa.set_start_id(h->start_id);
+    nfa.set_search_start_id(h->search_start_id);
+    for (unsigned g = 0; g < h->mark_count; ++g) nfa.alloc_group_id();
+
+    typedef typename regex_type::bit_parallel_type bit_parallel_type;
+    bit_parallel_type bit_parallel;
+    if (h->bit_parallel) {
+      bit_parallel = load_bit_parallel(*h, nfa, offset);
+    }
+    return regex_type(std::move(nfa), syntax_flags(h->flags),
+                      byte_classes::from_table(classes),
+                      std::move(bit_parallel));
+  }
+
+ private:
+  const char* data_;
+  std::size_t size_;
+  std::size_t count_ = 0;
+  const std::uint32_t* offsets_ = nullptr;
+
+  /*! \brief Return the count records of T at offset, which must be in the
+   * blob.
+   */
+  template <class T>
+  const T* record(std::size_t offset, std::uint64_t count) const {
+    if (offset > size_ || count > (size_ - offset) / sizeof(T)) {
+      regex_throw(k_bad_program, offset);
+    }
+    return reinterpret_cast<const T*>(data_ + offset);
+  }
+
+  /*! \brief Copy the count records of T at offset, which may be unaligned
+   * for T.
+   */
+  template <class T>
+  void copy_records(std::size_t offset, std::size_t count, T* out) const {
+    std::memcpy(out, record<char>(offset, count * sizeof(T)),
+                count * sizeof(T));
+  }
+
+  /*! \brief Load the bit-parallel tables of the program nfa at offset.
+   */
+  typename regex_type::bit_parallel_type load_bit_parallel(
+      const program_header& h, const nfa_type& nfa, std::size_t offset) const {
+    typedef typename regex_type::bit_parallel_type bit_parallel_type;
+    typedef typename bit_parallel_type::mask_type mask_type;
+    std::size_t start = offset;
+    std::size_t count = h.position_count;
+    if (count > bit_parallel_type::k_max_positions) {
+      regex_throw(k_bad_program, start);
+    }
+
+    bit_parallel_record r;
+    copy_records(offset, 1, &r);
+    offset += sizeof(r);
+    mask_type char_masks[256];
+    copy_records(offset, 256, char_masks);
+    offset += sizeof(char_masks);
+    std::vector<mask_type> follows(count);
+    copy_records(offset, count, follows.data());
+    offset += count * sizeof(mask_type);
+    std::vector<std::int32_t> positions(count);
+    copy_records(offset, count, positions.data());
+
+    // The engine indexes its tables by the positions in the masks.
+    mask_type all = count == 64 ? ~mask_type(0) : (mask_type(1) << count) - 1;
+    bool ok = !(r.first_mask & ~all) && !(r.final_mask & ~all);
+    for (auto m : char_masks) ok = ok && !(m & ~all);
+    for (auto m : follows) ok = ok && !(m & ~all);
+    std::vector<int> pcs;
+    for (auto pc : positions) {
+      ok = ok && pc >= 0 && std::size_t(pc) < nfa.size() &&
+           nfa[pc].opcode == k_match_char_category;
+      pcs.push_back(pc);
+    }
+    if (!ok) regex_throw(k_bad_program, start);
+    return bit_parallel_type(std::move(pcs), r.first_mask, r.final_mask,
+                             r.start_accepts != 0, char_masks, follows);
+  }
+
+  /*! \brief Return the category of r, whose set is added to the sets of
+   * nfa.
+   */
+  static char_category_type load_category(const category_record& r,
+                                          const std::uint32_t* ranges,
+                                          std::uint32_t range_count,
+                                          std::size_t offset, nfa_type& nfa) {
+    typedef typename char_category_type::unsigned_char_type unsigned_type;
+    auto fits = [](std::uint32_t ch) {
+      return ch <= std::numeric_limits<unsigned_type>::max();
+    };
+    switch (r.type) {
+      case k_cc_ordinary_char:
+        if (!fits(r.ch)) break;
+        return char_category_type::ordinary_char(char_type(r.ch));
+      case k_cc_any_char:
+        return char_category_type::any_char();
+      case k_cc_char_set: {
+        if (r.first_range > range_count ||
+            r.range_count > range_count - r.first_range) {
+          break;
+        }
+        typename nfa_type::char_set_type set;
+        auto range = ranges + r.first_range * std::size_t(2);
+        for (std::size_t j = 0; j < r.range_count; ++j, range += 2) {
+          if (range[0] > range[1] || !fits(range[1])) {
+            regex_throw(k_bad_program, offset);
+          }
+          set.insert(char_type(range[0]), char_type(range[1]));
+        }
+        return nfa.add_char_set(set);
+      }
+      default:
+        break;
+    }
+    regex_throw(k_bad_program, offset);
+  }
+};
+}
+
+#endif
@@ -0,0 +1,240 @@
+#ifndef __REGEX_SET_H__
+#define __REGEX_SET_H__
+
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "regex_byte_classes.h"
+#include "regex_closure.h"
+#include "regex_dfa.h"
+#include "regex_match_results.h"
+#include "regex_matcher.h"
+#include "regex_nfa.h"
+#include "regex_optimizer.h"
+#include "regex_packed.h"
+#include "regex_parser.h"
+#include "regex_scanner.h"
+#include "regex_traits.h"
+
+namespace regex {
+
+/*! \brief A set of patterns matched together in one pass.
+ *
+ * The patterns are compiled into one program. The program forks into the
+ * programs of the patterns, whose accepts carry the pattern ids. The groups
+ * are not tracked, so nfa_optimizer removes the group marks along with the
+ * gotos.
+ */
+template <class CharT, class Traits = regex_traits<CharT>>
+class basic_regex_set {
+ public:
+  typedef CharT char_type;
+  typedef char_category<CharT> char_category_type;
+  typedef std::basic_string<char_type> string_type;
+  typedef regex::nfa<instruction<char_type>,
+                     std::allocator<instruction<char_type>>>
+      nfa_type;
+  typedef Traits traits_type;
+  typedef packed_nfa<nfa_type> packed_type;
+  typedef epsilon_closures<nfa_type> closures_type;
+
+  basic_regex_set() = default;
+
+  basic_regex_set(std::initializer_list<string_type> patterns)
+      : basic_regex_set(patterns.begin(), patterns.end()) {}
+
+  /*! \brief Compile the patterns in [first, last).
+   *
+   * The id of a pattern is its index in the range.
+   */
+  template <class ForwardIt>
+  basic_regex_set(ForwardIt first, ForwardIt last) {
+    std::vector<int> starts;
+    for (; first != last; ++first) {
+      starts.push_back(append_pattern(string_type(*first), starts.size()));
+    }
+    if (starts.empty()) return;
+
+    int start_id = starts.back();
+    for (std::size_t i = starts.size() - 1; i-- > 0;) {
+      start_id = nfa_.append_fork(starts[i], start_id);
+    }
+    nfa_.set_start_id(start_id);
+
+    int any_char_id = nfa_.append_match_char_category(
+        char_category_type::any_char(), k_dangled);
+    int loop_id = nfa_.append_fork(start_id, any_char_id);
+    nfa_[any_char_id].next = loop_id;
+    nfa_.set_search_start_id(loop_id);
+    nfa_.assert_complete();
+    nfa_ = std::move(
+        nfa_optimizer<nfa_type>(std::move(nfa_),
+                                k_optimize_default | k_optimize_groups, 0)
+            .nfa());
+    packed_ = packed_type(nfa_);
+    classes_ = byte_classes::from_categories(packed_.categories().begin(),
+                                             packed_.categories().end(),
+                                             packed_.char_sets());
+    closures_ = closures_type(nfa_);
+    size_ = starts.size();
+  }
+
+  /*! \brief Return the number of the patterns.
+   */
+  std::size_t size() const { return size_; }
+
+  const nfa_type& nfa() const { return nfa_; }
+
+  /*! \brief Get the compact form of the program, which regex_matcher runs.
+   */
+  const packed_type& packed() const { return packed_; }
+
+  /*! \brief Get the classes of the bytes that the program matches alike.
+   */
+  const byte_classes& classes() const { return classes_; }
+
+  /*! \brief Get the precomputed e-closures of the program.
+   */
+  const closures_type& closures() const { return closures_; }
+
+  /*! \brief Return the number of groups, which are not tracked.
+   */
+  unsigned mark_count() const { return 0; }
+
+ private:
+  nfa_type nfa_;
+  packed_type packed_;
+  byte_classes classes_;
+  closures_type closures_;
+  std::size_t size_ = 0;
+
+  /*! \brief Append the program of pattern and return its start id.
+   */
+  int append_pattern(const string_type& pattern, unsigned pattern_id) {
+    typedef typename string_type::const_iterator iterator;
+    nfa_type p =
+        regex_parser<regex_scanner<iterator>, char_category_type, nfa_type>(
+            regex_scanner<iterator>(pattern.begin(), pattern.end(),
+                                    std::locale()))
+            .nfa();
+
+    int offset = nfa_.size();
+    for (auto insn : p) {
+      if (insn.next >= 0) insn.next += offset;
+      if (insn.next2 >= 0) insn.next2 += offset;
+      if (insn.opcode == k_accept) {
+        insn.group_id = pattern_id;
+      }
+      if (insn.opcode == k_match_char_category &&
+          insn.cc.type() == k_cc_char_set) {
+        insn.cc = nfa_.add_char_set(p.char_sets()[insn.cc.set_id()]);
+      }
+      nfa_.push_back(insn);
+    }
+    return p.start_id() + offset;
+  }
+};
+
+typedef basic_regex_set<char> regex_set;
+typedef basic_regex_set<wchar_t> wregex_set;
+
+/*! \brief The lazy DFAs of a regex set, kept between the matches so that
+ * their states are computed only once.
+ *
+ * A cache must not be used by more than one thread at a time.
+ */
+template <class Set>
+class regex_set_cache {
+ public:
+  typedef Set set_type;
+  typedef lazy_dfa<typename set_type::nfa_type> dfa_type;
+
+  explicit regex_set_cache(const set_type& s)
+      : match_dfa_(s.nfa(), s.nfa().start_id()),
+        search_dfa_(s.nfa(), s.nfa().search_start_id()) {
+    match_dfa_.set_match_kind(k_dfa_all);
+    search_dfa_.set_match_kind(k_dfa_all);
+    match_dfa_.set_byte_classes(&s.classes());
+    search_dfa_.set_byte_classes(&s.classes());
+  }
+
+  /*! \brief Return the DFA of regex_match.
+   */
+  dfa_type& match_dfa() { return match_dfa_; }
+
+  /*! \brief Return the DFA of regex_search.
+   */
+  dfa_type& search_dfa() { return search_dfa_; }
+
+ private:
+  dfa_type match_dfa_;
+  dfa_type search_dfa_;
+};
+
+/*! \brief Find the patterns of s matching [first, last) with dfa, which runs
+ * the program from start_id, and store their ids in ids.
+ *
+ * It scans the input once with the lazy DFA, and only falls back to
+ * regex_matcher if the DFA gives up.
+ */
+template <class BidirIt, class CharT, class Traits, class DFA>
+bool regex_set_find(BidirIt first, BidirIt last, std::vector<std::size_t>& ids,
+                    const basic_regex_set<CharT, Traits>& s, DFA& dfa,
+                    int start_id) {
+  typedef basic_regex_set<CharT, Traits> set_type;
+  ids.clear();
+  if (s.size() == 0) return false;
+
+  std::vector<bool> matched(s.size(), false);
+  if (dfa.find_all(first, last, matched) == k_dfa_gave_up) {
+    match_results<BidirIt> m;
+    regex_matcher<set_type, BidirIt, match_results<BidirIt>> matcher(
+        first, last, s, m, start_id, &matched);
+  }
+
+  for (std::size_t id = 0; id < matched.size(); ++id) {
+    if (matched[id]) ids.push_back(id);
+  }
+  return !ids.empty();
+}
+
+/*! \brief Find the patterns of s matching prefixes of [first, last), in the
+ * order of the pattern ids.
+ */
+template <class BidirIt, class CharT, class Traits>
+bool regex_match(BidirIt first, BidirIt last, std::vector<std::size_t>& ids,
+                 const basic_regex_set<CharT, Traits>& s,
+                 regex_set_cache<basic_regex_set<CharT, Traits>>& cache) {
+  return regex_set_find(first, last, ids, s, cache.match_dfa(),
+                        s.nfa().start_id());
+}
+
+template <class BidirIt, class CharT, class Traits>
+bool regex_match(BidirIt first, BidirIt last, std::vector<std::size_t>& ids,
+                 const basic_regex_set<CharT, Traits>& s) {
+  regex_set_cache<basic_regex_set<CharT, Traits>> cache(s);
+  return regex_match(first, last, ids, s, cache);
+}
+
+/*! \brief Find the patterns of s matching substrings of [first, last), in the
+ * order of the pattern ids.
+ */
+template <class BidirIt, class CharT, class Traits>
+bool regex_search(BidirIt first, BidirIt last, std::vector<std::size_t>& ids,
+                  const basic_regex_set<CharT, Traits>& s,
+                  regex_set_cache<basic_regex_set<CharT, Traits>>& cache) {
+  return regex_set_find(first, last, ids, s, cache.search_dfa(),
+                        s.nfa().search_start_id());
+}
+
+template <class BidirIt, class CharT, class Traits>
+bool regex_search(BidirIt first, BidirIt last, std::vector<std::size_t>& ids,
+                  const basic_regex_set<CharT, Traits>& s) {
+  regex_set_cache<basic_regex_set<CharT, Traits>> cache(s);
+  return regex_search(first, last, ids, s, cache);
+}
+}
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef __REGEX_SPARSE_SET_H__
+#define __REGEX_SPARSE_SET_H__
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace regex {
+
+/*! \brief A set of integers in [0, capacity) with O(1) insertion, membership
+ * test and clearing.
+ *
+ * The elements are kept in the insertion order in the dense array, and
+ * sparse_[i] is the index of i in the dense array. i is in the set iff
+ * sparse_[i] < size_ and dense_[sparse_[i]] == i, so clearing the set only
+ * resets size_.
+ */
+class sparse_set {
+ public:
+  typedef std::vector<int>::const_iterator const_iterator;
+
+  /*! \brief Create a set of integers in [0, capacity).
+   */
+  explicit sparse_set(std::size_t capacity = 0)
+      : dense_(capacity), sparse_(capacity) {}
+
+  /*! \brief Change the capacity and clear the set.
+   */
+  void reset(std::size_t capacity) {
+    dense_.resize(capacity);
+    sparse_.resize(capacity);
+    size_ = 0;
+  }
+
+  /*! \brief Return true if i is in the set.
+   */
+  bool contains(int i) const {
+    assert(i >= 0 && std::size_t(i) < capacity());
+    std::size_t d = sparse_[i];
+    return d < size_ && dense_[d] == i;
+  }
+
+  /*! \brief Insert i into the set.
+   *
+   * i must not be in the set.
+   */
+  void insert(int i) {
+    assert(!contains(i));
+    sparse_[i] = size_;
+    dense_[size_++] = i;
+  }
+
+  /*! \brief Remove all the elements.
+   */
+  void clear() { size_ = 0; }
+
+  bool empty() const { return size_ == 0; }
+
+  std::size_t size() const { return size_; }
+
+  std::size_t capacity() const { return dense_.size(); }
+
+  const_iterator begin() const { return dense_.begin(); }
+
+  const_iterator end() const { return dense_.begin() + size_; }
+
+ private:
+  std::vector<int> dense_;
+  std::vector<std::size_t> sparse_;
+  std::size_t size_ = 0;
+};
+}
+
+#endif
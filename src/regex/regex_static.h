@@ -0,0 +1,511 @@
+#ifndef __REGEX_STATIC_H__
+#define __REGEX_STATIC_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "regex.h"
+#include "regex_byte_set.h"
+#include "regex_except.h"
+#include "regex_func.h"
+#include "regex_match_results.h"
+#include "regex_scanner.h"
+
+/*! \brief Declare the type name of the pattern literal, for static_regex.
+ *
+ * \code
+ * REGEX_STATIC_PATTERN(header_name, "[A-Za-z0-9-]+");
+ * static_regex<header_name> re;
+ * \endcode
+ */
+#define REGEX_STATIC_PATTERN(name, literal)                     \
+  struct name {                                                 \
+    static constexpr const char* pattern() { return literal; } \
+  }
+
+namespace regex {
+
+/*! \brief The program of a static_regex, computed in constant expressions.
+ *
+ * It is the position automaton of the pattern, like the one of
+ * bit_parallel_nfa: the positions are the characters of the pattern, and a
+ * set of positions is a 64-bit mask.
+ */
+struct static_program {
+  typedef std::uint64_t mask_type;
+
+  enum {
+    k_max_positions = 64,
+    k_no_error = -1,
+  };
+
+  /*! \brief The error_code of an invalid pattern, or k_no_error.
+   */
+  int error = k_no_error;
+  int error_pos = -1;
+
+  /*! \brief True if the pattern has more than k_max_positions positions.
+   */
+  bool too_large = false;
+
+  std::size_t position_count = 0;
+
+  /*! \brief The bytes each position matches.
+   */
+  byte_set chars[k_max_positions];
+
+  /*! \brief The positions that can follow each position.
+   */
+  mask_type follow[k_max_positions] = {};
+
+  /*! \brief The positions that can match the first char.
+   */
+  mask_type first = 0;
+
+  /*! \brief The positions after which the pattern can accept.
+   */
+  mask_type final = 0;
+
+  /*! \brief True if the pattern accepts the empty string.
+   */
+  bool nullable = false;
+
+  /*! \brief The positions accepting each byte.
+   */
+  mask_type char_masks[byte_set::k_byte_count] = {};
+
+  constexpr bool ok() const { return error == k_no_error && !too_large; }
+};
+
+/*! \brief Parse a pattern into a static_program in constant expressions.
+ *
+ * It accepts the syntax of regex_parser for the chars, and reports the same
+ * error codes. The groups only group, since the program does not track them.
+ */
+class static_parser {
+ public:
+  typedef static_program::mask_type mask_type;
+
+  constexpr explicit static_parser(const char* pattern) : s_(pattern) {}
+
+  /*! \brief Parse the pattern and return its program.
+   */
+  constexpr static_program parse() {
+    fragment f = parse_sub();
+    if (!failed() && peek() != '\0') fail(k_unexpected_token);
+    if (failed()) return p_;
+
+    p_.first = f.first;
+    p_.final = f.last;
+    p_.nullable = f.nullable;
+    for (std::size_t i = 0; i < p_.position_count; ++i) {
+      for (unsigned b = 0; b < byte_set::k_byte_count; ++b) {
+        if (p_.chars[i].contains(b)) p_.char_masks[b] |= mask_type(1) << i;
+      }
+    }
+    return p_;
+  }
+
+ private:
+  /*! \brief The positions of a sub-pattern.
+   */
+  struct fragment {
+    mask_type first;
+    mask_type last;
+    bool nullable;
+  };
+
+  /*! \brief The tokens in brackets, as regex_scanner scans them.
+   */
+  enum bracket_token {
+    k_bracket_eof,
+    k_bracket_end,
+    k_bracket_char,
+    k_bracket_class,
+    k_bracket_range,
+  };
+
+  const char* s_;
+  std::size_t pos_ = 0;
+  static_program p_{};
+
+  /*! \brief True if no character or class has been scanned in the brackets.
+   */
+  bool bracket_empty_ = false;
+
+  constexpr char peek(std::size_t ahead = 0) const {
+    for (std::size_t i = 0; i < ahead; ++i) {
+      if (s_[pos_ + i] == '\0') return '\0';
+    }
+    return s_[pos_ + ahead];
+  }
+
+  constexpr bool failed() const { return !p_.ok(); }
+
+  constexpr void fail(error_code err) {
+    if (failed()) return;
+    p_.error = err;
+    p_.error_pos = pos_;
+  }
+
+  /*! \brief Parse nonterminal Sub and RestSub.
+   */
+  constexpr fragment parse_sub() {
+    fragment f = parse_seq();
+    while (!failed() && peek() == '|') {
+      ++pos_;
+      fragment g = parse_seq();
+      f = {f.first | g.first, f.last | g.last, f.nullable || g.nullable};
+    }
+    return f;
+  }
+
+  /*! \brief Parse nonterminal Seq and RestSeq.
+   */
+  constexpr fragment parse_seq() {
+    fragment f{0, 0, true};
+    while (!failed() && is_atom_head()) {
+      fragment g = parse_term();
+      link(f.last, g.first);
+      f = {f.nullable ? f.first | g.first : f.first,
+           g.nullable ? f.last | g.last : g.last, f.nullable && g.nullable};
+    }
+    return f;
+  }
+
+  constexpr bool is_atom_head() const {
+    char c = peek();
+    return c != '\0' && c != '*' && c != '+' && c != '?' && c != '|' &&
+           c != ')';
+  }
+
+  /*! \brief Parse nonterminal Term and RestTerm.
+   */
+  constexpr fragment parse_term() {
+    fragment f = parse_atom();
+    while (!failed()) {
+      char c = peek();
+      if (c == '*' || c == '+') {
+        link(f.last, f.first);
+        if (c == '*') f.nullable = true;
+      } else if (c == '?') {
+        f.nullable = true;
+      } else {
+        break;
+      }
+      ++pos_;
+    }
+    return f;
+  }
+
+  /*! \brief Parse nonterminal Atom.
+   */
+  constexpr fragment parse_atom() {
+    char c = peek();
+    byte_set set;
+    if (c == '(') {
+      ++pos_;
+      fragment f = parse_sub();
+      if (!failed() && peek() != ')') fail(k_missing_right_group);
+      ++pos_;
+      return f;
+    } else if (c == '[') {
+      ++pos_;
+      set = parse_bracket();
+    } else if (c == '\\') {
+      char ch = '\0';
+      parse_escape(set, ch);
+    } else {
+      ++pos_;
+      set.insert(c);
+    }
+    return add_position(set);
+  }
+
+  /*! \brief Parse nonterminal Bracket and the right bracket.
+   */
+  constexpr byte_set parse_bracket() {
+    bool negated = false;
+    if (peek() == '^') {
+      negated = true;
+      ++pos_;
+    }
+    bracket_empty_ = true;
+
+    byte_set set, item;
+    char ch = '\0';
+    int t = next_in_bracket(item, ch);
+    while (!failed() && t != k_bracket_end) {
+      if (t == k_bracket_class) {
+        set |= item;
+        t = next_in_bracket(item, ch);
+      } else if (t == k_bracket_char) {
+        unsigned char lo = ch;
+        t = next_in_bracket(item, ch);
+        if (t != k_bracket_range) {
+          set.insert(lo);
+          continue;
+        }
+        t = next_in_bracket(item, ch);
+        if (t != k_bracket_char || (unsigned char)ch < lo) {
+          fail(k_bad_range);
+          break;
+        }
+        set.insert_range(lo, ch);
+        t = next_in_bracket(item, ch);
+      } else if (t == k_bracket_eof) {
+        fail(k_missing_right_bracket);
+      } else {
+        fail(k_bad_range);
+      }
+    }
+
+    if (negated) set.flip();
+    return set;
+  }
+
+  /*! \brief Scan the next token in brackets, like
+   * regex_scanner::advance_in_bracket.
+   *
+   * The character or the class is stored in set, and the character in ch.
+   */
+  constexpr int next_in_bracket(byte_set& set, char& ch) {
+    char c = peek();
+    if (c == '\0') return k_bracket_eof;
+    if (c == ']' && !bracket_empty_) {
+      ++pos_;
+      return k_bracket_end;
+    }
+
+    bool empty = bracket_empty_;
+    bracket_empty_ = false;
+    char next = peek(1);
+    set = byte_set();
+    if (c == '-' && !empty && next != '\0' && next != ']') {
+      ++pos_;
+      return k_bracket_range;
+    } else if (c == '[' && next == ':') {
+      pos_ += 2;
+      set = parse_class_name();
+      return k_bracket_class;
+    } else if (c == '\\') {
+      return parse_escape(set, ch) ? k_bracket_char : k_bracket_class;
+    }
+    ++pos_;
+    set.insert(c);
+    ch = c;
+    return k_bracket_char;
+  }
+
+  /*! \brief Parse the name of a class like [:alpha:], after "[:".
+   */
+  constexpr byte_set parse_class_name() {
+    std::size_t first = pos_;
+    while (peek() != '\0' && peek() != ':') ++pos_;
+    std::size_t last = pos_;
+    if (peek() == '\0' || peek(1) != ']') {
+      fail(k_bad_char_class);
+      return byte_set();
+    }
+    pos_ += 2;
+
+    character_class cls = k_cc_alnum;
+    if (find_class_name(s_ + first, s_ + last, cls)) return class_set(cls);
+    fail(k_bad_char_class);
+    return byte_set();
+  }
+
+  /*! \brief Parse an escape into set.
+   *
+   * Return true if it is an escaped character, which is stored in ch, and
+   * false if it is a class.
+   */
+  constexpr bool parse_escape(byte_set& set, char& ch) {
+    ++pos_;
+    char c = peek();
+    if (c == '\0') {
+      fail(k_escape_eof);
+      return false;
+    }
+    ++pos_;
+
+    character_class cls = k_cc_alnum;
+    if (is_escaped_char(c)) {
+      set.insert(c);
+      ch = c;
+      return true;
+    } else if (find_escape_class(c, cls)) {
+      set = class_set(cls);
+    } else {
+      --pos_;
+      fail(k_escape_bad_char);
+    }
+    return false;
+  }
+
+  /*! \brief Return the bytes of the class cls.
+   */
+  static constexpr byte_set class_set(character_class cls) {
+    byte_set set;
+    class_ranges r = character_class_ranges(cls);
+    for (std::size_t i = 0; i < r.count; ++i) {
+      set.insert_range(r.first[i], r.last[i]);
+    }
+    if (r.negated) set.flip();
+    return set;
+  }
+
+  /*! \brief Add a position matching set.
+   */
+  constexpr fragment add_position(const byte_set& set) {
+    if (failed()) return {0, 0, false};
+    if (p_.position_count == static_program::k_max_positions) {
+      p_.too_large = true;
+      return {0, 0, false};
+    }
+    std::size_t i = p_.position_count++;
+    p_.chars[i] = set;
+    return {mask_type(1) << i, mask_type(1) << i, false};
+  }
+
+  /*! \brief Let the positions of first follow the positions of last.
+   */
+  constexpr void link(mask_type last, mask_type first) {
+    for (std::size_t i = 0; i < p_.position_count; ++i) {
+      if ((last >> i) & 1) p_.follow[i] |= first;
+    }
+  }
+};
+
+/*! \brief A regex whose pattern is known at compile time.
+ *
+ * Pattern is a type with a constexpr static member function pattern()
+ * returning the pattern, which REGEX_STATIC_PATTERN declares. The pattern is
+ * parsed during the compilation, and an invalid pattern or a pattern of more
+ * than 64 characters does not compile. The program is baked into the matcher
+ * as constants: the step from the matched positions is unrolled over the
+ * positions, each with its follow mask as an immediate.
+ *
+ * The boolean regex_match and regex_search run the compiled program and
+ * never touch a basic_regex. The overloads with match_results need the
+ * groups, which the program does not track, so they run the basic_regex of
+ * the pattern. That one is parsed at run time, on the first such call, and
+ * kept for the next ones: only the boolean overloads are free of parsing.
+ */
+template <class Pattern>
+class static_regex {
+ public:
+  typedef char char_type;
+  typedef basic_regex<char> regex_type;
+  typedef static_program::mask_type mask_type;
+
+  static constexpr static_program k_program =
+      static_parser(Pattern::pattern()).parse();
+
+  static_assert(k_program.error == static_program::k_no_error,
+                "static_regex: invalid pattern");
+  static_assert(!k_program.too_large,
+                "static_regex: the pattern has more than 64 characters");
+
+  /*! \brief Return true if a prefix of [first, last) matches.
+   */
+  template <class BidirIt>
+  static bool match(BidirIt first, BidirIt last) {
+    if (k_program.nullable) return true;
+
+    mask_type active = k_program.first;
+    for (; first != last; ++first) {
+      mask_type matched =
+          active & k_program.char_masks[(unsigned char)*first];
+      if (matched & k_program.final) return true;
+      if (!matched) return false;
+      active = follow(matched);
+    }
+    return false;
+  }
+
+  /*! \brief Return true if a substring of [first, last) matches.
+   */
+  template <class BidirIt>
+  static bool search(BidirIt first, BidirIt last) {
+    if (k_program.nullable) return true;
+
+    mask_type active = k_program.first;
+    for (; first != last; ++first) {
+      mask_type matched =
+          active & k_program.char_masks[(unsigned char)*first];
+      if (matched & k_program.final) return true;
+      active = follow(matched) | k_program.first;
+    }
+    return false;
+  }
+
+  /*! \brief Return the basic_regex of the pattern, for the groups.
+   *
+   * The pattern is parsed at run time on the first call.
+   */
+  static const regex_type& regex() {
+    static const regex_type re(Pattern::pattern());
+    return re;
+  }
+
+ private:
+  typedef std::make_index_sequence<k_program.position_count> positions;
+
+  static mask_type follow(mask_type matched) {
+    return follow(matched, positions());
+  }
+
+  template <std::size_t... I>
+  static mask_type follow(mask_type matched, std::index_sequence<I...>) {
+    mask_type next = 0;
+    int expand[] = {
+        0, (next |= (mask_type(0) - ((matched >> I) & 1)) &
+                    k_program.follow[I],
+            0)...};
+    static_cast<void>(expand);
+    return next;
+  }
+};
+
+template <class Pattern>
+constexpr static_program static_regex<Pattern>::k_program;
+
+/*! \brief Return true if a prefix of [first, last) matches e.
+ */
+template <class BidirIt, class Pattern>
+bool regex_match(BidirIt first, BidirIt last, const static_regex<Pattern>& e) {
+  return e.match(first, last);
+}
+
+/*! \brief Match e and store the groups in m.
+ *
+ * It runs e.regex(), so the pattern is parsed at run time on the first call.
+ */
+template <class BidirIt, class Alloc, class Pattern>
+bool regex_match(BidirIt first, BidirIt last, match_results<BidirIt, Alloc>& m,
+                 const static_regex<Pattern>& e) {
+  return regex_match(first, last, m, e.regex());
+}
+
+/*! \brief Return true if a substring of [first, last) matches e.
+ */
+template <class BidirIt, class Pattern>
+bool regex_search(BidirIt first, BidirIt last,
+                  const static_regex<Pattern>& e) {
+  return e.search(first, last);
+}
+
+/*! \brief Search e and store the groups in m.
+ *
+ * It runs e.regex(), so the pattern is parsed at run time on the first call.
+ */
+template <class BidirIt, class Alloc, class Pattern>
+bool regex_search(BidirIt first, BidirIt last, match_results<BidirIt, Alloc>& m,
+                  const static_regex<Pattern>& e) {
+  return regex_search(first, last, m, e.regex());
+}
+}
+
+#endif
@@ -0,0 +1,277 @@
+#ifndef __REGEX_STREAM_H__
+#define __REGEX_STREAM_H__
+
+#include <cassert>
+#include <cstddef>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "regex_matcher.h"
+#include "regex_nfa.h"
+
+namespace regex {
+
+/*! \brief The chars of a stream matched by a sub-expression, denoted by their
+ * absolute positions in the stream.
+ */
+class stream_sub_match {
+ public:
+  /*! \brief Get the position of the first char.
+   */
+  std::size_t first() const { return first_; }
+
+  /*! \brief Get the position after the last char.
+   */
+  std::size_t last() const { return last_; }
+
+  /*! \brief Get the length of the sub-match.
+   */
+  std::size_t length() const { return matched_ ? last_ - first_ : 0; }
+
+  bool matched() const { return matched_; }
+
+  void set_first(std::size_t first) {
+    first_ = first;
+    matched_ = false;
+  }
+
+  void set_last(std::size_t last) {
+    last_ = last;
+    matched_ = true;
+  }
+
+ private:
+  std::size_t first_ = 0;
+  std::size_t last_ = 0;
+  bool matched_ = false;
+};
+
+/*! \brief A matcher fed with the input chunk by chunk.
+ *
+ * It runs the same threads as regex_matcher, on a matcher_scratch of its
+ * own, but the threads are kept between the chunks and the groups are
+ * recorded as absolute positions in the stream, so the chunks are not
+ * retained after feed returns.
+ *
+ * The matcher finds the first match of the stream, like regex_search, or like
+ * regex_match if it runs the program from nfa().start_id(). The match is
+ * decided as soon as no thread of a higher priority is left, which may be
+ * before finish is called. Then done() is true, feed stops consuming the
+ * chars, and resume searches for the next match from the end of this one.
+ *
+ * Once a match is found, the threads of a higher priority may read past its
+ * end before they fail, like the one of "abc" when "abc|a" matches "a" in
+ * "abx". These chars are kept, and resume searches them again. Besides them,
+ * the memory is bounded by the size of the program, whatever the length of
+ * the stream is.
+ */
+template <class Regex>
+class stream_matcher {
+ public:
+  typedef Regex regex_type;
+  typedef typename Regex::nfa_type::char_type char_type;
+  typedef std::vector<stream_sub_match> match_results_type;
+
+  /*! \brief Search the stream for the first match of regex.
+   */
+  explicit stream_matcher(const Regex& regex)
+      : stream_matcher(regex, regex.nfa().search_start_id()) {}
+
+  /*! \brief Match the stream with the program starting from the instruction
+   * start_id.
+   */
+  stream_matcher(const Regex& regex, int start_id)
+      : regex_(regex), start_id_(start_id) {
+    for (auto& c : scratch_.closures) c.reset(regex_.packed().size());
+    reset();
+  }
+
+  /*! \brief Start a new stream at the position 0.
+   */
+  void reset() {
+    position_ = 0;
+    match_position_ = 0;
+    lookahead_.clear();
+    start(false);
+  }
+
+  /*! \brief Search for the next match from the end of the match, once done()
+   * is true.
+   *
+   * The chars the matcher has consumed past the end of the match are searched
+   * again by the next calls of feed or finish, before the chars they are
+   * given. An empty match is not found again at the same position.
+   */
+  void resume() {
+    assert(done_);
+    bool skip_empty = matched_ && results_[0].length() == 0;
+    if (matched_) match_position_ = results_[0].last();
+    start(skip_empty);
+    trim();
+  }
+
+  /*! \brief Match the next n chars of the stream at s, and return the number
+   * of them consumed.
+   *
+   * Fewer than n chars are consumed if the match is decided before, and the
+   * others can be fed again after resume.
+   */
+  std::size_t feed(const char_type* s, std::size_t n) {
+    replay();
+    std::size_t i = 0;
+    for (; i < n && !done_; ++i) {
+      if (!advance(&s[i])) break;
+      ++position_;
+      if (matched_) lookahead_.push_back(s[i]);
+      trim();
+    }
+    return i;
+  }
+
+  /*! \brief Mark the end of the stream.
+   */
+  void finish() {
+    replay();
+    if (!done_) advance(nullptr);
+    done_ = true;
+  }
+
+  /*! \brief Return true if the match is decided and no more chars are needed.
+   */
+  bool done() const { return done_; }
+
+  /*! \brief Return true if a match has been found.
+   *
+   * A match found before done() is true may still be replaced by a match of
+   * a higher priority.
+   */
+  bool matched() const { return matched_; }
+
+  /*! \brief Get the groups of the match.
+   */
+  const match_results_type& results() const { return results_; }
+
+  /*! \brief Return the number of chars consumed since the stream started.
+   */
+  std::size_t position() const { return position_; }
+
+ private:
+  typedef matcher_scratch<stream_sub_match> scratch_type;
+  typedef typename scratch_type::closure closure;
+
+  const Regex& regex_;
+  int start_id_;
+
+  scratch_type scratch_;
+  match_results_type results_;
+  bool matched_ = false;
+  bool done_ = false;
+
+  /*! \brief The number of chars consumed since the stream started.
+   */
+  std::size_t position_ = 0;
+
+  /*! \brief The position of the next char matched by the threads.
+   *
+   * It is behind position_ while the chars of lookahead_ are searched again.
+   */
+  std::size_t match_position_ = 0;
+
+  /*! \brief The consumed chars from the end of the match, or from
+   * match_position_ if there is no match, up to position_.
+   */
+  std::deque<char_type> lookahead_;
+
+  /*! \brief If true, the accepts at position_ are skipped, so that resume
+   * does not find the same empty match again.
+   */
+  bool skip_empty_ = false;
+
+  /*! \brief Start the threads at match_position_.
+   */
+  void start(bool skip_empty) {
+    scratch_.closures[0].clear();
+    scratch_.captures.reset(regex_.mark_count());
+    results_.clear();
+    matched_ = false;
+    skip_empty_ = skip_empty;
+
+    if (start_id_ >= 0) {
+      int capture = scratch_.captures.alloc();
+      scratch_.follow(regex_, scratch_.closures[0], start_id_,
+                      match_position_, capture);
+      scratch_.captures.release(capture);
+    }
+    done_ = scratch_.closures[0].candidate_count == 0;
+  }
+
+  /*! \brief Match the char at ch, or the end of the stream if ch is null,
+   * and return true if the char is consumed.
+   *
+   * The char is not consumed if a match ends before it and no thread of a
+   * higher priority matches it.
+   */
+  bool advance(const char_type* ch) {
+    closure& cur_closure = scratch_.closures[0];
+    closure& next_closure = scratch_.closures[1];
+    next_closure.clear();
+    auto& program = regex_.packed();
+    bool accepted = false;
+
+    for (std::size_t i = 0; i < cur_closure.candidate_count; ++i) {
+      auto& cand = cur_closure.candidates[i];
+      if (program.opcode(cand.pc) == k_match_char_category) {
+        if (ch && program.match(cand.pc, *ch)) {
+          scratch_.follow(regex_, next_closure, program.next(cand.pc),
+                          match_position_ + 1, cand.capture);
+        }
+      } else {
+        assert(program.opcode(cand.pc) == k_accept);
+        if (skip_empty_) continue;
+        // Drop the lower-priority candidates, as regex_matcher does.
+        auto slots = scratch_.captures.slots(cand.capture);
+        results_.assign(slots, slots + scratch_.captures.slot_count());
+        matched_ = true;
+        accepted = true;
+        break;
+      }
+    }
+
+    for (std::size_t i = 0; i < cur_closure.candidate_count; ++i) {
+      scratch_.captures.release(cur_closure.candidates[i].capture);
+    }
+
+    std::swap(scratch_.closures[0], scratch_.closures[1]);
+    skip_empty_ = false;
+    bool consumed =
+        ch && !(accepted && scratch_.closures[0].candidate_count == 0);
+    if (consumed) ++match_position_;
+    if (scratch_.closures[0].candidate_count == 0) done_ = true;
+    return consumed;
+  }
+
+  /*! \brief Search the chars of lookahead_ from match_position_ again.
+   */
+  void replay() {
+    while (!done_ && match_position_ < position_) {
+      std::size_t first = position_ - lookahead_.size();
+      char_type ch = lookahead_[match_position_ - first];
+      advance(&ch);
+      trim();
+    }
+  }
+
+  /*! \brief Drop the chars of lookahead_ before the end of the match, or
+   * before match_position_ if there is no match.
+   */
+  void trim() {
+    std::size_t keep = matched_ ? results_[0].last() : match_position_;
+    while (!lookahead_.empty() && position_ - lookahead_.size() < keep) {
+      lookahead_.pop_front();
+    }
+  }
+};
+}
+
+#endif
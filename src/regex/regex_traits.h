@@ -1,11 +1,34 @@
 #ifndef __REGEX_TRAITS_H__
 #define __REGEX_TRAITS_H__
 
+#include <iterator>
 #include <locale>
+#include <string>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace regex {
 
+/*! \brief Check whether Iterator points into a contiguous array of bytes.
+ *
+ * Such arrays can be scanned with memchr and memcmp.
+ */
+template <class Iterator>
+struct is_contiguous_byte_iterator {
+  typedef typename std::iterator_traits<Iterator>::value_type value_type;
+  typedef std::basic_string<value_type> string_type;
+  typedef std::vector<value_type> vector_type;
+
+  static const bool value =
+      sizeof(value_type) == 1 && std::is_integral<value_type>::value &&
+      (std::is_pointer<Iterator>::value ||
+       std::is_same<Iterator, typename string_type::iterator>::value ||
+       std::is_same<Iterator, typename string_type::const_iterator>::value ||
+       std::is_same<Iterator, typename vector_type::iterator>::value ||
+       std::is_same<Iterator, typename vector_type::const_iterator>::value);
+};
+
 /*! \brief The type traits for the regex classes.
  */
 template <class Char>
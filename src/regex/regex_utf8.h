@@ -0,0 +1,147 @@
+#ifndef __REGEX_UTF8_H__
+#define __REGEX_UTF8_H__
+
+#include <vector>
+
+namespace regex {
+
+enum {
+  k_max_code_point = 0x10ffff,
+  k_min_surrogate = 0xd800,
+  k_max_surrogate = 0xdfff,
+};
+
+/*! \brief A sequence of byte ranges matching the UTF-8 encodings of a range
+ * of code points.
+ *
+ * The i-th byte of an encoding is in [lo[i], hi[i]].
+ */
+struct utf8_sequence {
+  unsigned char lo[4];
+  unsigned char hi[4];
+  int length;
+};
+
+/*! \brief Encode the code point cp into out and return the number of bytes.
+ */
+inline int utf8_encode(char32_t cp, unsigned char* out) {
+  if (cp < 0x80) {
+    out[0] = cp;
+    return 1;
+  } else if (cp < 0x800) {
+    out[0] = 0xc0 | (cp >> 6);
+    out[1] = 0x80 | (cp & 0x3f);
+    return 2;
+  } else if (cp < 0x10000) {
+    out[0] = 0xe0 | (cp >> 12);
+    out[1] = 0x80 | ((cp >> 6) & 0x3f);
+    out[2] = 0x80 | (cp & 0x3f);
+    return 3;
+  } else {
+    out[0] = 0xf0 | (cp >> 18);
+    out[1] = 0x80 | ((cp >> 12) & 0x3f);
+    out[2] = 0x80 | ((cp >> 6) & 0x3f);
+    out[3] = 0x80 | (cp & 0x3f);
+    return 4;
+  }
+}
+
+/*! \brief Decode the code point at first and advance first past it.
+ *
+ * Return -1 if [first, last) does not start with a valid shortest encoding
+ * of a code point other than a surrogate.
+ */
+template <class InputIt>
+long utf8_decode(InputIt& first, InputIt last) {
+  unsigned char b = *first;
+  ++first;
+  if (b < 0x80) return b;
+
+  int length;
+  long cp, min;
+  if ((b & 0xe0) == 0xc0) {
+    length = 2;
+    cp = b & 0x1f;
+    min = 0x80;
+  } else if ((b & 0xf0) == 0xe0) {
+    length = 3;
+    cp = b & 0x0f;
+    min = 0x800;
+  } else if ((b & 0xf8) == 0xf0) {
+    length = 4;
+    cp = b & 0x07;
+    min = 0x10000;
+  } else {
+    return -1;
+  }
+
+  for (int i = 1; i < length; ++i) {
+    if (first == last) return -1;
+    unsigned char c = *first;
+    if ((c & 0xc0) != 0x80) return -1;
+    cp = cp << 6 | (c & 0x3f);
+    ++first;
+  }
+  if (cp < min || cp > k_max_code_point ||
+      (cp >= k_min_surrogate && cp <= k_max_surrogate)) {
+    return -1;
+  }
+  return cp;
+}
+
+/*! \brief Append to out the sequences matching the UTF-8 encodings of the
+ * code points in [lo, hi].
+ *
+ * The surrogates and the code points beyond U+10FFFF are left out. The
+ * sequences are disjoint and in the order of the code points, and each one
+ * is a product of byte ranges, so it is matched with a chain of byte sets.
+ */
+inline void utf8_sequences(char32_t lo, char32_t hi,
+                           std::vector<utf8_sequence>& out) {
+  if (hi > k_max_code_point) hi = k_max_code_point;
+  if (lo > hi) return;
+  if (lo < k_min_surrogate && hi > k_max_surrogate) {
+    utf8_sequences(lo, k_min_surrogate - 1, out);
+    utf8_sequences(k_max_surrogate + 1, hi, out);
+    return;
+  }
+  if (lo >= k_min_surrogate && lo <= k_max_surrogate) lo = k_max_surrogate + 1;
+  if (hi >= k_min_surrogate && hi <= k_max_surrogate) hi = k_min_surrogate - 1;
+  if (lo > hi) return;
+
+  // Split the range at the boundaries of the encoding lengths.
+  static const char32_t k_length_max[] = {0x7f, 0x7ff, 0xffff};
+  for (char32_t max : k_length_max) {
+    if (lo <= max && max < hi) {
+      utf8_sequences(lo, max, out);
+      utf8_sequences(max + 1, hi, out);
+      return;
+    }
+  }
+
+  // Split the range until the trailing bytes of lo and hi span all their
+  // values, so that every byte varies independently.
+  for (int i = 1; i < 4; ++i) {
+    char32_t m = (char32_t(1) << (6 * i)) - 1;
+    if ((lo & ~m) != (hi & ~m)) {
+      if ((lo & m) != 0) {
+        utf8_sequences(lo, lo | m, out);
+        utf8_sequences((lo | m) + 1, hi, out);
+        return;
+      }
+      if ((hi & m) != m) {
+        utf8_sequences(lo, (hi & ~m) - 1, out);
+        utf8_sequences(hi & ~m, hi, out);
+        return;
+      }
+    }
+  }
+
+  utf8_sequence seq;
+  seq.length = utf8_encode(lo, seq.lo);
+  utf8_encode(hi, seq.hi);
+  out.push_back(seq);
+}
+}
+
+#endif
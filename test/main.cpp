@@ -1,5 +1,24 @@
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
 #include "gtest/gtest.h"
 
+/*! \brief The number of the allocations of the calling thread, for the tests
+ * checking that a match does not allocate.
+ */
+thread_local std::size_t allocation_count = 0;
+
+void* operator new(std::size_t size) {
+  ++allocation_count;
+  if (void* p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,87 @@
+#include <list>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "regex/regex.h"
+#include "regex/regex_backtrack.h"
+#include "regex/regex_func.h"
+#include "regex/regex_matcher.h"
+
+#include "regex_differential.h"
+
+using namespace regex;
+
+typedef basic_regex<char> Regex;
+typedef bounded_backtracker<Regex::nfa_type> Backtracker;
+typedef match_results<typename std::string::const_iterator> MatchResults;
+typedef regex_matcher<Regex, typename std::string::const_iterator,
+                      MatchResults>
+    RegexMatcher;
+
+TEST(BoundedBacktrackerTest, Fits) {
+  Regex re("ab");
+  Backtracker bt(re.nfa(), re.nfa().size() * 4);
+  std::string s("abc");
+  EXPECT_TRUE(bt.fits(s.cbegin(), s.cend()));
+  EXPECT_TRUE(bt.fits(s.cbegin(), s.cbegin()));
+  std::string s2("abcd");
+  EXPECT_FALSE(bt.fits(s2.cbegin(), s2.cend()));
+  EXPECT_FALSE(Backtracker(re.nfa(), 1).fits(s.cbegin(), s.cbegin()));
+}
+
+TEST(BoundedBacktrackerTest, BoundedDistance) {
+  std::string s("abcd");
+  EXPECT_EQ(4u, bounded_distance(s.cbegin(), s.cend(), 10));
+  EXPECT_EQ(4u, bounded_distance(s.cbegin(), s.cend(), 4));
+  EXPECT_EQ(3u, bounded_distance(s.cbegin(), s.cend(), 2));
+  std::list<char> l(s.begin(), s.end());
+  EXPECT_EQ(4u, bounded_distance(l.cbegin(), l.cend(), 10));
+  EXPECT_EQ(4u, bounded_distance(l.cbegin(), l.cend(), 4));
+  EXPECT_EQ(3u, bounded_distance(l.cbegin(), l.cend(), 2));
+
+  Regex re("ab");
+  Backtracker bt(re.nfa(), re.nfa().size() * 4);
+  std::size_t length = 0;
+  EXPECT_TRUE(bt.fits(l.cbegin(), std::prev(l.cend()), length));
+  EXPECT_EQ(3u, length);
+  EXPECT_FALSE(bt.fits(l.cbegin(), l.cend()));
+}
+
+TEST(BoundedBacktrackerTest, SameAsMatcher) {
+  for_each_case<Regex>(
+      differential_patterns(), differential_inputs(),
+      [](const Regex& re, const std::string& s) {
+        Backtracker bt(re.nfa());
+        ASSERT_TRUE(bt.fits(s.cbegin(), s.cend()));
+        for (int start_id : {re.nfa().start_id(), re.nfa().search_start_id()}) {
+          MatchResults expected, actual;
+          RegexMatcher rm(s.cbegin(), s.cend(), re, expected, start_id);
+          ASSERT_EQ(expected.ready(),
+                    bt.match(s.cbegin(), s.cend(), actual, start_id));
+          if (expected.ready()) {
+            expect_same_groups(expected, actual, s.cbegin());
+          }
+        }
+      });
+}
+
+TEST(BoundedBacktrackerTest, LongInput) {
+  Regex re("(a|b)*c");
+  std::string s(REGEX_BACKTRACK_BUDGET, 'a');
+  s += 'c';
+  EXPECT_FALSE(Backtracker(re.nfa()).fits(s.cbegin(), s.cend()));
+  MatchResults m;
+  ASSERT_TRUE(regex_match(s.cbegin(), s.cend(), m, re));
+  EXPECT_EQ(s.size(), std::size_t(m[0].length()));
+}
+
+TEST(BoundedBacktrackerTest, EmptyProgram) {
+  Regex re;
+  std::string s("abc");
+  EXPECT_FALSE(Backtracker(re.nfa()).fits(s.cbegin(), s.cend()));
+  MatchResults m;
+  EXPECT_FALSE(regex_match(s.cbegin(), s.cend(), m, re));
+  EXPECT_FALSE(regex_search(s.cbegin(), s.cend(), m, re));
+  EXPECT_FALSE(regex_match(s.cbegin(), s.cend(), re));
+  EXPECT_FALSE(regex_search(s.cbegin(), s.cend(), re));
+}
@@ -0,0 +1,54 @@
+#include <string>
+
+#include "gtest/gtest.h"
+#include "regex/regex.h"
+#include "regex/regex_bit_parallel.h"
+#include "regex/regex_func.h"
+
+#include "regex_differential.h"
+
+using namespace regex;
+
+typedef basic_regex<char> Regex;
+typedef bit_parallel_nfa<Regex::nfa_type> BitParallelNFA;
+typedef match_results<typename std::string::const_iterator> MatchResults;
+
+TEST(BitParallelNFATest, Available) {
+  EXPECT_TRUE(Regex("a(b|c)*d").bit_parallel().available());
+  EXPECT_EQ(4u, Regex("a(b|c)*d").bit_parallel().position_count());
+  EXPECT_FALSE(Regex(std::string(65, 'a')).bit_parallel().available());
+  EXPECT_FALSE(basic_regex<wchar_t>(L"abc").bit_parallel().available());
+
+  // The byte masks are not kept inline by the unavailable engines.
+  EXPECT_LT(sizeof(BitParallelNFA), 256 * sizeof(std::uint64_t));
+}
+
+TEST(BitParallelNFATest, SameAsMatcher) {
+  for_each_case<Regex>(
+      differential_patterns(), differential_inputs(),
+      [](const Regex& re, const std::string& s) {
+        BitParallelNFA anchored(re.nfa(), re.nfa().start_id());
+        BitParallelNFA unanchored(re.nfa(), re.nfa().search_start_id());
+        ASSERT_TRUE(anchored.available());
+        MatchResults m1, m2;
+        bool matched = regex_match(s.cbegin(), s.cend(), m1, re);
+        bool found = regex_search(s.cbegin(), s.cend(), m2, re);
+        EXPECT_EQ(matched, anchored.match(s.cbegin(), s.cend()));
+        EXPECT_EQ(found, anchored.search(s.cbegin(), s.cend()));
+        EXPECT_EQ(found, unanchored.match(s.cbegin(), s.cend()));
+        EXPECT_EQ(matched, regex_match(s.cbegin(), s.cend(), re));
+        EXPECT_EQ(found, regex_search(s.cbegin(), s.cend(), re));
+      });
+}
+
+TEST(BitParallelNFATest, LongInput) {
+  Regex re("a(b|c)*d");
+  ASSERT_TRUE(re.bit_parallel().available());
+  std::string s = "a" + std::string(REGEX_BIT_PARALLEL_MAX_INPUT, 'b');
+  EXPECT_FALSE(regex_match(s.cbegin(), s.cend(), re));
+  EXPECT_FALSE(regex_search(s.cbegin(), s.cend(), re));
+  s += 'd';
+  EXPECT_TRUE(regex_match(s.cbegin(), s.cend(), re));
+  EXPECT_TRUE(regex_search(s.cbegin(), s.cend(), re));
+  EXPECT_TRUE(re.bit_parallel().match(s.cbegin(), s.cend()));
+}
@@ -0,0 +1,57 @@
+#include <string>
+
+#include "gtest/gtest.h"
+#include "regex/regex.h"
+#include "regex/regex_byte_classes.h"
+#include "regex/regex_dfa.h"
+
+#include "regex_differential.h"
+
+using namespace regex;
+
+typedef basic_regex<char> Regex;
+typedef lazy_dfa<Regex::nfa_type> DFA;
+
+TEST(ByteClassesTest, Identity) {
+  byte_classes classes;
+  EXPECT_EQ(256u, classes.size());
+  for (int b = 0; b < 256; ++b) EXPECT_EQ(b, classes[b]);
+}
+
+TEST(ByteClassesTest, FromCategories) {
+  // The classes are a, b, c and the others, and the any char of the search
+  // loop splits nothing.
+  Regex re("(a|b)*c");
+  auto& classes = re.classes();
+  EXPECT_EQ(4u, classes.size());
+  EXPECT_NE(classes['a'], classes['b']);
+  EXPECT_NE(classes['b'], classes['c']);
+  EXPECT_NE(classes['a'], classes['x']);
+  EXPECT_EQ(classes['x'], classes['y']);
+  EXPECT_EQ(classes[0], classes[255]);
+}
+
+TEST(ByteClassesTest, SameChars) {
+  Regex re("ab|ba");
+  EXPECT_EQ(3u, re.classes().size());
+}
+
+TEST(ByteClassesTest, SameAsWithoutClasses) {
+  auto patterns = differential_patterns();
+  patterns.push_back("x.y");
+  auto inputs = differential_inputs();
+  inputs.push_back("xzy");
+  for_each_case<Regex>(
+      patterns, inputs, [](const Regex& re, const std::string& s) {
+        DFA plain(re.nfa(), re.nfa().search_start_id());
+        DFA classed(re.nfa(), re.nfa().search_start_id());
+        classed.set_byte_classes(&re.classes());
+        std::string::const_iterator end1, end2;
+        auto r1 = plain.find(s.cbegin(), s.cend(), end1);
+        auto r2 = classed.find(s.cbegin(), s.cend(), end2);
+        ASSERT_EQ(r1, r2);
+        if (r1 == k_dfa_match) {
+          EXPECT_EQ(end1, end2);
+        }
+      });
+}
@@ -0,0 +1,70 @@
+#include <random>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "regex/regex_byte_set.h"
+
+using namespace regex;
+
+static byte_set make_set(const std::string& bytes) {
+  byte_set s;
+  for (unsigned char b : bytes) s.insert(b);
+  return s;
+}
+
+TEST(ByteSetTest, Insert) {
+  byte_set s;
+  EXPECT_TRUE(s.empty());
+  s.insert_range('a', 'z');
+  s.insert(255);
+  EXPECT_EQ(27u, s.count());
+  EXPECT_TRUE(s.contains('m'));
+  EXPECT_TRUE(s.contains(255));
+  EXPECT_FALSE(s.contains('A'));
+  s.flip();
+  EXPECT_EQ(229u, s.count());
+  EXPECT_FALSE(s.contains('m'));
+}
+
+TEST(ByteSetScannerTest, Vectorized) {
+  byte_set word;
+  word.insert_range('0', '9');
+  word.insert_range('A', 'Z');
+  word.insert('_');
+  word.insert_range('a', 'z');
+#if defined(__SSE2__) || defined(__AVX2__)
+  EXPECT_TRUE(byte_set_scanner(word).vectorized());
+  word.flip();
+  EXPECT_TRUE(byte_set_scanner(word).vectorized());
+#endif
+  EXPECT_FALSE(byte_set_scanner(make_set("acegikmoq")).vectorized());
+}
+
+TEST(ByteSetScannerTest, SameAsBitmap) {
+  const char* sets[] = {"abcdefghijklmnopqrstuvwxyz0123456789", "\"", "",
+                        "acegikmoq", "\x80\xff\x01"};
+  std::mt19937 gen(1);
+  std::string input;
+  for (int i = 0; i < 1000; ++i) {
+    // Long runs of a few bytes, to test the scanners across the blocks.
+    unsigned char b = "az0\"q\x80 \xff"[gen() % 8];
+    input.append(gen() % 40, char(b));
+  }
+  auto first = reinterpret_cast<const unsigned char*>(input.data());
+  auto last = first + input.size();
+
+  for (auto chars : sets) {
+    byte_set set = make_set(chars);
+    for (int flipped = 0; flipped < 2; ++flipped) {
+      byte_set_scanner scanner(set);
+      for (auto p = first; p != last; ++p) {
+        auto in = p, out = p;
+        while (in != last && !set.contains(*in)) ++in;
+        while (out != last && set.contains(*out)) ++out;
+        ASSERT_EQ(in, scanner.find(p, last)) << chars << " at " << p - first;
+        ASSERT_EQ(out, scanner.skip(p, last)) << chars << " at " << p - first;
+      }
+      set.flip();
+    }
+  }
+}
@@ -0,0 +1,41 @@
+#include "gtest/gtest.h"
+#include "regex/regex_capture.h"
+
+using namespace regex;
+
+typedef capture_pool<int> IntCapturePool;
+
+TEST(CapturePoolTest, AllocEmpty) {
+  IntCapturePool pool;
+  pool.reset(3);
+  int a = pool.alloc();
+  EXPECT_EQ(0, pool.slots(a)[0]);
+  EXPECT_EQ(0, pool.slots(a)[2]);
+}
+
+TEST(CapturePoolTest, CopyOnWrite) {
+  IntCapturePool pool;
+  pool.reset(2);
+  int a = pool.alloc();
+  pool.slots(a)[1] = 7;
+  int b = pool.copy(a);
+  pool.slots(b)[1] = 8;
+  EXPECT_NE(a, b);
+  EXPECT_EQ(7, pool.slots(a)[1]);
+  EXPECT_EQ(8, pool.slots(b)[1]);
+}
+
+TEST(CapturePoolTest, Recycle) {
+  IntCapturePool pool;
+  pool.reset(2);
+  int a = pool.alloc();
+  pool.retain(a);
+  pool.release(a);
+  int b = pool.alloc();
+  EXPECT_NE(a, b);
+  pool.slots(a)[0] = 5;
+  pool.release(a);
+  int c = pool.alloc();
+  EXPECT_EQ(a, c);
+  EXPECT_EQ(0, pool.slots(c)[0]);
+}
@@ -0,0 +1,95 @@
+#include <string>
+
+#include "gtest/gtest.h"
+#include "regex/regex.h"
+#include "regex/regex_closure.h"
+#include "regex/regex_func.h"
+#include "regex/regex_matcher.h"
+
+#include "regex_differential.h"
+
+using namespace regex;
+
+typedef basic_regex<char> Regex;
+typedef match_results<typename std::string::const_iterator> MatchResults;
+
+/*! \brief A regex without the precomputed closures, so the matcher walks the
+ * program.
+ */
+struct walking_regex {
+  typedef Regex::nfa_type nfa_type;
+
+  const Regex& re;
+  Regex::closures_type none;
+
+  const Regex::packed_type& packed() const { return re.packed(); }
+  const Regex::closures_type& closures() const { return none; }
+  unsigned mark_count() const { return re.mark_count(); }
+};
+
+TEST(EpsilonClosuresTest, Available) {
+  EXPECT_TRUE(Regex("a").closures().available());
+  EXPECT_TRUE(Regex("(a|b)*c").closures().available());
+  EXPECT_FALSE(Regex().closures().available());
+
+  // A large alternation under a star has a large closure after every char,
+  // unless the optimizer merges the alternatives.
+  std::string p("(x");
+  for (int i = 0; i < 200; ++i) p += "|x";
+  p += ")*";
+  EXPECT_TRUE(Regex(p).closures().available());
+  Regex re(p, k_syntax_no_optimize);
+  EXPECT_FALSE(re.closures().available());
+  std::string s(10, 'x');
+  MatchResults m;
+  ASSERT_TRUE(regex_match(s.cbegin(), s.cend(), m, re));
+  EXPECT_EQ("x", m[1].str());
+}
+
+TEST(EpsilonClosuresTest, PriorityOrder) {
+  Regex re("(a)|b|a?");
+  auto& closures = re.closures();
+  int start_id = re.nfa().start_id();
+  ASSERT_TRUE(closures.contains(start_id));
+  auto first = closures.begin(start_id);
+  ASSERT_EQ(4, closures.end(start_id) - first);
+
+  // All the entries write the start of group 0, the first a also the start
+  // of group 1, and the accept the end of group 0. b and the second a share
+  // their writes.
+  EXPECT_TRUE(re.nfa().match(first[0].pc, 'a'));
+  ASSERT_EQ(2u, first[0].write_count);
+  EXPECT_EQ(0u, closures.writes(first[0])[0]);
+  EXPECT_EQ(2u, closures.writes(first[0])[1]);
+  EXPECT_TRUE(re.nfa().match(first[1].pc, 'b'));
+  ASSERT_EQ(1u, first[1].write_count);
+  EXPECT_EQ(0u, closures.writes(first[1])[0]);
+  EXPECT_TRUE(re.nfa().match(first[2].pc, 'a'));
+  EXPECT_EQ(first[1].first_write, first[2].first_write);
+  EXPECT_EQ(k_accept, re.nfa()[first[3].pc].opcode);
+  ASSERT_EQ(2u, first[3].write_count);
+  EXPECT_EQ(1u, closures.writes(first[3])[1]);
+}
+
+TEST(EpsilonClosuresTest, SameAsWalk) {
+  typedef regex_matcher<Regex, std::string::const_iterator, MatchResults>
+      RegexMatcher;
+  typedef regex_matcher<walking_regex, std::string::const_iterator,
+                        MatchResults>
+      WalkingMatcher;
+  for_each_case<Regex>(
+      differential_patterns(), differential_inputs(),
+      [](const Regex& re, const std::string& s) {
+        ASSERT_TRUE(re.closures().available());
+        walking_regex walk{re, {}};
+        for (int start_id : {re.nfa().start_id(), re.nfa().search_start_id()}) {
+          MatchResults expected, actual;
+          WalkingMatcher wm(s.cbegin(), s.cend(), walk, expected, start_id);
+          RegexMatcher rm(s.cbegin(), s.cend(), re, actual, start_id);
+          ASSERT_EQ(expected.ready(), actual.ready());
+          if (expected.ready()) {
+            expect_same_groups(expected, actual, s.cbegin());
+          }
+        }
+      });
+}
@@ -0,0 +1,108 @@
+#include <string>
+
+#include "gtest/gtest.h"
+#include "regex/regex.h"
+#include "regex/regex_dfa.h"
+#include "regex/regex_func.h"
+
+#include "regex_differential.h"
+
+using namespace regex;
+
+typedef basic_regex<char> Regex;
+typedef lazy_dfa<Regex::nfa_type> DFA;
+typedef match_results<typename std::string::const_iterator> MatchResults;
+
+/*! \brief Return the length of the match found by the DFA, or -1.
+ */
+static int dfa_match_length(const Regex& re, const std::string& s) {
+  DFA dfa(re.nfa(), re.nfa().start_id());
+  std::string::const_iterator match_end;
+  if (dfa.find(s.cbegin(), s.cend(), match_end) != k_dfa_match) return -1;
+  return match_end - s.cbegin();
+}
+
+/*! \brief Return the length of the match found by regex_matcher, or -1.
+ */
+static int matcher_match_length(const Regex& re, const std::string& s) {
+  MatchResults what;
+  if (!regex_match(s.cbegin(), s.cend(), what, re)) return -1;
+  return what[0].length();
+}
+
+TEST(LazyDFATest, MatchEnd) {
+  for_each_case<Regex>(differential_patterns(), differential_inputs(),
+                       [](const Regex& re, const std::string& s) {
+                         EXPECT_EQ(matcher_match_length(re, s),
+                                   dfa_match_length(re, s));
+                       });
+}
+
+TEST(LazyDFATest, ReuseCache) {
+  Regex re("(a|b)*c");
+  DFA dfa(re.nfa(), re.nfa().start_id());
+  std::string s("ababbac");
+  std::string::const_iterator match_end;
+  ASSERT_EQ(k_dfa_match, dfa.find(s.cbegin(), s.cend(), match_end));
+  auto states = dfa.state_count();
+  ASSERT_EQ(k_dfa_match, dfa.find(s.cbegin(), s.cend(), match_end));
+  EXPECT_EQ(states, dfa.state_count());
+  EXPECT_EQ(s.cend(), match_end);
+}
+
+TEST(LazyDFATest, FlushCache) {
+  Regex re("(a|b)*cde");
+  DFA dfa(re.nfa(), re.nfa().start_id(), 3);
+  std::string s("abababababababababababababababababababcde");
+  std::string::const_iterator match_end;
+  ASSERT_EQ(k_dfa_match, dfa.find(s.cbegin(), s.cend(), match_end));
+  EXPECT_EQ(s.cend(), match_end);
+  EXPECT_GT(dfa.flush_count(), 0u);
+  EXPECT_LE(dfa.state_count(), 3u);
+}
+
+TEST(LazyDFATest, GiveUp) {
+  Regex re("(a|b)*a(a|b)(a|b)(a|b)(a|b)c");
+  DFA dfa(re.nfa(), re.nfa().start_id(), 3);
+  std::string s("abbaabbbaababbbaabaaababbbbabaaaba");
+  std::string::const_iterator match_end;
+  EXPECT_EQ(k_dfa_gave_up, dfa.find(s.cbegin(), s.cend(), match_end));
+}
+
+TEST(LazyDFATest, RegexMatch) {
+  Regex re("a(b|c)+d");
+  std::string s1("abcbd"), s2("abcb");
+  EXPECT_TRUE(regex_match(s1.cbegin(), s1.cend(), re));
+  EXPECT_FALSE(regex_match(s2.cbegin(), s2.cend(), re));
+}
+
+TEST(LazyDFATest, RegexSearch) {
+  Regex re("ab+c");
+  std::string s1("acaabcdabbcabbbc"), s2("acaabdabbabbb");
+  EXPECT_TRUE(regex_search(s1.cbegin(), s1.cend(), re));
+  EXPECT_FALSE(regex_search(s2.cbegin(), s2.cend(), re));
+}
+
+TEST(LazyDFATest, WideChar) {
+  basic_regex<wchar_t> re(L"a(b|c)*d");
+  std::wstring s(L"xxabcbcd");
+  EXPECT_TRUE(regex_search(s.cbegin(), s.cend(), re));
+  EXPECT_FALSE(regex_match(s.cbegin(), s.cend(), re));
+}
+
+TEST(LazyDFATest, SkipLoop) {
+  Regex re("[a-z0-9]+@[a-z]+");
+  std::string s(1000, 'x');
+  s += "@y " + std::string(1000, ' ') + "a@";
+  DFA dfa(re.nfa(), re.nfa().search_start_id());
+  dfa.set_byte_classes(&re.classes());
+  const char* match_end;
+  ASSERT_EQ(k_dfa_match, dfa.find(s.data(), s.data() + s.size(), match_end));
+  EXPECT_EQ(1002, match_end - s.data());
+  EXPECT_GT(dfa.accelerated_count(), 0u);
+
+  MatchResults what;
+  ASSERT_TRUE(regex_search(s.cbegin(), s.cend(), what, re));
+  EXPECT_EQ(0, what[0].first() - s.cbegin());
+  EXPECT_EQ(1002, what[0].length());
+}
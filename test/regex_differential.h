@@ -0,0 +1,94 @@
+#ifndef __REGEX_DIFFERENTIAL_H__
+#define __REGEX_DIFFERENTIAL_H__
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+/*! \brief The patterns the engines are compared on.
+ *
+ * They are small enough for every engine: the bit-parallel engine, the
+ * precomputed closures and the bounded backtracker accept them all. They
+ * cover the empty patterns, the nested and empty loops, the alternatives
+ * sharing prefixes or tails, and the groups set in a loop.
+ */
+inline std::vector<std::string> differential_patterns() {
+  return {"",
+          "a",
+          "a*",
+          "a+",
+          "a?",
+          "a|b",
+          "a|b?",
+          "abc",
+          "a(b)((c))",
+          "(a)*",
+          "a+b",
+          "a?b",
+          "a|bc",
+          "a**",
+          "a?+",
+          "(a?)+",
+          "(a*)*",
+          "(a*)+b",
+          "((a)|b)+",
+          "(ab|cb)d",
+          "(a|ab)(c|bcd)(d*)",
+          "(a|b)*(ab|b)",
+          "(a|ab)*c",
+          "((a*)(b*))*c",
+          "(a+|b+)*(a|c)",
+          "(a|bc?de+(f*))+",
+          "a+(b*(c|d+)+(e?))*x",
+          "b(a*)b",
+          "x(ab|a)*y?",
+          "((a)(b))?(a)",
+          "(x|y|x|y)*(z|x)"};
+}
+
+/*! \brief The inputs the engines are compared on.
+ */
+inline std::vector<std::string> differential_inputs() {
+  return {"",       "a",       "b",      "aa",     "ab",     "abc",
+          "abcd",   "bc",      "bcd",    "cbd",    "aabab",  "xabcd",
+          "xxabcd", "ababbc",  "aaabbbc", "bbacaa", "xababy", "cbaabx",
+          "xbaab",  "xyxz",    "abdeeeeb", "bcdeef", "aaaabcceddcdcx"};
+}
+
+/*! \brief Call check(re, s) with the regex re of each pattern and each input
+ * s.
+ *
+ * The pattern and the input are in the messages of the failures.
+ */
+template <class Regex, class Check>
+void for_each_case(const std::vector<std::string>& patterns,
+                   const std::vector<std::string>& inputs, Check check) {
+  for (auto& p : patterns) {
+    SCOPED_TRACE("pattern: " + p);
+    Regex re(p);
+    for (auto& s : inputs) {
+      SCOPED_TRACE("input: " + s);
+      check(re, s);
+    }
+  }
+}
+
+/*! \brief Expect actual to have the groups of expected, at the same offsets
+ * from first.
+ */
+template <class MatchResults, class BidirIt>
+void expect_same_groups(const MatchResults& expected,
+                        const MatchResults& actual, BidirIt first) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    SCOPED_TRACE("group: " + std::to_string(i));
+    ASSERT_EQ(expected[i].matched(), actual[i].matched());
+    if (!expected[i].matched()) continue;
+    EXPECT_EQ(expected[i].first() - first, actual[i].first() - first);
+    EXPECT_EQ(expected[i].last() - first, actual[i].last() - first);
+  }
+}
+
+#endif
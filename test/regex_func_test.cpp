@@ -1,11 +1,16 @@
+#include <cstddef>
 #include <locale>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "regex/regex.h"
 #include "regex/regex_match_results.h"
 #include "regex/regex_func.h"
 
+#include "regex_differential.h"
+
 using namespace regex;
 
 typedef basic_regex<char> Regex;
@@ -13,6 +18,11 @@ typedef match_results<typename std::string::iterator> MatchResults;
 typedef regex_matcher<Regex, typename std::string::iterator, MatchResults>
 RegexMatcher;
 
+/*! \brief The number of the allocations of the calling thread, counted by
+ * the operator new of main.cpp.
+ */
+extern thread_local std::size_t allocation_count;
+
 TEST(RegexMatchTest, Match) {
   Regex re("a(b)c");
   MatchResults what;
@@ -56,3 +66,162 @@ TEST(RegexSearchTest, SearchNone) {
 
   EXPECT_FALSE(what.ready());
 }
+
+TEST(RegexSearchTest, SharedSearchProgram) {
+  Regex re("ab+c");
+  auto size = re.nfa().size();
+  ASSERT_GE(re.nfa().search_start_id(), 0);
+  EXPECT_NE(re.nfa().start_id(), re.nfa().search_start_id());
+
+  MatchResults what;
+  std::string s("xxabbc");
+  EXPECT_TRUE(regex_search(s.begin(), s.end(), what, re));
+  EXPECT_EQ("abbc", what[0].str());
+  EXPECT_TRUE(regex_search(s.begin(), s.end(), what, re));
+  EXPECT_EQ(size, re.nfa().size());
+}
+
+TEST(MatchContextTest, SameAsWithoutContext) {
+  typedef typename std::string::iterator iterator;
+  for_each_case<Regex>(
+      differential_patterns(), differential_inputs(),
+      [](const Regex& re, const std::string& input) {
+        match_context<Regex, iterator> ctx(re);
+        for (int round = 0; round < 2; ++round) {
+          std::string s(input + std::string(round * 1000, 'a'));
+          MatchResults expected, what;
+          bool found = regex_search(s.begin(), s.end(), expected, re);
+          ASSERT_EQ(found, regex_search(s.begin(), s.end(), what, re, ctx));
+          if (found) expect_same_groups(expected, what, s.begin());
+
+          found = regex_match(s.begin(), s.end(), expected, re);
+          ASSERT_EQ(found, regex_match(s.begin(), s.end(), what, re, ctx));
+          if (found) expect_same_groups(expected, what, s.begin());
+        }
+      });
+}
+
+TEST(MatchContextTest, Threads) {
+  typedef typename std::string::const_iterator iterator;
+  Regex re("(a|b)+=(c|d)+;");
+  std::string s = std::string(5000, 'x') + "ab=cd;";
+  std::vector<std::thread> threads;
+  std::vector<int> found(4, 0);
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < 20; ++i) {
+        match_results<iterator> what;
+        auto& ctx = thread_match_context<iterator>(re);
+        EXPECT_EQ(&ctx, &thread_match_context<iterator>(re));
+        if (regex_search(s.cbegin(), s.cend(), what, re, ctx) &&
+            what[2].str() == "d") {
+          ++found[t];
+        }
+      }
+    });
+  }
+  for (auto& t : threads) t.join();
+  EXPECT_EQ((std::vector<int>{20, 20, 20, 20}), found);
+}
+
+TEST(MatchContextTest, DefaultOverloads) {
+  typedef typename std::string::const_iterator iterator;
+  // Too large for the bit-parallel engine, and the input too long for the
+  // backtracker, so the DFAs run.
+  std::string pattern("(a|b)+=(c|d)+;");
+  for (int i = 0; i < 40; ++i) pattern += "|y" + std::to_string(i) + "z";
+  Regex re(pattern);
+  ASSERT_FALSE(re.bit_parallel().available());
+  std::string s = std::string(1 << 20, 'x') + "ab=cd;";
+  auto& ctx = thread_match_context<iterator>(re);
+  EXPECT_EQ(0u, ctx.search_dfa().state_count());
+
+  // The overloads without a context keep the DFA states in the one of the
+  // thread.
+  ASSERT_TRUE(regex_search(s.cbegin(), s.cend(), re));
+  std::size_t states = ctx.search_dfa().state_count();
+  EXPECT_NE(0u, states);
+  EXPECT_TRUE(regex_search(s.cbegin(), s.cend(), re));
+  EXPECT_EQ(states, ctx.search_dfa().state_count());
+  match_results<iterator> what;
+  ASSERT_TRUE(regex_search(s.cbegin(), s.cend(), what, re));
+  EXPECT_EQ("d", what[2].str());
+  EXPECT_EQ(&ctx, &thread_match_context<iterator>(re));
+}
+
+TEST(MatchContextTest, LeastRecentlyUsed) {
+  typedef typename std::string::const_iterator iterator;
+  typedef match_context<Regex, iterator> context_type;
+  match_context_pool<context_type> pool(2);
+  Regex a("(a|b)+x"), b("(a|b)+y"), c("(a|b)+z");
+  std::string s(100, 'a');
+  iterator match_end;
+
+  context_type* context_a = &pool.get(a);
+  pool.get(b).search_dfa().find(s.cbegin(), s.cend(), match_end);
+  EXPECT_NE(0u, pool.get(b).search_dfa().state_count());
+  EXPECT_EQ(context_a, &pool.get(a));
+
+  // b is the least recently used, so c replaces it.
+  pool.get(c);
+  EXPECT_EQ(2u, pool.size());
+  EXPECT_EQ(context_a, &pool.get(a));
+  EXPECT_EQ(0u, pool.get(b).search_dfa().state_count());
+}
+
+TEST(MatchContextTest, ManyRegexes) {
+  typedef typename std::string::const_iterator iterator;
+  std::vector<Regex> regexes;
+  for (int i = 0; i < 20; ++i) {
+    regexes.emplace_back("(a|b)+=" + std::to_string(i) + "(c|d)+;");
+  }
+  std::string s = std::string(100, 'a') + "=7cd;";
+  match_results<iterator> what;
+  auto search_all = [&] {
+    std::size_t found = 0;
+    for (auto& re : regexes) {
+      found += regex_search(s.cbegin(), s.cend(), re);
+      found += regex_search(s.cbegin(), s.cend(), what, re);
+    }
+    return found;
+  };
+
+  // After the first round, the contexts of all the regexes are kept, and the
+  // searches do not allocate.
+  EXPECT_EQ(2u, search_all());
+  std::size_t before = allocation_count;
+  std::size_t found = search_all();
+  std::size_t after = allocation_count;
+  EXPECT_EQ(2u, found);
+  EXPECT_EQ(before, after);
+}
+
+TEST(MatchContextTest, Serial) {
+  Regex re("abc");
+  Regex copy(re);
+  EXPECT_NE(re.serial(), copy.serial());
+  auto serial = copy.serial();
+  copy = Regex("abd");
+  EXPECT_NE(serial, copy.serial());
+}
+
+TEST(RegexSearchTest, Bracket) {
+  struct {
+    const char* pattern;
+    const char* input;
+    const char* match;
+  } cases[] = {
+      {"[a-z0-9]+", "  Foo42 bar", "oo42"},
+      {"\\d+-\\w+", "tel: 555-abc_1!", "555-abc_1"},
+      {"[^ ]+\\s+[[:upper:]]", "ab cd  Ef", "cd  E"},
+      {"\\S\\D", "12 3x", "2 "},
+      {"x[-+]?y", "x+z x-y", "x-y"},
+  };
+  for (auto& c : cases) {
+    Regex re(c.pattern);
+    std::string s(c.input);
+    MatchResults what;
+    ASSERT_TRUE(regex_search(s.begin(), s.end(), what, re)) << c.pattern;
+    EXPECT_EQ(c.match, what[0].str()) << c.pattern;
+  }
+}
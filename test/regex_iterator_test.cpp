@@ -0,0 +1,101 @@
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "regex/regex.h"
+#include "regex/regex_iterator.h"
+
+using namespace regex;
+
+typedef basic_regex<char> Regex;
+typedef regex_iterator<typename std::string::const_iterator> RegexIterator;
+typedef regex_token_iterator<typename std::string::const_iterator>
+    RegexTokenIterator;
+typedef std::vector<std::string> Strings;
+
+/*! \brief Return the matches of re in s.
+ */
+static Strings find_all(const char* re, const std::string& s) {
+  Regex e(re);
+  Strings matches;
+  for (RegexIterator it(s.cbegin(), s.cend(), e), end; it != end; ++it) {
+    matches.push_back((*it)[0].str());
+  }
+  return matches;
+}
+
+TEST(RegexIteratorTest, Matches) {
+  EXPECT_EQ((Strings{"abc", "abbc", "ac"}), find_all("ab*c", "xabcabbcyyacx"));
+  EXPECT_EQ(Strings{}, find_all("ab*c", "xxbc"));
+  EXPECT_EQ((Strings{"ERROR disk", "ERROR net"}),
+            find_all("ERROR (a|b|c|d|e|i|k|n|s|t)+",
+                     "INFO ok\nERROR disk\nINFO x\nERROR net\n"));
+}
+
+TEST(RegexIteratorTest, EmptyMatches) {
+  EXPECT_EQ((Strings{"", "aaa", ""}), find_all("a*", "baaa"));
+  EXPECT_EQ((Strings{"", "", ""}), find_all("x*", "ab"));
+  EXPECT_EQ((Strings{""}), find_all("", ""));
+  EXPECT_EQ((Strings{"a", "", "a", ""}), find_all("a|", "aba"));
+}
+
+TEST(RegexIteratorTest, Groups) {
+  Regex re("(a|b)+=(c|d)+;");
+  std::string s(";ab=cd;x b=c;");
+  RegexIterator it(s.cbegin(), s.cend(), re);
+  ASSERT_NE(RegexIterator(), it);
+  EXPECT_EQ("ab=cd;", (*it)[0].str());
+  EXPECT_EQ("b", (*it)[1].str());
+  EXPECT_EQ(1, it->begin()->first() - s.cbegin());
+  RegexIterator copy = it++;
+  EXPECT_EQ("ab=cd;", (*copy)[0].str());
+  EXPECT_EQ("b=c;", (*it)[0].str());
+  EXPECT_EQ("c", (*it)[2].str());
+  ++it;
+  EXPECT_EQ(RegexIterator(), it);
+}
+
+TEST(RegexIteratorTest, LongInput) {
+  std::string s;
+  for (int i = 0; i < 10000; ++i) {
+    s += "10.0.0." + std::to_string(i % 256) + " GET /\n";
+  }
+  Regex re("(0|1|2|3|4|5|6|7|8|9)+.(0|1|2|3|4|5|6|7|8|9)+."
+           "(0|1|2|3|4|5|6|7|8|9)+.(0|1|2|3|4|5|6|7|8|9)+");
+  std::size_t count = 0;
+  for (RegexIterator it(s.cbegin(), s.cend(), re), end; it != end; ++it) {
+    EXPECT_EQ("10.0.0." + std::to_string(count % 256), (*it)[0].str());
+    ++count;
+  }
+  EXPECT_EQ(10000u, count);
+}
+
+TEST(RegexTokenIteratorTest, Split) {
+  Regex re(",+");
+  std::string s("a,b,,c,");
+  Strings tokens;
+  for (RegexTokenIterator it(s.cbegin(), s.cend(), re, -1), end; it != end;
+       ++it) {
+    tokens.push_back(it->str());
+  }
+  EXPECT_EQ((Strings{"a", "b", "c"}), tokens);
+
+  std::string s2("a,b,,cd");
+  tokens.clear();
+  for (RegexTokenIterator it(s2.cbegin(), s2.cend(), re, -1), end; it != end;
+       ++it) {
+    tokens.push_back(it->str());
+  }
+  EXPECT_EQ((Strings{"a", "b", "cd"}), tokens);
+}
+
+TEST(RegexTokenIteratorTest, Submatches) {
+  Regex re("(a|b)+=(c|d)+");
+  std::string s("ab=cd,b=c");
+  Strings tokens;
+  for (RegexTokenIterator it(s.cbegin(), s.cend(), re, {2, 1}), end;
+       it != end; ++it) {
+    tokens.push_back(it->str());
+  }
+  EXPECT_EQ((Strings{"d", "b", "c", "b"}), tokens);
+}
@@ -0,0 +1,66 @@
+#include <list>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "regex/regex.h"
+#include "regex/regex_func.h"
+#include "regex/regex_jit.h"
+
+#include "regex_differential.h"
+
+using namespace regex;
+
+typedef basic_regex<char> Regex;
+typedef jit_dfa<Regex::nfa_type> JitDfa;
+
+TEST(JitDfaTest, Available) {
+  Regex re("(a|b)*c");
+  JitDfa dfa(re.nfa(), re.nfa().start_id(), re.classes());
+  ASSERT_TRUE(dfa.available());
+  EXPECT_EQ(3u, dfa.state_count());
+  EXPECT_EQ(bool(REGEX_ENABLE_JIT), dfa.native());
+  EXPECT_EQ(dfa.native(), dfa.code_size() > 0);
+
+  EXPECT_FALSE(JitDfa().available());
+  EXPECT_FALSE(JitDfa(Regex().nfa(), -1, byte_classes()).available());
+
+  // The DFA of (a|b)*a(a|b){n} takes 2^n states.
+  Regex large("(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)"
+              "(a|b)(a|b)c");
+  JitDfa none(large.nfa(), large.nfa().start_id(), large.classes());
+  EXPECT_FALSE(none.available());
+  regex_jit<Regex> jit(large);
+  std::string s("xaaaaaaaaaaaaac");
+  EXPECT_FALSE(regex_match(s.cbegin(), s.cend(), jit));
+  EXPECT_TRUE(regex_match(s.cbegin() + 1, s.cend(), jit));
+  EXPECT_TRUE(regex_search(s.cbegin(), s.cend(), jit));
+  EXPECT_FALSE(regex_search(s.cbegin() + 2, s.cend(), jit));
+}
+
+TEST(JitDfaTest, SameAsRegex) {
+  auto patterns = differential_patterns();
+  for (auto p : {".x", "[^a-c]+", "\\w+@\\d", "[\x80-\xff]z", "x|", "(|a)b",
+                 "ERROR (a|b)+"}) {
+    patterns.push_back(p);
+  }
+  auto inputs = differential_inputs();
+  for (auto s :
+       {"zab_9@7", " .x", "\x80\xffz", "ERROR b", "cab", "\xff\x01x"}) {
+    inputs.push_back(s);
+  }
+  for_each_case<Regex>(
+      patterns, inputs, [](const Regex& re, const std::string& s) {
+        regex_jit<Regex> jit(re);
+        ASSERT_TRUE(jit.match_dfa().available());
+        ASSERT_TRUE(jit.search_dfa().available());
+        bool match = regex_match(s.cbegin(), s.cend(), re);
+        bool search = regex_search(s.cbegin(), s.cend(), re);
+        EXPECT_EQ(match, regex_match(s.cbegin(), s.cend(), jit));
+        EXPECT_EQ(search, regex_search(s.cbegin(), s.cend(), jit));
+        EXPECT_EQ(match, jit.match_dfa().interpret(s.cbegin(), s.cend()));
+        EXPECT_EQ(search, jit.search_dfa().interpret(s.cbegin(), s.cend()));
+
+        std::list<char> l(s.begin(), s.end());
+        EXPECT_EQ(search, regex_search(l.cbegin(), l.cend(), jit));
+      });
+}
@@ -0,0 +1,69 @@
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "regex/regex.h"
+#include "regex/regex_func.h"
+#include "regex/regex_matcher.h"
+#include "regex/regex_onepass.h"
+
+#include "regex_differential.h"
+
+using namespace regex;
+
+typedef basic_regex<char> Regex;
+typedef match_results<typename std::string::const_iterator> MatchResults;
+typedef regex_matcher<Regex, typename std::string::const_iterator,
+                      MatchResults>
+    RegexMatcher;
+
+TEST(OnePassNFATest, IsOnePass) {
+  EXPECT_TRUE(Regex("").is_one_pass());
+  EXPECT_TRUE(Regex("(a+)(b|c)x").is_one_pass());
+  EXPECT_TRUE(Regex("a*b").is_one_pass());
+  EXPECT_TRUE(Regex("(ab)*").is_one_pass());
+  EXPECT_FALSE(Regex("(a|ab)c").is_one_pass());
+  EXPECT_FALSE(Regex("a*a").is_one_pass());
+  EXPECT_FALSE(Regex("(a*)(a|b)").is_one_pass());
+  EXPECT_TRUE(basic_regex<wchar_t>(L"(a+)(b|c)x").is_one_pass());
+}
+
+TEST(OnePassNFATest, Captures) {
+  Regex re("(a+)(b|c)x");
+  std::string s("aacxy");
+  MatchResults m;
+  ASSERT_TRUE(regex_match(s.cbegin(), s.cend(), m, re));
+  ASSERT_EQ(3u, m.size());
+  EXPECT_EQ("aacx", m[0].str());
+  EXPECT_EQ("aa", m[1].str());
+  EXPECT_EQ("c", m[2].str());
+
+  std::string s2("aab");
+  MatchResults m2;
+  EXPECT_FALSE(regex_match(s2.cbegin(), s2.cend(), m2, re));
+}
+
+TEST(OnePassNFATest, SameAsMatcher) {
+  std::vector<std::string> one_pass = {
+      "",          "a",         "a*",         "(a)*",     "a+b",
+      "(a?)b",     "a|bc",      "(a|b)*c",    "(ab)*(c)?", "a**",
+      "(a?)+",     "(a|bc)(d)", "(b*(a|c))*", "((a)|b)+", "(a|b)*(c|d)+e"};
+  for (auto& p : one_pass) ASSERT_TRUE(Regex(p).is_one_pass()) << p;
+
+  // The patterns of the corpus that are not one-pass are skipped.
+  auto patterns = differential_patterns();
+  patterns.insert(patterns.end(), one_pass.begin(), one_pass.end());
+  auto inputs = differential_inputs();
+  for (auto s : {"abab", "aaba", "cde", "acde", "babacdde"}) {
+    inputs.push_back(s);
+  }
+  for_each_case<Regex>(
+      patterns, inputs, [](const Regex& re, const std::string& s) {
+        if (!re.is_one_pass()) return;
+        MatchResults expected, actual;
+        RegexMatcher rm(s.cbegin(), s.cend(), re, expected);
+        ASSERT_EQ(expected.ready(),
+                  re.onepass().match(s.cbegin(), s.cend(), actual));
+        if (expected.ready()) expect_same_groups(expected, actual, s.cbegin());
+      });
+}
@@ -2,9 +2,13 @@
 
 #include "gtest/gtest.h"
 
+#include "regex/regex.h"
+#include "regex/regex_func.h"
 #include "regex/regex_nfa.h"
 #include "regex/regex_optimizer.h"
 
+#include "regex_differential.h"
+
 using namespace regex;
 
 typedef nfa<instruction<char>, std::allocator<instruction<char>>> CNFA;
@@ -34,3 +38,112 @@ TEST(RedundantInsnOptimizerTest, OrdinaryNFA) {
   ASSERT_EQ(4, opt.nfa()[0].next2);
   ASSERT_EQ(k_accept, opt.nfa()[4].opcode);
 }
+
+typedef basic_regex<char> Regex;
+typedef match_results<std::string::const_iterator> MatchResults;
+
+static std::size_t count_opcode(const Regex& re, opcode op) {
+  std::size_t n = 0;
+  for (auto& insn : re.nfa()) n += insn.opcode == op;
+  return n;
+}
+
+TEST(NFAOptimizerTest, RemovesGotos) {
+  Regex parsed("a|b?", k_syntax_no_optimize);
+  Regex optimized("a|b?");
+  EXPECT_NE(0u, count_opcode(parsed, k_goto));
+  EXPECT_EQ(0u, count_opcode(optimized, k_goto));
+  EXPECT_LT(optimized.nfa().size(), parsed.nfa().size());
+
+  nfa_optimizer<Regex::nfa_type> opt(parsed.nfa(), k_optimize_gotos);
+  EXPECT_EQ(parsed.nfa().size(), opt.original_size());
+  EXPECT_EQ(0u, count_opcode(Regex(), k_goto));
+  for (auto& insn : opt.nfa()) EXPECT_NE(k_goto, insn.opcode);
+}
+
+TEST(NFAOptimizerTest, MergesFragments) {
+  Regex re("(ab|cb)d");
+  std::size_t b = 0;
+  for (auto& insn : re.nfa()) {
+    b += insn.opcode == k_match_char_category &&
+         insn.cc == char_category<char>::ordinary_char('b');
+  }
+  EXPECT_EQ(1u, b);
+
+  // The tails inside a loop are merged too.
+  Regex loop("(ab|cb)*d");
+  b = 0;
+  for (auto& insn : loop.nfa()) {
+    b += insn.opcode == k_match_char_category &&
+         insn.cc == char_category<char>::ordinary_char('b');
+  }
+  EXPECT_EQ(1u, b);
+
+  // The UTF-8 sequences of "." share their last continuation byte.
+  Regex utf8(".", k_syntax_utf8);
+  Regex parsed(".", k_syntax_utf8 | k_syntax_no_optimize);
+  EXPECT_LT(utf8.nfa().size(), parsed.nfa().size());
+}
+
+TEST(NFAOptimizerTest, MergesLongAlternations) {
+  std::string pattern;
+  for (int i = 0; i < 2000; ++i) {
+    if (i > 0) pattern += '|';
+    pattern += std::to_string(i) + "xyz";
+  }
+  Regex re(pattern);
+  EXPECT_EQ(Regex(pattern, k_syntax_no_optimize).nfa().size(),
+            re.original_size());
+  std::size_t z = 0;
+  for (auto& insn : re.nfa()) {
+    z += insn.opcode == k_match_char_category &&
+         insn.cc == char_category<char>::ordinary_char('z');
+  }
+  EXPECT_EQ(1u, z);
+  std::string hit("1999xyz"), miss("2000xyz");
+  EXPECT_TRUE(regex_match(hit.cbegin(), hit.cend(), re));
+  EXPECT_FALSE(regex_match(miss.cbegin(), miss.cend(), re));
+}
+
+TEST(NFAOptimizerTest, NoSubs) {
+  Regex re("(a)((b)|c)", k_syntax_nosubs);
+  EXPECT_EQ(1u, re.mark_count());
+  for (auto& insn : re.nfa()) {
+    if (insn.opcode == k_mark_group_start || insn.opcode == k_mark_group_end) {
+      EXPECT_EQ(0u, insn.group_id);
+    }
+  }
+  std::string s("xab");
+  MatchResults m;
+  ASSERT_TRUE(regex_search(s.cbegin(), s.cend(), m, re));
+  ASSERT_EQ(1u, m.size());
+  EXPECT_EQ("ab", m[0].str());
+}
+
+/*! \brief A pattern compiled with and without the optimizer.
+ */
+struct parsed_and_optimized {
+  explicit parsed_and_optimized(const std::string& p)
+      : parsed(p, k_syntax_no_optimize), optimized(p) {}
+
+  Regex parsed;
+  Regex optimized;
+};
+
+TEST(NFAOptimizerTest, SameAsParsed) {
+  for_each_case<parsed_and_optimized>(
+      differential_patterns(), differential_inputs(),
+      [](const parsed_and_optimized& re, const std::string& s) {
+        ASSERT_LE(re.optimized.nfa().size(), re.parsed.nfa().size());
+        MatchResults expected, actual;
+        bool matched = regex_match(s.cbegin(), s.cend(), expected, re.parsed);
+        ASSERT_EQ(matched,
+                  regex_match(s.cbegin(), s.cend(), actual, re.optimized));
+        if (matched) expect_same_groups(expected, actual, s.cbegin());
+
+        bool found = regex_search(s.cbegin(), s.cend(), expected, re.parsed);
+        ASSERT_EQ(found,
+                  regex_search(s.cbegin(), s.cend(), actual, re.optimized));
+        if (found) expect_same_groups(expected, actual, s.cbegin());
+      });
+}
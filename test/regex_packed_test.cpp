@@ -0,0 +1,74 @@
+#include <string>
+
+#include "gtest/gtest.h"
+#include "regex/regex.h"
+#include "regex/regex_packed.h"
+
+using namespace regex;
+
+typedef basic_regex<char> Regex;
+
+TEST(PackedNFATest, Size) {
+  EXPECT_EQ(8u, sizeof(packed_instruction));
+}
+
+TEST(PackedNFATest, SameAsNFA) {
+  Regex re("(a|b)*(ab|ba)c|x(y)?");
+  auto& nfa = re.nfa();
+  auto& packed = re.packed();
+  ASSERT_EQ(nfa.size(), packed.size());
+  EXPECT_EQ(nfa.mark_count(), packed.mark_count());
+  for (int pc = 0; pc < int(nfa.size()); ++pc) {
+    auto& insn = nfa[pc];
+    ASSERT_EQ(insn.opcode, packed.opcode(pc));
+    switch (insn.opcode) {
+      case k_match_char_category:
+        EXPECT_EQ(insn.next, packed.next(pc));
+        EXPECT_TRUE(insn.cc == packed.cc(pc));
+        break;
+      case k_fork:
+        EXPECT_EQ(insn.next, packed.next(pc));
+        EXPECT_EQ(insn.next2, packed.next2(pc));
+        break;
+      case k_goto:
+      case k_advance:
+        EXPECT_EQ(insn.next, packed.next(pc));
+        break;
+      case k_mark_group_start:
+      case k_mark_group_end:
+        EXPECT_EQ(insn.next, packed.next(pc));
+        EXPECT_EQ(insn.group_id, packed.group_id(pc));
+        break;
+      case k_accept:
+        EXPECT_EQ(insn.group_id, packed.group_id(pc));
+        break;
+    }
+  }
+}
+
+TEST(PackedNFATest, SharedCategories) {
+  // a, b, c, x, y and the any char of the search loop.
+  Regex re("(a|b)*(ab|ba)c|x(y)?");
+  auto& packed = re.packed();
+  EXPECT_EQ(6u, packed.category_count());
+  for (int pc = 0; pc < int(packed.size()); ++pc) {
+    if (packed.opcode(pc) != k_match_char_category) continue;
+    for (char ch : std::string("abcxyz")) {
+      EXPECT_EQ(re.nfa().match(pc, ch), packed.match(pc, ch));
+    }
+  }
+}
+
+TEST(PackedNFATest, SetsInSideTable) {
+  // The sets live in the program's table, the instruction only holds an id.
+  EXPECT_EQ(24u, sizeof(instruction<char>));
+  Regex re("[a-c][a-c]|[^x]");
+  auto& packed = re.packed();
+  EXPECT_EQ(2u, packed.char_sets().size());
+  for (int pc = 0; pc < int(packed.size()); ++pc) {
+    if (packed.opcode(pc) != k_match_char_category) continue;
+    if (packed.cc(pc).type() != k_cc_char_set) continue;
+    EXPECT_TRUE(packed.match(pc, 'b'));
+    EXPECT_FALSE(packed.match(pc, 'x'));
+  }
+}
@@ -0,0 +1,97 @@
+#include <cstddef>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "regex/regex.h"
+#include "regex/regex_func.h"
+#include "regex/regex_parallel.h"
+
+#include "regex_differential.h"
+
+using namespace regex;
+
+typedef basic_regex<char> Regex;
+typedef match_results<typename std::string::const_iterator> MatchResults;
+
+/*! \brief Run the tasks one after another.
+ */
+struct sequential_executor {
+  template <class F>
+  void operator()(std::size_t n, F f) const {
+    for (std::size_t i = 0; i < n; ++i) f(i);
+  }
+};
+
+static parallel_options small_chunks(unsigned threads) {
+  parallel_options options;
+  options.threads = threads;
+  options.min_chunk_size = 3;
+  options.checkpoint_interval = 2;
+  return options;
+}
+
+TEST(ParallelSearchTest, ChunkCount) {
+  Regex re("(a|b)*c");
+  std::string s(100, 'a');
+  parallel_options options;
+  options.threads = 4;
+  options.min_chunk_size = 30;
+  EXPECT_EQ(3u, parallel_chunk_count(s.cbegin(), s.cend(), re, options));
+  options.min_chunk_size = 10;
+  EXPECT_EQ(4u, parallel_chunk_count(s.cbegin(), s.cend(), re, options));
+  options.min_chunk_size = 60;
+  EXPECT_EQ(1u, parallel_chunk_count(s.cbegin(), s.cend(), re, options));
+}
+
+TEST(ParallelSearchTest, SameAsSequential) {
+  auto patterns = differential_patterns();
+  for (auto p : {"(a|b)*(ab|ba)c", "(x|y)?a*b", "(a|c)*bb(a|b)*", "(a|b)*d",
+                 "(b|c)(a|b)*c", "abc(a|b)*", "bab|ca",
+                 "(a|b|c|d|e|f|g|h|i|j|k|l|m|n|o|p|q|x)*c"}) {
+    patterns.push_back(p);
+  }
+  // The long inputs are split into many chunks.
+  auto inputs = differential_inputs();
+  for (auto s : {"aaaaaaaaaaaaaaaaaaaaaaaac", "aaaaaaaaaabbaaaaaaaaaaaaaaab",
+                 "cccccccccccccccccccccccccccabaabbaaac",
+                 "xxxxxxxxxxxxxaaaaaaaaaaaabbbbbbbbbbbb",
+                 "ababababababababababababababababababc",
+                 "dddddddddddddddddddddddddddddddddddd",
+                 "bbaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaac"}) {
+    inputs.push_back(s);
+  }
+  for_each_case<Regex>(
+      patterns, inputs, [](const Regex& re, const std::string& s) {
+        MatchResults expected;
+        bool found = regex_search(s.cbegin(), s.cend(), expected, re);
+        for (unsigned threads = 1; threads <= 8; ++threads) {
+          SCOPED_TRACE("threads: " + std::to_string(threads));
+          parallel_options options = small_chunks(threads);
+          EXPECT_EQ(found,
+                    regex_search_parallel(s.cbegin(), s.cend(), re, options,
+                                          sequential_executor()));
+
+          MatchResults m;
+          ASSERT_EQ(found,
+                    regex_search_parallel(s.cbegin(), s.cend(), m, re, options,
+                                          sequential_executor()));
+          if (found) expect_same_groups(expected, m, s.cbegin());
+        }
+      });
+}
+
+TEST(ParallelSearchTest, Threads) {
+  Regex re("(a|b)*(c|d)e");
+  std::string s(1 << 16, 'a');
+  s += "bbcex";
+  parallel_options options;
+  options.threads = 4;
+  options.min_chunk_size = 1 << 12;
+  MatchResults m;
+  ASSERT_TRUE(regex_search_parallel(s.cbegin(), s.cend(), m, re, options));
+  EXPECT_EQ(s.size() - 1, std::size_t(m[0].length()));
+  EXPECT_EQ("c", m[2].str());
+
+  std::string s2(1 << 16, 'a');
+  EXPECT_FALSE(regex_search_parallel(s2.cbegin(), s2.cend(), re, options));
+}
@@ -244,3 +244,51 @@ TEST(RegexParserTest, IllegalGroupB) {
   std::string v("a(b)c)");
   EXPECT_THROW(make_parser(v), regex_error);
 }
+
+TEST(RegexParserTest, Bracket) {
+  std::string v("[a-cx\\d]");
+  auto p = make_parser(v);
+  ASSERT_EQ(4u, p.nfa().size());
+  EXPECT_EQ(k_cc_char_set, p.nfa()[0].cc.type());
+  for (char c : std::string("abcx0123456789")) {
+    EXPECT_TRUE(p.nfa().match(0, c)) << c;
+  }
+  for (char c : std::string("dw-\\[]")) EXPECT_FALSE(p.nfa().match(0, c)) << c;
+}
+
+TEST(RegexParserTest, NegatedBracket) {
+  std::string v("[^a-c]");
+  auto p = make_parser(v);
+  auto& nfa = p.nfa();
+  EXPECT_FALSE(nfa.match(0, 'a'));
+  EXPECT_FALSE(nfa.match(0, 'c'));
+  EXPECT_TRUE(nfa.match(0, 'd'));
+  EXPECT_TRUE(nfa.match(0, '\n'));
+  EXPECT_TRUE(nfa.match(0, '\xff'));
+}
+
+TEST(RegexParserTest, SingleCharBracket) {
+  std::string v("[a]");
+  auto p = make_parser(v);
+  EXPECT_EQ(k_cc_ordinary_char, p.nfa()[0].cc.type());
+  EXPECT_EQ('a', p.nfa()[0].cc.ch());
+}
+
+TEST(RegexParserTest, WideBracket) {
+  std::wstring v(L"[^a-z\x3b1-\x3c9]");
+  auto p = make_parser(v);
+  auto& nfa = p.nfa();
+  EXPECT_FALSE(nfa.match(0, L'q'));
+  EXPECT_FALSE(nfa.match(0, L'\x3b5'));
+  EXPECT_TRUE(nfa.match(0, L'A'));
+  EXPECT_TRUE(nfa.match(0, L'\x391'));
+  EXPECT_TRUE(nfa.match(0, L'\x4e00'));
+}
+
+TEST(RegexParserTest, IllegalBracket) {
+  const char* patterns[] = {"[a", "[]", "[^]", "[z-a]", "[a-\\d]", "[\\d-a]",
+                            "[a-c-e]", "[[:alpha]"};
+  for (auto v : patterns) {
+    EXPECT_THROW(make_parser(std::string(v)), regex_error) << v;
+  }
+}
@@ -0,0 +1,120 @@
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "regex/regex.h"
+#include "regex/regex_func.h"
+#include "regex/regex_prefilter.h"
+
+using namespace regex;
+
+typedef basic_regex<char> Regex;
+typedef match_results<typename std::string::const_iterator> MatchResults;
+
+typedef std::vector<std::string> Literals;
+
+TEST(LiteralPrefixTest, Prefix) {
+  EXPECT_EQ(Literals{"abc"}, Regex("abc").prefilter().literals());
+  EXPECT_EQ(Literals{"ERROR"}, Regex("ERROR(a|b)*").prefilter().literals());
+  EXPECT_EQ((Literals{"abab", "abc"}), Regex("(ab)+c").prefilter().literals());
+  EXPECT_EQ(Literals{"a"}, Regex("ab*").prefilter().literals());
+}
+
+TEST(LiteralPrefixTest, Alternation) {
+  Regex re("foo|bar|foobar|baz");
+  EXPECT_EQ((Literals{"bar", "baz", "foo"}), re.prefilter().literals());
+  EXPECT_TRUE(re.prefilter().exact());
+
+  Regex re2("(ab|c)*d");
+  EXPECT_EQ((Literals{"ab", "c", "d"}), re2.prefilter().literals());
+  EXPECT_FALSE(re2.prefilter().exact());
+
+  EXPECT_EQ((Literals{"ab", "b"}), Regex("a?b").prefilter().literals());
+}
+
+TEST(LiteralPrefixTest, NoPrefix) {
+  EXPECT_TRUE(Regex("").prefilter().empty());
+  EXPECT_TRUE(Regex("a*").prefilter().empty());
+  EXPECT_TRUE(Regex("a|b?").prefilter().empty());
+
+  // Too many first chars to skip anything.
+  const char* letters = "(a|b|c|d|e|f|g|h|i|j|k|l|m|n|o|p|q)*x";
+  EXPECT_TRUE(Regex(letters).prefilter().empty());
+  EXPECT_FALSE(Regex("a|b|c|d|e|f|g|h|i|j|k|l|m|n|o|p|q").prefilter().empty());
+}
+
+TEST(LiteralPrefilterTest, Find) {
+  literal_prefilter<char> p(Literals{"abc"});
+  std::string s("ababcabc");
+  EXPECT_EQ(2, p.find(s.cbegin(), s.cend()) - s.cbegin());
+  EXPECT_EQ(5, p.find(s.cbegin() + 3, s.cend()) - s.cbegin());
+  EXPECT_EQ(s.cend(), p.find(s.cbegin() + 6, s.cend()));
+
+  std::vector<char> v(s.begin(), s.end());
+  EXPECT_EQ(2, p.find(v.begin(), v.end()) - v.begin());
+
+  std::wstring w(L"ababcabc");
+  literal_prefilter<wchar_t> wp(std::vector<std::wstring>{L"abc"});
+  EXPECT_EQ(2, wp.find(w.cbegin(), w.cend()) - w.cbegin());
+}
+
+TEST(LiteralPrefilterTest, Search) {
+  Regex re("ab(c|d)+e");
+  MatchResults what;
+  std::string s("xabcxabddex");
+  ASSERT_TRUE(regex_search(s.cbegin(), s.cend(), what, re));
+  EXPECT_EQ("abdde", what[0].str());
+  EXPECT_EQ("d", what[1].str());
+  EXPECT_TRUE(regex_search(s.cbegin(), s.cend(), re));
+
+  MatchResults what2;
+  std::string s2("xabcxabddx");
+  EXPECT_FALSE(regex_search(s2.cbegin(), s2.cend(), what2, re));
+  EXPECT_FALSE(regex_search(s2.cbegin(), s2.cend(), re));
+}
+
+TEST(LiteralPrefilterTest, FindLeftmost) {
+  literal_prefilter<char> p(Literals{"bcd", "abcdef", "cd"});
+  std::string s("xxabcdefx");
+  EXPECT_EQ(2, p.find(s.cbegin(), s.cend()) - s.cbegin());
+  EXPECT_EQ(3, p.find(s.cbegin() + 3, s.cend()) - s.cbegin());
+  EXPECT_EQ(s.cend(), p.find(s.cbegin() + 5, s.cend()));
+
+  std::string s2("xxabcdex");
+  EXPECT_EQ(3, p.find(s2.cbegin(), s2.cend()) - s2.cbegin());
+
+  // An occurrence ending at last.
+  std::string s3("xxcd");
+  EXPECT_EQ(2, p.find(s3.cbegin(), s3.cend()) - s3.cbegin());
+}
+
+TEST(LiteralPrefilterTest, SearchAlternation) {
+  std::string pattern;
+  for (int i = 0; i < 5000; ++i) {
+    if (i) pattern += '|';
+    pattern += "key" + std::to_string(i * 7) + "x";
+  }
+  Regex re(pattern);
+  ASSERT_TRUE(re.prefilter().exact());
+  EXPECT_EQ(5000u, re.prefilter().literals().size());
+
+  std::string s("a key13x key14x key21x");
+  MatchResults what;
+  ASSERT_TRUE(regex_search(s.cbegin(), s.cend(), what, re));
+  EXPECT_EQ("key14x", what[0].str());
+  EXPECT_TRUE(regex_search(s.cbegin(), s.cend(), re));
+
+  std::string s2("a key13x key15x key22x");
+  MatchResults what2;
+  EXPECT_FALSE(regex_search(s2.cbegin(), s2.cend(), what2, re));
+  EXPECT_FALSE(regex_search(s2.cbegin(), s2.cend(), re));
+}
+
+TEST(LiteralPrefilterTest, SearchLeftmostFirst) {
+  Regex re("(b|abc|ab)(c|d)");
+  MatchResults what;
+  std::string s("xabcd");
+  ASSERT_TRUE(regex_search(s.cbegin(), s.cend(), what, re));
+  EXPECT_EQ("abcd", what[0].str());
+  EXPECT_EQ("abc", what[1].str());
+}
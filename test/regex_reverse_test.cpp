@@ -0,0 +1,93 @@
+#include <string>
+
+#include "gtest/gtest.h"
+#include "regex/regex.h"
+#include "regex/regex_dfa.h"
+#include "regex/regex_func.h"
+#include "regex/regex_matcher.h"
+#include "regex/regex_reverse.h"
+
+#include "regex_differential.h"
+
+using namespace regex;
+
+typedef basic_regex<char> Regex;
+typedef lazy_dfa<Regex::nfa_type> DFA;
+typedef match_results<typename std::string::const_iterator> MatchResults;
+typedef regex_matcher<Regex, typename std::string::const_iterator,
+                      MatchResults>
+    RegexMatcher;
+
+/*! \brief Return the length of the longest prefix of the reversed s matched
+ * by the reversed program of re, or -1.
+ */
+static int reverse_match_length(const Regex& re, std::string s) {
+  std::string reversed(s.rbegin(), s.rend());
+  DFA dfa(re.reverse_nfa(), re.reverse_nfa().start_id());
+  dfa.set_match_kind(k_dfa_longest);
+  std::string::const_iterator match_end;
+  auto status = dfa.find(reversed.cbegin(), reversed.cend(), match_end);
+  if (status != k_dfa_match) return -1;
+  return match_end - reversed.cbegin();
+}
+
+TEST(ReverseNFATest, Reverse) {
+  EXPECT_EQ(0, reverse_match_length(Regex(""), "abc"));
+  EXPECT_EQ(3, reverse_match_length(Regex("abc"), "xabc"));
+  EXPECT_EQ(-1, reverse_match_length(Regex("abc"), "abcx"));
+  EXPECT_EQ(4, reverse_match_length(Regex("ab|abcd"), "abcd"));
+  EXPECT_EQ(2, reverse_match_length(Regex("ab|abcd"), "xbcab"));
+  EXPECT_EQ(5, reverse_match_length(Regex("(a|b)*c"), "xabbac"));
+  EXPECT_EQ(3, reverse_match_length(Regex("a**"), "baaa"));
+  EXPECT_EQ(-1, Regex().reverse_nfa().start_id());
+}
+
+TEST(ReverseNFATest, TooLarge) {
+  Regex re("(a|b|c|d)*");
+  Regex::nfa_type reversed;
+  EXPECT_FALSE(reverse_nfa(re.nfa(), re.nfa().start_id(), reversed, 4));
+  EXPECT_TRUE(reverse_nfa(re.nfa(), re.nfa().start_id(), reversed));
+}
+
+TEST(ReverseNFATest, MatchSpan) {
+  auto inputs = differential_inputs();
+  for (auto s : {"xab", "xxxxabcx", "ccaabbcc"}) inputs.push_back(s);
+  for_each_case<Regex>(
+      differential_patterns(), inputs,
+      [](const Regex& re, const std::string& s) {
+        // The leftmost start from which the pattern matches.
+        int start = -1, length = -1;
+        for (std::size_t i = 0; i <= s.size() && start < 0; ++i) {
+          MatchResults m;
+          RegexMatcher rm(s.cbegin() + i, s.cend(), re, m);
+          if (m.ready()) {
+            start = i;
+            length = m[0].length();
+          }
+        }
+
+        std::string::const_iterator match_first, match_last;
+        auto status =
+            find_match_span(s.cbegin(), s.cend(), re, match_first, match_last);
+        ASSERT_EQ(start >= 0 ? k_dfa_match : k_dfa_no_match, status);
+        if (start < 0) return;
+        EXPECT_EQ(start, match_first - s.cbegin());
+        EXPECT_EQ(length, match_last - match_first);
+      });
+}
+
+TEST(ReverseNFATest, SearchLongInput) {
+  Regex re("(a|b)+(c+)(d?)");
+  std::string s(REGEX_BACKTRACK_BUDGET, 'a');
+  s[s.size() - 1] = 'x';
+  s += "xbabccdx";
+  MatchResults expected, actual;
+  RegexMatcher rm(s.cbegin(), s.cend(), re, expected,
+                  re.nfa().search_start_id());
+  ASSERT_TRUE(regex_search(s.cbegin(), s.cend(), actual, re));
+  ASSERT_EQ(expected.size(), actual.size());
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(expected[i].str(), actual[i].str());
+  }
+  EXPECT_EQ("babccd", actual[0].str());
+}
@@ -81,3 +81,92 @@ TEST(RegexScannerTest, DisallowedEscapedSequence) {
   std::string v("\\a");
   EXPECT_THROW(make_scanner(v), regex_error);
 }
+
+TEST(RegexScannerTest, Bracket) {
+  std::string v("[^]a-z\\w-]");
+  auto s = make_scanner(v);
+  EXPECT_EQ(k_left_bracket, s.cur_token());
+  s.advance();
+  EXPECT_EQ(k_negation, s.cur_token());
+  s.advance();
+  EXPECT_EQ(k_character, s.cur_token());
+  EXPECT_EQ(']', s.cur_cc().ch());
+  s.advance();
+  EXPECT_EQ(k_character, s.cur_token());
+  EXPECT_EQ('a', s.cur_cc().ch());
+  s.advance();
+  EXPECT_EQ(k_range, s.cur_token());
+  s.advance();
+  EXPECT_EQ(k_character, s.cur_token());
+  EXPECT_EQ('z', s.cur_cc().ch());
+  s.advance();
+  EXPECT_EQ(k_char_class, s.cur_token());
+  EXPECT_EQ(k_cc_word, s.cur_class());
+  s.advance();
+  EXPECT_EQ(k_character, s.cur_token());
+  EXPECT_EQ('-', s.cur_cc().ch());
+  s.advance();
+  EXPECT_EQ(k_right_bracket, s.cur_token());
+  s.advance();
+  EXPECT_EQ(k_eof, s.cur_token());
+}
+
+TEST(RegexScannerTest, SpecialCharsInBracket) {
+  std::string v("[*^[(]*");
+  auto s = make_scanner(v);
+  EXPECT_EQ(k_left_bracket, s.cur_token());
+  for (char c : std::string("*^[(")) {
+    s.advance();
+    EXPECT_EQ(k_character, s.cur_token());
+    EXPECT_EQ(c, s.cur_cc().ch());
+  }
+  s.advance();
+  EXPECT_EQ(k_right_bracket, s.cur_token());
+  s.advance();
+  EXPECT_EQ(k_star, s.cur_token());
+}
+
+TEST(RegexScannerTest, CharClass) {
+  std::string v("\\d[[:alpha:]]");
+  auto s = make_scanner(v);
+  EXPECT_EQ(k_char_class, s.cur_token());
+  EXPECT_EQ(k_cc_digit, s.cur_class());
+  EXPECT_TRUE(s.cur_set().match('7'));
+  EXPECT_FALSE(s.cur_set().match('a'));
+  s.advance();
+  EXPECT_EQ(k_left_bracket, s.cur_token());
+  s.advance();
+  EXPECT_EQ(k_char_class, s.cur_token());
+  EXPECT_EQ(k_cc_alpha, s.cur_class());
+  s.advance();
+  EXPECT_EQ(k_right_bracket, s.cur_token());
+}
+
+TEST(RegexScannerTest, UnknownCharClass) {
+  std::string v("[[:foo:]]");
+  EXPECT_THROW(make_scanner(v).advance(), regex_error);
+}
+
+TEST(RegexScannerTest, Dot) {
+  std::string v(".\\.");
+  auto s = make_scanner(v);
+  EXPECT_EQ(k_character, s.cur_token());
+  EXPECT_EQ(k_cc_ordinary_char, s.cur_cc().type());
+  EXPECT_EQ('.', s.cur_cc().ch());
+  s.advance();
+  EXPECT_EQ(k_character, s.cur_token());
+  EXPECT_EQ(k_cc_ordinary_char, s.cur_cc().type());
+  EXPECT_EQ('.', s.cur_cc().ch());
+}
+
+TEST(RegexScannerTest, UTF8AnyChar) {
+  std::string v(".\\.");
+  regex_scanner<std::string::const_iterator, char_category<char32_t>> s(
+      v.cbegin(), v.cend(), std::locale());
+  EXPECT_EQ(k_character, s.cur_token());
+  EXPECT_EQ(k_cc_any_char, s.cur_cc().type());
+  s.advance();
+  EXPECT_EQ(k_character, s.cur_token());
+  EXPECT_EQ(k_cc_ordinary_char, s.cur_cc().type());
+  EXPECT_EQ('.', s.cur_cc().ch());
+}
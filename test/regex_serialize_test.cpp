@@ -0,0 +1,190 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "regex/regex.h"
+#include "regex/regex_except.h"
+#include "regex/regex_func.h"
+#include "regex/regex_serialize.h"
+
+using namespace regex;
+
+typedef basic_regex<char> Regex;
+typedef basic_regex<wchar_t> WRegex;
+typedef match_results<std::string::const_iterator> MatchResults;
+
+/*! \brief Expect the programs of a and b to be the same.
+ */
+template <class Regex>
+static void expect_same_program(const Regex& a, const Regex& b) {
+  auto& x = a.nfa();
+  auto& y = b.nfa();
+  EXPECT_EQ(a.flags(), b.flags());
+  EXPECT_EQ(a.mark_count(), b.mark_count());
+  EXPECT_EQ(x.start_id(), y.start_id());
+  EXPECT_EQ(x.search_start_id(), y.search_start_id());
+  ASSERT_EQ(x.size(), y.size());
+  for (std::size_t pc = 0; pc < x.size(); ++pc) {
+    EXPECT_EQ(x[pc].opcode, y[pc].opcode) << "pc: " << pc;
+    switch (x[pc].opcode) {
+      case k_match_char_category:
+        EXPECT_TRUE(x[pc].cc == y[pc].cc) << "pc: " << pc;
+        EXPECT_EQ(x[pc].next, y[pc].next) << "pc: " << pc;
+        break;
+      case k_fork:
+        EXPECT_EQ(x[pc].next2, y[pc].next2) << "pc: " << pc;
+        EXPECT_EQ(x[pc].next, y[pc].next) << "pc: " << pc;
+        break;
+      case k_accept:
+        EXPECT_EQ(x[pc].group_id, y[pc].group_id) << "pc: " << pc;
+        break;
+      case k_mark_group_start:
+      case k_mark_group_end:
+        EXPECT_EQ(x[pc].group_id, y[pc].group_id) << "pc: " << pc;
+        EXPECT_EQ(x[pc].next, y[pc].next) << "pc: " << pc;
+        break;
+      default:
+        EXPECT_EQ(x[pc].next, y[pc].next) << "pc: " << pc;
+        break;
+    }
+  }
+
+  EXPECT_EQ(a.classes().size(), b.classes().size());
+  for (int c = 0; c < 256; ++c) {
+    EXPECT_EQ(a.classes()[c], b.classes()[c]) << "byte: " << c;
+  }
+  auto& p = a.bit_parallel();
+  auto& q = b.bit_parallel();
+  ASSERT_EQ(p.available(), q.available());
+  if (!p.available()) return;
+  EXPECT_EQ(p.pcs(), q.pcs());
+  EXPECT_EQ(p.first_mask(), q.first_mask());
+  EXPECT_EQ(p.final_mask(), q.final_mask());
+  EXPECT_EQ(p.start_accepts(), q.start_accepts());
+  EXPECT_TRUE(std::equal(p.char_masks(), p.char_masks() + 256,
+                         q.char_masks()));
+  for (std::size_t i = 0; i < p.position_count(); ++i) {
+    EXPECT_EQ(p.follow_mask(i), q.follow_mask(i)) << "position: " << i;
+  }
+}
+
+TEST(RegexBlobTest, RoundTrip) {
+  std::vector<Regex> regexes;
+  regexes.emplace_back();
+  regexes.emplace_back("");
+  regexes.emplace_back("(a|ab)(c|bcd)(d*)");
+  regexes.emplace_back("[^a-c\\d]+@(\\w+)\\.com");
+  regexes.emplace_back("ERROR (a|b)+", k_syntax_nosubs);
+  regexes.emplace_back("caf\xc3\xa9|[^a-z\xc3\xa9]", k_syntax_utf8);
+  regexes.emplace_back("\x80[\xf0-\xff].", k_syntax_no_optimize);
+
+  std::string blob = serialize_regexes(regexes.begin(), regexes.end());
+  regex_blob<Regex> view(blob.data(), blob.size());
+  ASSERT_EQ(regexes.size(), view.size());
+  EXPECT_EQ(blob.size(), view.byte_size());
+
+  const char* inputs[] = {"",         "abcd",      "x@y.com zz@ab.com",
+                          "ERROR ab", "caf\xc3\xa9", "\xc3\xa0",
+                          "\x80\xf3z"};
+  for (std::size_t i = 0; i < regexes.size(); ++i) {
+    Regex re = view.load(i);
+    expect_same_program(regexes[i], re);
+    if (i == 0) continue;  // the empty regex has no program to run
+    for (auto s : inputs) {
+      std::string str(s);
+      MatchResults expected, actual;
+      ASSERT_EQ(regex_search(str.cbegin(), str.cend(), expected, regexes[i]),
+                regex_search(str.cbegin(), str.cend(), actual, re))
+          << "regex: " << i << ", input: " << s;
+      ASSERT_EQ(expected.size(), actual.size());
+      for (std::size_t g = 0; g < expected.size(); ++g) {
+        EXPECT_EQ(expected[g].str(), actual[g].str())
+            << "regex: " << i << ", input: " << s << ", group: " << g;
+      }
+    }
+  }
+
+  std::vector<WRegex> wide{WRegex(L"[\x3b1-\x3c9]+|\x10000"), WRegex(L"a.")};
+  std::string wblob = serialize_regexes(wide.begin(), wide.end());
+  regex_blob<WRegex> wview(wblob.data(), wblob.size());
+  for (std::size_t i = 0; i < wide.size(); ++i) {
+    expect_same_program(wide[i], wview.load(i));
+  }
+  EXPECT_THROW(regex_blob<WRegex>(blob.data(), blob.size()), regex_error);
+}
+
+TEST(RegexBlobTest, BadBlob) {
+  Regex re("(a|b)*c");
+  std::string blob = serialize_regex(re);
+  regex_blob<Regex> view(blob.data(), blob.size());
+  std::string s("abc");
+  EXPECT_TRUE(regex_match(s.cbegin(), s.cend(), view.load(0)));
+
+  EXPECT_THROW(regex_blob<Regex>(blob.data(), 8), regex_error);
+  EXPECT_THROW(regex_blob<Regex>(blob.data(), blob.size() - 4), regex_error);
+
+  std::string bad(blob);
+  bad[0] ^= 1;  // magic
+  EXPECT_THROW(regex_blob<Regex>(bad.data(), bad.size()), regex_error);
+  bad = blob;
+  bad[4] += 1;  // version
+  EXPECT_THROW(regex_blob<Regex>(bad.data(), bad.size()), regex_error);
+
+  // The header of the program follows the header of the blob and the offset,
+  // and the instructions follow it.
+  std::size_t insns = sizeof(blob_header) + 4 + sizeof(program_header);
+  bad = blob;
+  bad[insns + 4] = char(0xff);  // the arg of the first instruction
+  bad[insns + 5] = char(0xff);
+  regex_blob<Regex> bad_view(bad.data(), bad.size());
+  EXPECT_THROW(bad_view.load(0), regex_error);
+
+  bad = blob;
+  // The high byte of the first follow mask, before the 3 positions.
+  bad[blob.size() - 3 * 4 - 3 * 8 + 7] = char(0x80);
+  regex_blob<Regex> bad_masks_view(bad.data(), bad.size());
+  EXPECT_THROW(bad_masks_view.load(0), regex_error);
+
+  bad = blob;
+  bad[sizeof(blob_header) + 4 + 16] = char(0xff);  // insn_count
+  regex_blob<Regex> truncated_view(bad.data(), bad.size());
+  EXPECT_THROW(truncated_view.load(0), regex_error);
+}
+
+TEST(RegexBlobTest, MappedFile) {
+  std::vector<Regex> regexes;
+  for (int i = 0; i < 100; ++i) {
+    regexes.emplace_back("/api/v" + std::to_string(i % 7) + "/(a|b|c)*" +
+                         std::to_string(i) + "(x|y)");
+  }
+  std::string blob = serialize_regexes(regexes.begin(), regexes.end());
+
+  char path[] = "/tmp/regex_blob_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(ssize_t(blob.size()), write(fd, blob.data(), blob.size()));
+  void* p = mmap(nullptr, blob.size(), PROT_READ, MAP_PRIVATE, fd, 0);
+  ASSERT_NE(MAP_FAILED, p);
+  close(fd);
+  unlink(path);
+
+  regex_blob<Regex> view(p, blob.size());
+  ASSERT_EQ(100u, view.size());
+  std::string s("/api/v3/abca17y");
+  for (std::size_t i = 0; i < view.size(); ++i) {
+    EXPECT_EQ(regex_match(s.cbegin(), s.cend(), regexes[i]),
+              regex_match(s.cbegin(), s.cend(), view.load(i)))
+        << "regex: " << i;
+  }
+  Regex loaded = view.load(17);
+  munmap(p, blob.size());
+
+  // The loaded regex owns a copy of its program.
+  EXPECT_TRUE(regex_match(s.cbegin(), s.cend(), loaded));
+}
@@ -0,0 +1,108 @@
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "regex/regex.h"
+#include "regex/regex_func.h"
+#include "regex/regex_set.h"
+
+using namespace regex;
+
+typedef std::vector<std::size_t> Ids;
+typedef match_results<typename std::string::const_iterator> MatchResults;
+
+/*! \brief Return the ids of the patterns found in s by regex_search.
+ */
+static Ids search_ids(const regex_set& set, const std::string& s) {
+  Ids ids;
+  regex_search(s.cbegin(), s.cend(), ids, set);
+  return ids;
+}
+
+TEST(RegexSetTest, Search) {
+  regex_set set{"GET /api", "POST", "(a|b)+c", "x*", "timeout"};
+  EXPECT_EQ(5u, set.size());
+  EXPECT_EQ((Ids{0, 3}), search_ids(set, "GET /api/users"));
+  EXPECT_EQ((Ids{1, 2, 3, 4}), search_ids(set, "POST ababc timeout"));
+  EXPECT_EQ((Ids{3}), search_ids(set, ""));
+
+  regex_set set2{"abc", "bcd", "cd"};
+  EXPECT_EQ((Ids{0, 1, 2}), search_ids(set2, "xabcdx"));
+  EXPECT_EQ((Ids{2}), search_ids(set2, "acd"));
+  EXPECT_EQ(Ids{}, search_ids(set2, "ab"));
+}
+
+TEST(RegexSetTest, Cache) {
+  regex_set set{"abc", "b+", "(a|b)*d"};
+  regex_set_cache<regex_set> cache(set);
+  const char* inputs[] = {"abc", "xbbd", "abc", "cc", "xbbd"};
+  for (auto s : inputs) {
+    std::string str(s);
+    Ids ids;
+    regex_search(str.cbegin(), str.cend(), ids, set, cache);
+    EXPECT_EQ(search_ids(set, str), ids) << "input: " << s;
+  }
+  std::size_t states = cache.search_dfa().state_count();
+  std::string s("abcxbbd");
+  Ids ids;
+  regex_search(s.cbegin(), s.cend(), ids, set, cache);
+  EXPECT_EQ((Ids{0, 1, 2}), ids);
+  EXPECT_EQ(states, cache.search_dfa().state_count());
+}
+
+TEST(RegexSetTest, Match) {
+  regex_set set{"ab", "a", "(a|b)*c", "b"};
+  std::string s("abc");
+  Ids ids;
+  EXPECT_TRUE(regex_match(s.cbegin(), s.cend(), ids, set));
+  EXPECT_EQ((Ids{0, 1, 2}), ids);
+  std::string s2("c");
+  EXPECT_TRUE(regex_match(s2.cbegin(), s2.cend(), ids, set));
+  EXPECT_EQ((Ids{2}), ids);
+}
+
+TEST(RegexSetTest, Empty) {
+  regex_set set;
+  std::string s("abc");
+  Ids ids{1};
+  EXPECT_FALSE(regex_search(s.cbegin(), s.cend(), ids, set));
+  EXPECT_TRUE(ids.empty());
+}
+
+TEST(RegexSetTest, SameAsRegexSearch) {
+  std::vector<std::string> patterns{"a(b|c)d", "(ab)+", "b*c", "dd?a",
+                                    "(a|b|c|d)*e", "cab", "bad|dab"};
+  regex_set set(patterns.begin(), patterns.end());
+  const char* inputs[] = {"", "abd", "ababab", "c", "dda", "abcde",
+                          "xxcabxx", "dabad", "acdbbc"};
+  for (auto s : inputs) {
+    std::string str(s);
+    Ids expected;
+    for (std::size_t i = 0; i < patterns.size(); ++i) {
+      MatchResults m;
+      if (regex_search(str.cbegin(), str.cend(), m,
+                       basic_regex<char>(patterns[i]))) {
+        expected.push_back(i);
+      }
+    }
+    EXPECT_EQ(expected, search_ids(set, str)) << "input: " << s;
+  }
+}
+
+TEST(RegexSetTest, Matcher) {
+  regex_set set{"abc", "b+", "(a|b)*d"};
+  std::string s("xbbd");
+  std::vector<bool> matched(set.size(), false);
+  MatchResults m;
+  regex_matcher<regex_set, std::string::const_iterator, MatchResults> rm(
+      s.cbegin(), s.cend(), set, m, set.nfa().search_start_id(), &matched);
+  EXPECT_EQ((std::vector<bool>{false, true, true}), matched);
+}
+
+TEST(RegexSetTest, WideChar) {
+  wregex_set set{L"abc", L"b(c|d)"};
+  std::wstring s(L"xbd");
+  Ids ids;
+  EXPECT_TRUE(regex_search(s.cbegin(), s.cend(), ids, set));
+  EXPECT_EQ((Ids{1}), ids);
+}
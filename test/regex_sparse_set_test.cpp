@@ -0,0 +1,28 @@
+#include "gtest/gtest.h"
+#include "regex/regex_sparse_set.h"
+
+using namespace regex;
+
+TEST(SparseSetTest, InsertAndContains) {
+  sparse_set s(8);
+  EXPECT_TRUE(s.empty());
+  s.insert(5);
+  s.insert(2);
+  EXPECT_EQ(2u, s.size());
+  EXPECT_TRUE(s.contains(5));
+  EXPECT_TRUE(s.contains(2));
+  EXPECT_FALSE(s.contains(0));
+  EXPECT_EQ(5, *s.begin());
+  EXPECT_EQ(2, *(s.begin() + 1));
+}
+
+TEST(SparseSetTest, Clear) {
+  sparse_set s(4);
+  s.insert(3);
+  s.clear();
+  EXPECT_TRUE(s.empty());
+  EXPECT_FALSE(s.contains(3));
+  s.insert(1);
+  EXPECT_TRUE(s.contains(1));
+  EXPECT_FALSE(s.contains(3));
+}
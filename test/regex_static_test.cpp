@@ -0,0 +1,133 @@
+#include <string>
+
+#include "gtest/gtest.h"
+#include "regex/regex.h"
+#include "regex/regex_func.h"
+#include "regex/regex_static.h"
+
+using namespace regex;
+
+typedef basic_regex<char> Regex;
+typedef match_results<std::string::const_iterator> MatchResults;
+
+REGEX_STATIC_PATTERN(header_name, "[A-Za-z0-9!#$%&'*+.^_`|~-]+");
+REGEX_STATIC_PATTERN(quoted, "\"([^\"\\\\]|\\\\[\"\\\\])*\"");
+REGEX_STATIC_PATTERN(empty_pattern, "");
+REGEX_STATIC_PATTERN(error_line, "ERROR (a|b)+");
+
+static_assert(static_regex<header_name>::k_program.position_count == 1,
+              "a bracket is one position");
+static_assert(static_parser("a(b").parse().error == k_missing_right_group,
+              "the parse runs in constant expressions");
+
+TEST(StaticRegexTest, Errors) {
+  struct {
+    const char* pattern;
+    int error;
+  } cases[] = {
+      {"a\\", k_escape_eof},
+      {"a\\q", k_escape_bad_char},
+      {"(a", k_missing_right_group},
+      {"a)", k_unexpected_token},
+      {"*a", k_unexpected_token},
+      {"[ab", k_missing_right_bracket},
+      {"[z-a]", k_bad_range},
+      {"[a-\\d]", k_bad_range},
+      {"[\\d-z]", k_bad_range},
+      {"[[:foo:]]", k_bad_char_class},
+      {"[[:alpha]", k_bad_char_class},
+  };
+  for (auto& c : cases) {
+    EXPECT_EQ(c.error, static_parser(c.pattern).parse().error)
+        << "pattern: " << c.pattern;
+    EXPECT_THROW(Regex re(c.pattern), regex_error) << "pattern: " << c.pattern;
+  }
+
+  std::string large(65, 'a');
+  EXPECT_TRUE(static_parser(large.c_str()).parse().too_large);
+  EXPECT_TRUE(static_parser(large.c_str() + 1).parse().ok());
+}
+
+REGEX_STATIC_PATTERN(p0, "a");
+REGEX_STATIC_PATTERN(p1, "a*");
+REGEX_STATIC_PATTERN(p2, "(a|ab)(c|bcd)(d*)");
+REGEX_STATIC_PATTERN(p3, "(a*)*");
+REGEX_STATIC_PATTERN(p4, "(a+|b+)*(a|c)");
+REGEX_STATIC_PATTERN(p5, "a?b+c*");
+REGEX_STATIC_PATTERN(p6, ".x");
+REGEX_STATIC_PATTERN(p7, "[^a-c]+");
+REGEX_STATIC_PATTERN(p8, "[]a]");
+REGEX_STATIC_PATTERN(p9, "[^]a]b");
+REGEX_STATIC_PATTERN(p10, "[a-]x");
+REGEX_STATIC_PATTERN(p11, "\\w+@\\d");
+REGEX_STATIC_PATTERN(p12, "\\W\\D\\S");
+REGEX_STATIC_PATTERN(p13, "[[:xdigit:]]+z");
+REGEX_STATIC_PATTERN(p14, "[\\]\\-]");
+REGEX_STATIC_PATTERN(p15, "\\.\\*\\(");
+REGEX_STATIC_PATTERN(p16, "([ab]|c)*d");
+REGEX_STATIC_PATTERN(p17, "a|");
+REGEX_STATIC_PATTERN(p18, "(|a)b");
+
+/*! \brief Check the boolean queries of the patterns against basic_regex.
+ */
+template <class... Patterns>
+static void check_same_as_regex() {
+  const char* inputs[] = {"",       "a",      "abcd",   "xabcdd", "]a",
+                          "^b",     "-x",     "zab_9@7", " !?.*(", "0f9Az",
+                          "dcbad",  "]-",     "b",      "ab",     "\xff\x01x"};
+  const char* patterns[] = {Patterns::pattern()...};
+  bool (*matches[])(std::string::const_iterator, std::string::const_iterator) =
+      {&static_regex<Patterns>::template match<std::string::const_iterator>...};
+  bool (*searches[])(std::string::const_iterator,
+                     std::string::const_iterator) = {
+      &static_regex<Patterns>::template search<std::string::const_iterator>...};
+  for (std::size_t i = 0; i < sizeof...(Patterns); ++i) {
+    Regex re(patterns[i]);
+    for (auto s : inputs) {
+      std::string str(s);
+      EXPECT_EQ(regex_match(str.cbegin(), str.cend(), re),
+                matches[i](str.cbegin(), str.cend()))
+          << "pattern: " << patterns[i] << ", input: " << s;
+      EXPECT_EQ(regex_search(str.cbegin(), str.cend(), re),
+                searches[i](str.cbegin(), str.cend()))
+          << "pattern: " << patterns[i] << ", input: " << s;
+    }
+  }
+}
+
+TEST(StaticRegexTest, SameAsRegex) {
+  check_same_as_regex<empty_pattern, p0, p1, p2, p3, p4, p5, p6, p7, p8, p9,
+                      p10, p11, p12, p13, p14, p15, p16, p17, p18,
+                      header_name, quoted, error_line>();
+}
+
+TEST(StaticRegexTest, Match) {
+  static_regex<header_name> name;
+  std::string s("Content-Type: text/plain");
+  EXPECT_TRUE(regex_match(s.cbegin(), s.cend(), name));
+  EXPECT_FALSE(regex_match(s.cbegin() + 12, s.cend(), name));
+  EXPECT_TRUE(regex_search(s.cbegin() + 12, s.cend(), name));
+
+  static_regex<quoted> q;
+  std::string s2("\"a\\\"b\" rest");
+  EXPECT_TRUE(regex_match(s2.cbegin(), s2.cend(), q));
+  EXPECT_FALSE(regex_match(s2.cbegin() + 1, s2.cend(), q));
+  MatchResults m;
+  ASSERT_TRUE(regex_match(s2.cbegin(), s2.cend(), m, q));
+  EXPECT_EQ("\"a\\\"b\"", m[0].str());
+
+  static_regex<empty_pattern> e;
+  EXPECT_TRUE(regex_match(s.cbegin(), s.cbegin(), e));
+  EXPECT_TRUE(regex_search(s.cbegin(), s.cend(), e));
+}
+
+TEST(StaticRegexTest, Search) {
+  static_regex<error_line> re;
+  std::string log("INFO ok\nERROR abba\n");
+  EXPECT_TRUE(regex_search(log.cbegin(), log.cend(), re));
+  EXPECT_FALSE(regex_search(log.cbegin(), log.cbegin() + 8, re));
+  MatchResults m;
+  ASSERT_TRUE(regex_search(log.cbegin(), log.cend(), m, re));
+  EXPECT_EQ("ERROR abba", m[0].str());
+  EXPECT_EQ("a", m[1].str());
+}
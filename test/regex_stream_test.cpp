@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "regex/regex.h"
+#include "regex/regex_func.h"
+#include "regex/regex_iterator.h"
+#include "regex/regex_stream.h"
+
+#include "regex_differential.h"
+
+using namespace regex;
+
+typedef basic_regex<char> Regex;
+typedef match_results<typename std::string::const_iterator> MatchResults;
+typedef stream_matcher<Regex> StreamMatcher;
+typedef regex_iterator<typename std::string::const_iterator> RegexIterator;
+typedef std::vector<std::string> Strings;
+
+/*! \brief Feed s to sm in chunks of chunk_size chars.
+ */
+static void feed_chunks(StreamMatcher& sm, const std::string& s,
+                        std::size_t chunk_size) {
+  for (std::size_t i = 0; i < s.size(); i += chunk_size) {
+    sm.feed(s.data() + i, std::min(chunk_size, s.size() - i));
+  }
+  sm.finish();
+}
+
+TEST(StreamMatcherTest, SameAsSearch) {
+  for_each_case<Regex>(
+      differential_patterns(), differential_inputs(),
+      [](const Regex& re, const std::string& s) {
+        MatchResults expected;
+        bool found = regex_search(s.cbegin(), s.cend(), expected, re);
+        for (std::size_t chunk_size = 1; chunk_size <= 4; ++chunk_size) {
+          StreamMatcher sm(re);
+          feed_chunks(sm, s, chunk_size);
+          EXPECT_TRUE(sm.done());
+          ASSERT_EQ(found, sm.matched());
+          if (!found) continue;
+          ASSERT_EQ(expected.size(), sm.results().size());
+          for (std::size_t i = 0; i < expected.size(); ++i) {
+            auto& sub = sm.results()[i];
+            ASSERT_EQ(expected[i].matched(), sub.matched());
+            if (!sub.matched()) continue;
+            EXPECT_EQ(std::size_t(expected[i].first() - s.cbegin()),
+                      sub.first());
+            EXPECT_EQ(std::size_t(expected[i].last() - s.cbegin()),
+                      sub.last());
+          }
+        }
+      });
+}
+
+TEST(StreamMatcherTest, AbsolutePositions) {
+  Regex re("a(b+)c");
+  StreamMatcher sm(re);
+  std::string chunk(1000, 'x');
+  for (int i = 0; i < 100; ++i) sm.feed(chunk.data(), chunk.size());
+  EXPECT_FALSE(sm.done());
+  sm.feed("ab", 2);
+  sm.feed("bb", 2);
+  EXPECT_FALSE(sm.matched());
+  sm.feed("cxx", 3);
+  EXPECT_TRUE(sm.done());
+  ASSERT_TRUE(sm.matched());
+  EXPECT_EQ(100000u, sm.results()[0].first());
+  EXPECT_EQ(100005u, sm.results()[0].last());
+  EXPECT_EQ(100001u, sm.results()[1].first());
+  EXPECT_EQ(3u, sm.results()[1].length());
+  EXPECT_EQ(100005u, sm.position());
+
+  sm.reset();
+  sm.feed("abc", 3);
+  sm.finish();
+  EXPECT_TRUE(sm.matched());
+  EXPECT_EQ(0u, sm.results()[0].first());
+}
+
+TEST(StreamMatcherTest, Anchored) {
+  Regex re("(a|b)*c");
+  StreamMatcher sm(re, re.nfa().start_id());
+  sm.feed("ab", 2);
+  sm.feed("x", 1);
+  EXPECT_TRUE(sm.done());
+  EXPECT_FALSE(sm.matched());
+
+  sm.reset();
+  sm.feed("ab", 2);
+  sm.feed("cab", 3);
+  sm.finish();
+  ASSERT_TRUE(sm.matched());
+  EXPECT_EQ(3u, sm.results()[0].last());
+}
+
+/*! \brief Return the matches of re in s fed in chunks of chunk_size chars,
+ * resuming after each match.
+ */
+static Strings find_all(const Regex& re, const std::string& s,
+                        std::size_t chunk_size) {
+  Strings matches;
+  StreamMatcher sm(re);
+  auto collect = [&] {
+    auto& m = sm.results()[0];
+    matches.push_back(s.substr(m.first(), m.length()));
+  };
+  for (std::size_t i = 0; i < s.size();) {
+    i += sm.feed(s.data() + i, std::min(chunk_size, s.size() - i));
+    if (!sm.done()) continue;
+    if (sm.matched()) collect();
+    sm.resume();
+  }
+  for (sm.finish(); sm.matched(); sm.finish()) {
+    collect();
+    sm.resume();
+  }
+  return matches;
+}
+
+TEST(StreamMatcherTest, Resume) {
+  const char* patterns[] = {"ab*c",   "a*",        "x*",        "a|",
+                            "[0-9]+", "(a|b)+=c;", "abc|a",     "a(bcd)?|b",
+                            "xy*z|y"};
+  const char* inputs[] = {"",          "xabcabbcyyacx", "baaa",
+                          "ab",        "aba",           "1 22 333x",
+                          "ab=c;x b=c;", "abab",        "abcabxabca",
+                          "xyyyxyyz"};
+  for (auto p : patterns) {
+    Regex re(p);
+    for (auto s : inputs) {
+      std::string str(s);
+      Strings expected;
+      for (RegexIterator it(str.cbegin(), str.cend(), re), end; it != end;
+           ++it) {
+        expected.push_back((*it)[0].str());
+      }
+      for (std::size_t chunk_size = 1; chunk_size <= 4; ++chunk_size) {
+        EXPECT_EQ(expected, find_all(re, str, chunk_size))
+            << "pattern: " << p << ", input: " << s << ", chunk: "
+            << chunk_size;
+      }
+    }
+  }
+}
+
+TEST(StreamMatcherTest, Consumed) {
+  Regex re("a+");
+  StreamMatcher sm(re);
+  // The match is decided at the b, which is left for the next match.
+  EXPECT_EQ(3u, sm.feed("xaab", 4));
+  EXPECT_TRUE(sm.done());
+  EXPECT_EQ(3u, sm.position());
+  EXPECT_EQ(1u, sm.results()[0].first());
+  sm.resume();
+  EXPECT_EQ(3u, sm.position());
+  EXPECT_EQ(3u, sm.feed("baa", 3));
+  EXPECT_FALSE(sm.done());
+  sm.finish();
+  ASSERT_TRUE(sm.matched());
+  EXPECT_EQ(4u, sm.results()[0].first());
+  EXPECT_EQ(6u, sm.results()[0].last());
+
+  // The thread of abc reads the b and the x before the match a is decided.
+  Regex alt("abc|a");
+  StreamMatcher lag(alt);
+  EXPECT_EQ(3u, lag.feed("abxa", 4));
+  ASSERT_TRUE(lag.matched());
+  EXPECT_EQ(1u, lag.results()[0].last());
+  EXPECT_EQ(3u, lag.position());
+
+  // The b and the x are searched again, and the second a is found.
+  lag.resume();
+  EXPECT_EQ(1u, lag.feed("a", 1));
+  lag.finish();
+  ASSERT_TRUE(lag.matched());
+  EXPECT_EQ(3u, lag.results()[0].first());
+  EXPECT_EQ(4u, lag.results()[0].last());
+}
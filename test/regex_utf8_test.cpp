@@ -0,0 +1,121 @@
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "regex/regex.h"
+#include "regex/regex_func.h"
+#include "regex/regex_utf8.h"
+
+using namespace regex;
+
+typedef basic_regex<char> Regex;
+typedef match_results<typename std::string::const_iterator> MatchResults;
+
+/*! \brief Return the number of sequences matching the encoding of cp.
+ */
+static int matching_sequences(const std::vector<utf8_sequence>& seqs,
+                              char32_t cp) {
+  unsigned char bytes[4];
+  int length = utf8_encode(cp, bytes);
+  int n = 0;
+  for (auto& seq : seqs) {
+    if (seq.length != length) continue;
+    bool match = true;
+    for (int i = 0; i < length; ++i) {
+      match = match && seq.lo[i] <= bytes[i] && bytes[i] <= seq.hi[i];
+    }
+    n += match;
+  }
+  return n;
+}
+
+TEST(UTF8Test, Decode) {
+  std::string s("a\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\xc0\xaf");
+  auto it = s.cbegin();
+  EXPECT_EQ('a', utf8_decode(it, s.cend()));
+  EXPECT_EQ(0xe9, utf8_decode(it, s.cend()));
+  EXPECT_EQ(0x20ac, utf8_decode(it, s.cend()));
+  EXPECT_EQ(0x1f600, utf8_decode(it, s.cend()));
+  EXPECT_EQ(-1, utf8_decode(it, s.cend()));  // overlong
+}
+
+TEST(UTF8Test, Sequences) {
+  const char32_t ranges[][2] = {
+      {0, 0x10ffff},   {'a', 'z'},       {0x80, 0x7ff},   {0x3b1, 0x3c9},
+      {0x7f, 0x10000}, {0xd000, 0xe000}, {0x1234, 0x5678}};
+  for (auto& r : ranges) {
+    std::vector<utf8_sequence> seqs;
+    utf8_sequences(r[0], r[1], seqs);
+    for (char32_t cp = 0; cp <= k_max_code_point; ++cp) {
+      bool valid = cp < k_min_surrogate || cp > k_max_surrogate;
+      int expected = valid && r[0] <= cp && cp <= r[1];
+      ASSERT_EQ(expected, matching_sequences(seqs, cp))
+          << std::hex << r[0] << "-" << r[1] << ": " << cp;
+    }
+  }
+}
+
+/*! \brief Return the length of the match of re at the start of s, or -1.
+ */
+static int match_length(const Regex& re, const std::string& s) {
+  MatchResults what;
+  if (!regex_match(s.cbegin(), s.cend(), what, re)) return -1;
+  return what[0].length();
+}
+
+TEST(UTF8Test, AnyChar) {
+  Regex bytes(".");
+  Regex utf8(".", k_syntax_utf8);
+  EXPECT_EQ(-1, match_length(bytes, "\xc3\xa9"));
+  EXPECT_EQ(1, match_length(bytes, "."));
+  EXPECT_EQ(2, match_length(utf8, "\xc3\xa9"));
+  EXPECT_EQ(3, match_length(utf8, "\xe2\x82\xac"));
+  EXPECT_EQ(4, match_length(utf8, "\xf0\x9f\x98\x80"));
+  EXPECT_EQ(-1, match_length(utf8, "\xc3"));
+  EXPECT_EQ(-1, match_length(utf8, "\xa9"));
+}
+
+TEST(UTF8Test, Quantifier) {
+  Regex re("\xc3\xa9+x", k_syntax_utf8);
+  EXPECT_EQ(7, match_length(re, "\xc3\xa9\xc3\xa9\xc3\xa9x"));
+  EXPECT_EQ(-1, match_length(re, "\xc3\xa9\xa9x"));
+  EXPECT_FALSE(re.prefilter().empty());
+}
+
+TEST(UTF8Test, Search) {
+  struct {
+    const char* pattern;
+    const char* input;
+    const char* match;
+  } cases[] = {
+      // [α-ω]+
+      {"[\xce\xb1-\xcf\x89]+", "abc \xce\xb1\xce\xb2\xce\xb3 def",
+       "\xce\xb1\xce\xb2\xce\xb3"},
+      // [^a-z ]+
+      {"[^a-z ]+", "abc \xe2\x82\xac\xc3\xa9 def", "\xe2\x82\xac\xc3\xa9"},
+      // (.)x captures the whole code point
+      {"(.)x", "a\xf0\x9f\x98\x80x", "\xf0\x9f\x98\x80x"},
+      {"\\w+", "\xc3\xa9t\xc3\xa9", "t"},
+  };
+  for (auto& c : cases) {
+    Regex re(c.pattern, k_syntax_utf8);
+    std::string s(c.input);
+    MatchResults what;
+    ASSERT_TRUE(regex_search(s.cbegin(), s.cend(), what, re)) << c.pattern;
+    EXPECT_EQ(c.match, what[0].str()) << c.pattern;
+    EXPECT_TRUE(regex_search(s.cbegin(), s.cend(), re)) << c.pattern;
+  }
+}
+
+TEST(UTF8Test, InvalidPattern) {
+  EXPECT_THROW(Regex("a\xc3", k_syntax_utf8), regex_error);
+  EXPECT_THROW(Regex("[\xff]", k_syntax_utf8), regex_error);
+  EXPECT_NO_THROW(Regex("a\xc3"));
+}
+
+TEST(UTF8Test, WideChars) {
+  // The wide chars are already code points.
+  basic_regex<wchar_t> re(L"[^a]", k_syntax_utf8);
+  std::wstring s(L"\x20ac");
+  EXPECT_TRUE(regex_match(s.cbegin(), s.cend(), re));
+}
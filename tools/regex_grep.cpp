@@ -0,0 +1,250 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "regex/regex.h"
+#include "regex/regex_dfa.h"
+#include "regex/regex_except.h"
+#include "regex/regex_func.h"
+
+using namespace regex;
+
+typedef basic_regex<char> Regex;
+typedef lazy_dfa<Regex::nfa_type> DFA;
+
+/*! \brief The command line options.
+ */
+struct options {
+  bool count = false;        //!< Only print the number of matching lines
+  bool line_number = false;  //!< Prefix the lines with their numbers
+  bool byte_offset = false;  //!< Prefix the lines with their byte offsets
+  bool stats = false;        //!< Print the throughput and the counters
+  bool utf8 = false;         //!< The pattern and the files are UTF-8
+  const char* pattern = nullptr;
+  std::vector<const char*> files;
+};
+
+/*! \brief The counters of all the scanned files.
+ */
+struct counters {
+  std::size_t bytes = 0;
+  std::size_t lines = 0;  //!< The lines handed to the DFA
+  std::size_t matches = 0;
+  std::size_t fallbacks = 0;  //!< The lines the DFA gave up on
+};
+
+/*! \brief A read-only mapping of a whole file.
+ */
+class mapped_file {
+ public:
+  explicit mapped_file(const char* path) {
+    fd_ = open(path, O_RDONLY);
+    if (fd_ < 0) return;
+    struct stat st;
+    if (fstat(fd_, &st) < 0) return;
+    size_ = st.st_size;
+    if (size_ == 0) {
+      ok_ = true;
+      return;
+    }
+    void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (p == MAP_FAILED) return;
+    madvise(p, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const char*>(p);
+    ok_ = true;
+  }
+
+  ~mapped_file() {
+    if (data_) munmap(const_cast<char*>(data_), size_);
+    if (fd_ >= 0) close(fd_);
+  }
+
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+
+  bool ok() const { return ok_; }
+  const char* begin() const { return data_; }
+  const char* end() const { return data_ + size_; }
+  std::size_t size() const { return size_; }
+
+ private:
+  int fd_ = -1;
+  const char* data_ = nullptr;
+  std::size_t size_ = 0;
+  bool ok_ = false;
+};
+
+/*! \brief Return true if a substring of [first, last) matches re.
+ *
+ * The DFA keeps its states between the lines. If it gives up on a line, the
+ * line is searched with regex_search.
+ */
+static bool search_line(const char* first, const char* last, const Regex& re,
+                        DFA& dfa, counters& c) {
+  ++c.lines;
+  const char* match_end;
+  switch (dfa.find(first, last, match_end)) {
+    case k_dfa_match:
+      return true;
+    case k_dfa_no_match:
+      return false;
+    default:
+      ++c.fallbacks;
+      return regex_search(first, last, re);
+  }
+}
+
+/*! \brief Print the lines of [first, last) matching re, or their number.
+ *
+ * If re has literal prefixes, the lines without a candidate of the prefilter
+ * are skipped without being split.
+ */
+static std::size_t grep(const char* name, const char* first, const char* last,
+                        const Regex& re, DFA& dfa, const options& opts,
+                        counters& c) {
+  auto& prefilter = re.prefilter();
+  std::size_t matched = 0;
+  std::size_t line_number = 1;
+  const char* numbered = first;  // line_number is the number of this line
+  const char* cur = first;
+  while (cur != last) {
+    const char* line_first = cur;
+    if (!prefilter.empty()) {
+      const char* candidate = prefilter.find(cur, last);
+      if (candidate == last) break;
+      while (candidate != cur && candidate[-1] != '\n') --candidate;
+      line_first = candidate;
+    }
+    auto line_last = static_cast<const char*>(
+        std::memchr(line_first, '\n', last - line_first));
+    if (!line_last) line_last = last;
+    cur = line_last == last ? last : line_last + 1;
+
+    if (!search_line(line_first, line_last, re, dfa, c)) continue;
+    ++matched;
+    if (opts.count) continue;
+
+    if (name) std::printf("%s:", name);
+    if (opts.line_number) {
+      line_number += std::count(numbered, line_first, '\n');
+      numbered = line_first;
+      std::printf("%zu:", line_number);
+    }
+    if (opts.byte_offset) std::printf("%zu:", std::size_t(line_first - first));
+    std::fwrite(line_first, 1, line_last - line_first, stdout);
+    std::putchar('\n');
+  }
+
+  if (opts.count) {
+    if (name) std::printf("%s:", name);
+    std::printf("%zu\n", matched);
+  }
+  return matched;
+}
+
+static void usage() {
+  std::fprintf(stderr,
+               "usage: regex_grep [-c] [-n] [-b] [-u] [--stats] PATTERN "
+               "FILE...\n"
+               "  -c       print only the number of matching lines\n"
+               "  -n       print the line numbers\n"
+               "  -b       print the byte offsets of the lines\n"
+               "  -u       match the code points of UTF-8 text\n"
+               "  --stats  print the throughput and the engine counters\n");
+}
+
+static bool parse_options(int argc, char** argv, options& opts) {
+  int i = 1;
+  for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--") {
+      ++i;
+      break;
+    } else if (arg == "--stats") {
+      opts.stats = true;
+    } else if (arg == "-c") {
+      opts.count = true;
+    } else if (arg == "-n") {
+      opts.line_number = true;
+    } else if (arg == "-b") {
+      opts.byte_offset = true;
+    } else if (arg == "-u") {
+      opts.utf8 = true;
+    } else {
+      return false;
+    }
+  }
+  if (i + 2 > argc) return false;
+  opts.pattern = argv[i++];
+  for (; i < argc; ++i) opts.files.push_back(argv[i]);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  options opts;
+  if (!parse_options(argc, argv, opts)) {
+    usage();
+    return 2;
+  }
+
+  syntax_flags flags = opts.utf8 ? k_syntax_utf8 : k_syntax_default;
+  Regex re;
+  try {
+    re = Regex(opts.pattern, flags);
+  } catch (const regex_error& e) {
+    std::fprintf(stderr, "regex_grep: %s\n", e.what());
+    return 2;
+  }
+
+  DFA dfa(re.nfa(), re.nfa().search_start_id());
+  dfa.set_prefilter(&re.prefilter());
+  dfa.set_byte_classes(&re.classes());
+  counters c;
+  bool error = false;
+
+  auto start = std::chrono::steady_clock::now();
+  for (auto path : opts.files) {
+    mapped_file file(path);
+    if (!file.ok()) {
+      std::fprintf(stderr, "regex_grep: %s: %s\n", path,
+                   std::strerror(errno));
+      error = true;
+      continue;
+    }
+    const char* name = opts.files.size() > 1 ? path : nullptr;
+    c.matches += grep(name, file.begin(), file.end(), re, dfa, opts, c);
+    c.bytes += file.size();
+  }
+  auto stop = std::chrono::steady_clock::now();
+
+  if (opts.stats) {
+    double s = std::chrono::duration<double>(stop - start).count();
+    std::fprintf(stderr,
+                 "%zu bytes in %.3f s, %.1f MB/s\n"
+                 "%zu insns (%zu before optimization), prefilter %s, "
+                 "bit-parallel %s, one-pass %s\n"
+                 "%zu lines searched, %zu matched, %zu fell back to the NFA\n"
+                 "%zu DFA states cached, %zu byte classes, %u flushes\n",
+                 c.bytes, s, s > 0 ? c.bytes / s / 1e6 : 0.0, re.nfa().size(),
+                 re.original_size(),
+                 re.prefilter().empty()
+                     ? "none"
+                     : re.prefilter().exact() ? "exact" : "prefix",
+                 re.bit_parallel().available() ? "yes" : "no",
+                 re.is_one_pass() ? "yes" : "no", c.lines, c.matches,
+                 c.fallbacks, dfa.state_count(), re.classes().size(),
+                 dfa.flush_count());
+  }
+
+  if (error) return 2;
+  return c.matches > 0 ? 0 : 1;
+}